@@ -2,6 +2,7 @@
 
 #include "token.hpp"
 
+#include <cstddef>
 #include <string>
 
 void Statement::statementNode() {}
@@ -84,6 +85,11 @@ void IntegerLiteral::expressionNode() {}
 std::string IntegerLiteral::tokenLiteral() { return token.Literal; }
 std::string IntegerLiteral::getString() { return token.Literal; }
 
+FloatLiteral::FloatLiteral(const Token &t, double v) : token{t}, value{v} {}
+void FloatLiteral::expressionNode() {}
+std::string FloatLiteral::tokenLiteral() { return token.Literal; }
+std::string FloatLiteral::getString() { return token.Literal; }
+
 PrefixExpression::PrefixExpression(Token &t, std::string &op) : token{t}, _operator{op} {}
 void PrefixExpression::expressionNode() {}
 std::string PrefixExpression::tokenLiteral() { return token.Literal; }
@@ -123,12 +129,14 @@ std::string FunctionLiteral::tokenLiteral() { return token.Literal; }
 std::string FunctionLiteral::getString() {
   std::string info = tokenLiteral() + "(";
 
-  int i = 0;
-  for (; i < parameters.size() - 1; ++i) {
-    info += parameters[i]->getString() + ", ";
+  for (std::size_t i = 0; i < parameters.size(); ++i) {
+    if (i != 0) {
+      info += ", ";
+    }
+    info += parameters[i]->getString();
   }
 
-  info += parameters[i]->getString() + ")";
+  info += ")";
 
   return info;
 }
@@ -143,12 +151,14 @@ std::string CallExpression::getString() {
 
   info += "(";
 
-  int i = 0;
-  for (; i < arguments.size() - 1; ++i) {
-    info += arguments[i]->getString() + ", ";
+  for (std::size_t i = 0; i < arguments.size(); ++i) {
+    if (i != 0) {
+      info += ", ";
+    }
+    info += arguments[i]->getString();
   }
 
-  info += arguments[i]->getString() + ")";
+  info += ")";
 
   return info;
 }
@@ -166,12 +176,14 @@ std::string ArrayLiteral::getString() {
 
   info += "[";
 
-  int i = 0;
-  for (; i < elements.size() - 1; ++i) {
-    info += elements[i]->getString() + ", ";
+  for (std::size_t i = 0; i < elements.size(); ++i) {
+    if (i != 0) {
+      info += ", ";
+    }
+    info += elements[i]->getString();
   }
 
-  info += elements[i]->getString() + "]";
+  info += "]";
 
   return info;
 }
@@ -183,4 +195,24 @@ std::string IndexExpression::getString() {
   std::string info = "(" + left->getString() + "[" + index->getString() + "])";
 
   return info;
-}
\ No newline at end of file
+}
+
+HashLiteral::HashLiteral(const Token &t) : token{t} {}
+void HashLiteral::expressionNode() {}
+std::string HashLiteral::tokenLiteral() { return token.Literal; }
+std::string HashLiteral::getString() {
+  std::string info{};
+
+  info += "{";
+
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    if (i != 0) {
+      info += ", ";
+    }
+    info += pairs[i].first->getString() + ":" + pairs[i].second->getString();
+  }
+
+  info += "}";
+
+  return info;
+}
@@ -1,11 +1,13 @@
 #ifndef _AST_AST_HPP_
 #define _AST_AST_HPP_
 
+#include "ref.hpp"
 #include "token.hpp"
 
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 /**
@@ -164,6 +166,31 @@ public:
 
   Token token;
   int64_t value;
+
+  // the cached value object, filled by the evaluator on the first visit
+  Ref<RefCounted> object{};
+
+  void expressionNode() override;
+  std::string tokenLiteral() override;
+  std::string getString() override;
+};
+
+/**
+ * @brief `FloatLiteral` is an expression which represents
+ * the `3.14`.
+ *
+ */
+class FloatLiteral : public Expression {
+public:
+  FloatLiteral() = default;
+  FloatLiteral(const Token &, double);
+
+  Token token;
+  double value;
+
+  // the cached value object, filled by the evaluator on the first visit
+  Ref<RefCounted> object{};
+
   void expressionNode() override;
   std::string tokenLiteral() override;
   std::string getString() override;
@@ -293,6 +320,9 @@ public:
   Token token;
   std::string value;
 
+  // the cached value object, filled by the evaluator on the first visit
+  Ref<RefCounted> object{};
+
   StringLiteral() = default;
   StringLiteral(const Token &, const std::string &);
 
@@ -338,4 +368,22 @@ public:
   std::string getString() override;
 };
 
+/**
+ * @brief Represent the hash literal such as {"one": 1, 2: "two"}.
+ * The pairs are kept in the order of the source.
+ *
+ */
+class HashLiteral : public Expression {
+public:
+  Token token;
+  std::vector<std::pair<std::unique_ptr<Expression>, std::unique_ptr<Expression>>> pairs;
+
+  HashLiteral() = default;
+  HashLiteral(const Token &);
+
+  void expressionNode() override;
+  std::string tokenLiteral() override;
+  std::string getString() override;
+};
+
 #endif  // _AST_AST_HPP_
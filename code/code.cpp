@@ -34,6 +34,11 @@ const Opcode Ops::OpSetLocal{23};
 const Opcode Ops::OpGetBuiltin{24};
 const Opcode Ops::OpClosure{25};
 const Opcode Ops::OpGetFree{26};
+const Opcode Ops::OpHash{27};
+const Opcode Ops::OpAddFloat{28};
+const Opcode Ops::OpSubFloat{29};
+const Opcode Ops::OpMulFloat{30};
+const Opcode Ops::OpDivFloat{31};
 
 const std::unordered_map<Opcode, Definition> Code::definitions{
     // For OpConstant, we store the index not the number itself
@@ -147,6 +152,29 @@ const std::unordered_map<Opcode, Definition> Code::definitions{
         Ops::OpGetFree,
         Definition{"OpGetFree", {1}},
     },
+    {
+        Ops::OpHash,
+        // The operand is the number of the keys and the values
+        Definition{"OpHash", {2}},
+    },
+    // The arithmetic where the compiler knows an operand is a float,
+    // the integer operand is promoted.
+    {
+        Ops::OpAddFloat,
+        Definition{"OpAddFloat", {}},
+    },
+    {
+        Ops::OpSubFloat,
+        Definition{"OpSubFloat", {}},
+    },
+    {
+        Ops::OpMulFloat,
+        Definition{"OpMulFloat", {}},
+    },
+    {
+        Ops::OpDivFloat,
+        Definition{"OpDivFloat", {}},
+    },
 };
 
 Instructions Code::make(const Opcode &op, const std::vector<int> &operands) {
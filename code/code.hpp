@@ -58,6 +58,11 @@ struct Ops {
   static const Opcode OpGetBuiltin;
   static const Opcode OpClosure;
   static const Opcode OpGetFree;
+  static const Opcode OpHash;
+  static const Opcode OpAddFloat;
+  static const Opcode OpSubFloat;
+  static const Opcode OpMulFloat;
+  static const Opcode OpDivFloat;
 };
 
 /**
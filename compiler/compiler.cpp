@@ -36,7 +36,17 @@ void Compiler::compile(Node *node) {
     compile(infixExpression->left.get());
     compile(infixExpression->right.get());
 
-    if (infixExpression->_operator == "+") {
+    if (isFloatExpression(infixExpression)) {
+      if (infixExpression->_operator == "+") {
+        emit(Ops::OpAddFloat, {});
+      } else if (infixExpression->_operator == "-") {
+        emit(Ops::OpSubFloat, {});
+      } else if (infixExpression->_operator == "*") {
+        emit(Ops::OpMulFloat, {});
+      } else {
+        emit(Ops::OpDivFloat, {});
+      }
+    } else if (infixExpression->_operator == "+") {
       emit(Ops::OpAdd, {});
     } else if (infixExpression->_operator == "-") {
       emit(Ops::OpSub, {});
@@ -55,9 +65,13 @@ void Compiler::compile(Node *node) {
 
   IntegerLiteral *integerLiteral = dynamic_cast<IntegerLiteral *>(node);
   if (integerLiteral != nullptr) {
-    std::unique_ptr<Object> integer = std::make_unique<Integer>(integerLiteral->value);
     // Here, we push the index for the constant, not the number itself.
-    emit(Ops::OpConstant, {addConstant(integer)});
+    emit(Ops::OpConstant, {addConstant(Value::fromInteger(integerLiteral->value))});
+  }
+
+  FloatLiteral *floatLiteral = dynamic_cast<FloatLiteral *>(node);
+  if (floatLiteral != nullptr) {
+    emit(Ops::OpConstant, {addConstant(Value::fromFloat(floatLiteral->value))});
   }
 
   BooleanExpression *booleanExpression = dynamic_cast<BooleanExpression *>(node);
@@ -163,8 +177,8 @@ void Compiler::compile(Node *node) {
 
   StringLiteral *stringLiteral = dynamic_cast<StringLiteral *>(node);
   if (stringLiteral != nullptr) {
-    std::unique_ptr<Object> string = std::make_unique<String>(stringLiteral->value);
-    emit(Ops::OpConstant, {addConstant(string)});
+    Value string = Interner::current().intern(stringLiteral->value);
+    emit(Ops::OpConstant, {addConstant(std::move(string))});
   }
 
   ArrayLiteral *arrayLiteral = dynamic_cast<ArrayLiteral *>(node);
@@ -184,6 +198,17 @@ void Compiler::compile(Node *node) {
     emit(Ops::OpIndex, {});
   }
 
+  HashLiteral *hashLiteral = dynamic_cast<HashLiteral *>(node);
+  if (hashLiteral != nullptr) {
+    // The pairs are compiled in the order of the source
+    for (auto &&[key, value] : hashLiteral->pairs) {
+      compile(key.get());
+      compile(value.get());
+    }
+
+    emit(Ops::OpHash, {static_cast<int>(hashLiteral->pairs.size() * 2)});
+  }
+
   FunctionLiteral *functionLiteral = dynamic_cast<FunctionLiteral *>(node);
   if (functionLiteral != nullptr) {
     // We should create a new scope for this new function
@@ -199,7 +224,8 @@ void Compiler::compile(Node *node) {
       replaceLastPopWithReturn();
     }
 
-    auto &freeSymbols = symbolTable->getFreeSymbols();
+    // Copy the free symbols, `leaveScope` drops the symbol table.
+    auto freeSymbols = symbolTable->getFreeSymbols();
     int numLocals = currentSymbolTable()->getNumDefinition();
     Instructions instructions = leaveScope();
 
@@ -207,9 +233,10 @@ void Compiler::compile(Node *node) {
       loadSymbol(symbol);
     }
 
-    std::unique_ptr<Object> compiledFunction = std::make_unique<CompiledFunction>(std::move(instructions), numLocals);
+    int numParameters = static_cast<int>(functionLiteral->parameters.size());
+    Value compiledFunction = makeRef<CompiledFunction>(std::move(instructions), numLocals, numParameters);
 
-    int functionIndex = addConstant(compiledFunction);
+    int functionIndex = addConstant(std::move(compiledFunction));
 
     emit(Ops::OpClosure, {functionIndex, static_cast<int>(freeSymbols.size())});
   }
@@ -235,8 +262,19 @@ void Compiler::compile(Node *node) {
   }
 }
 
-int Compiler::addConstant(std::unique_ptr<Object> &object) {
-  bytecode.constants.emplace_back(std::move(object));
+int Compiler::addConstant(Value value) {
+  // The equal string literals are one interned object, they share the
+  // constant.
+  String *string = value.is<String>() ? value.as<String>() : nullptr;
+  if (string != nullptr && string->isInterned()) {
+    auto it = stringConstants.find(string);
+    if (it != stringConstants.end()) {
+      return it->second;
+    }
+    stringConstants.emplace(string, bytecode.constants.size());
+  }
+
+  bytecode.constants.push_back(std::move(value));
   return bytecode.constants.size() - 1;
 }
 
@@ -321,3 +359,25 @@ void Compiler::loadSymbol(std::reference_wrapper<Symbol> symbol) {
     emit(Ops::OpGetFree, {symbol.get().index});
   }
 }
+
+bool Compiler::isFloatExpression(Expression *expression) {
+  if (dynamic_cast<FloatLiteral *>(expression) != nullptr) {
+    return true;
+  }
+
+  PrefixExpression *prefixExpression = dynamic_cast<PrefixExpression *>(expression);
+  if (prefixExpression != nullptr) {
+    return prefixExpression->_operator == "-" && isFloatExpression(prefixExpression->right.get());
+  }
+
+  InfixExpression *infixExpression = dynamic_cast<InfixExpression *>(expression);
+  if (infixExpression != nullptr) {
+    const std::string &op = infixExpression->_operator;
+    if (op != "+" && op != "-" && op != "*" && op != "/") {
+      return false;
+    }
+    return isFloatExpression(infixExpression->left.get()) || isFloatExpression(infixExpression->right.get());
+  }
+
+  return false;
+}
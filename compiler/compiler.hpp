@@ -9,11 +9,12 @@
 
 #include <cstddef>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 struct Bytecode {
   Instructions instructions;
-  std::vector<std::shared_ptr<Object>> constants;
+  std::vector<Value> constants;
 
   Bytecode() = default;
   Bytecode(const Bytecode &b) = delete;
@@ -44,6 +45,9 @@ private:
   std::vector<CompilationScope> scopes;
   int scopeIndex;
 
+  // The index of each interned string constant
+  std::unordered_map<const String *, int> stringConstants;
+
 public:
   Compiler() : scopeIndex{0} {
     scopes.push_back(CompilationScope{});
@@ -53,11 +57,17 @@ public:
       symbolTable->defineBuiltin(i, Builtins::getBuiltinNames()[i]);
     }
   }
-  Compiler(std::vector<std::shared_ptr<Object>> &constants, std::shared_ptr<SymbolTable> &table)
+  Compiler(std::vector<Value> &constants, std::shared_ptr<SymbolTable> &table)
       : symbolTable{table}, scopeIndex{0} {
     bytecode.constants = constants;
     scopes.push_back(CompilationScope{});
 
+    for (int i = 0; i < constants.size(); i++) {
+      if (constants[i].is<String>() && constants[i].as<String>()->isInterned()) {
+        stringConstants.emplace(constants[i].as<String>(), i);
+      }
+    }
+
     for (int i = 0; i < Builtins::getBuiltinNames().size(); i++) {
       symbolTable->defineBuiltin(i, Builtins::getBuiltinNames()[i]);
     }
@@ -75,10 +85,10 @@ public:
    * @brief add the constant operation, return the instruction
    * length
    *
-   * @param object
+   * @param value
    * @return int
    */
-  int addConstant(std::unique_ptr<Object> &object);
+  int addConstant(Value value);
 
   /**
    * @brief emit the instruction, return the instruction length
@@ -170,6 +180,14 @@ public:
    */
   void replaceLastPopWithReturn();
 
+  /**
+   * @brief whether the expression is known to be a float at compile time:
+   * a float literal, its negation, or the arithmetic with one of them.
+   * The arithmetic on it is emitted as the float opcodes.
+   *
+   */
+  static bool isFloatExpression(Expression *expression);
+
   /**
    * @brief load the symbol to the stack
    *
@@ -31,13 +31,14 @@ std::unique_ptr<Program> parse(const std::string &input);
 Instructions concatInstructions(std::vector<Instructions> &instructions);
 bool testInstructions(std::vector<Instructions> &expected, const Instructions &actual);
 bool testIntegerObject(int expected, Object *actual);
+bool testFloatObject(double expected, Object *actual);
 bool testStringObject(const std::string &expected, Object *actual);
 
 template <typename T>
-bool testConstants(std::vector<T> &expected, std::vector<std::shared_ptr<Object>> &actual);
+bool testConstants(std::vector<T> &expected, std::vector<Value> &actual);
 
 template <typename T>
-bool testConstants(std::vector<T> &expected, std::vector<std::shared_ptr<Object>> &actual) {
+bool testConstants(std::vector<T> &expected, std::vector<Value> &actual) {
   if (actual.size() != expected.size()) {
     spdlog::error("wrong number of constants. got={}, want={}", actual.size(), expected.size());
     return false;
@@ -45,22 +46,26 @@ bool testConstants(std::vector<T> &expected, std::vector<std::shared_ptr<Object>
 
   for (size_t i = 0; i < actual.size(); i++) {
     if constexpr (std::is_same_v<int, T>) {
-      if (!testIntegerObject(expected[i], actual[i].get())) {
+      if (!testIntegerObject(expected[i], actual[i].toObject().get())) {
+        return false;
+      }
+    } else if constexpr (std::is_same_v<double, T>) {
+      if (!testFloatObject(expected[i], actual[i].toObject().get())) {
         return false;
       }
     } else if constexpr (std::is_same_v<std::string, T>) {
-      if (!testStringObject(expected[i], actual[i].get())) {
+      if (!testStringObject(expected[i], actual[i].toObject().get())) {
         return false;
       }
     } else if constexpr (std::is_same_v<std::variant<int, std::vector<Instructions>>, T>) {
       if (std::holds_alternative<int>(expected[i])) {
-        if (!testIntegerObject(std::get<int>(expected[i]), actual[i].get())) {
+        if (!testIntegerObject(std::get<int>(expected[i]), actual[i].toObject().get())) {
           return false;
         }
       } else if (std::holds_alternative<std::vector<Instructions>>(expected[i])) {
-        CompiledFunction *compiledFunction = dynamic_cast<CompiledFunction *>(actual[i].get());
+        CompiledFunction *compiledFunction = dynamic_cast<CompiledFunction *>(actual[i].getObject());
         if (compiledFunction == nullptr) {
-          spdlog::error("object is not CompiledFunction. got={}", actual[i]->type());
+          spdlog::error("object is not CompiledFunction. got={}", actual[i].type());
           return false;
         }
 
@@ -126,6 +131,21 @@ bool testIntegerObject(int expected, Object *actual) {
   return true;
 }
 
+bool testFloatObject(double expected, Object *actual) {
+  auto floating = dynamic_cast<const Float *>(actual);
+  if (floating == nullptr) {
+    spdlog::error("object is not Float. got={}", actual->type());
+    return false;
+  }
+
+  if (floating->value != expected) {
+    spdlog::error("object has wrong value. want={}, got={}", expected, floating->value);
+    return false;
+  }
+
+  return true;
+}
+
 bool testStringObject(const std::string &expected, Object *actual) {
   auto str = dynamic_cast<const String *>(actual);
   if (str == nullptr) {
@@ -133,8 +153,8 @@ bool testStringObject(const std::string &expected, Object *actual) {
     return false;
   }
 
-  if (str->value != expected) {
-    spdlog::error("object has wrong value. want={}, got={}", expected, str->value);
+  if (str->value() != expected) {
+    spdlog::error("object has wrong value. want={}, got={}", expected, str->value());
     return false;
   }
 
@@ -214,6 +234,56 @@ TEST(Compiler, TestIntegerArithmetic) {
   }
 }
 
+TEST(Compiler, TestFloatArithmetic) {
+  std::vector<CompilerTestCase<double>> tests{
+      {
+          "1.5 + 2.5",
+          {1.5, 2.5},
+          {
+              Code::make(Ops::OpConstant, {0}),
+              Code::make(Ops::OpConstant, {1}),
+              Code::make(Ops::OpAddFloat, {}),
+              Code::make(Ops::OpPop, {}),
+          },
+      },
+      {
+          "-0.5 * 2.0 / 4.0 - 1.0",
+          {0.5, 2.0, 4.0, 1.0},
+          {
+              Code::make(Ops::OpConstant, {0}),
+              Code::make(Ops::OpMinus, {}),
+              Code::make(Ops::OpConstant, {1}),
+              Code::make(Ops::OpMulFloat, {}),
+              Code::make(Ops::OpConstant, {2}),
+              Code::make(Ops::OpDivFloat, {}),
+              Code::make(Ops::OpConstant, {3}),
+              Code::make(Ops::OpSubFloat, {}),
+              Code::make(Ops::OpPop, {}),
+          },
+      },
+      {
+          // The comparison stays generic
+          "1.5 > 0.5",
+          {1.5, 0.5},
+          {
+              Code::make(Ops::OpConstant, {0}),
+              Code::make(Ops::OpConstant, {1}),
+              Code::make(Ops::OpGreaterThan, {}),
+              Code::make(Ops::OpPop, {}),
+          },
+      },
+  };
+
+  for (auto &&test : tests) {
+    auto program = parse(test.input);
+    Compiler compiler;
+    compiler.compile(program.get());
+    auto instructions = compiler.getBytecode().instructions;
+    EXPECT_TRUE(testInstructions(test.expectedInstructions, instructions));
+    EXPECT_TRUE(testConstants(test.expectedConstants, compiler.getBytecode().constants));
+  }
+}
+
 TEST(Compiler, TestBooleanExpressions) {
   std::vector<CompilerTestCase<int>> tests{
       {
@@ -432,6 +502,16 @@ TEST(Compiler, TestStringExpressions) {
               Code::make(Ops::OpPop, {}),
           },
       },
+      {
+          R"("mon" + "mon")",
+          {"mon"},
+          {
+              Code::make(Ops::OpConstant, {0}),
+              Code::make(Ops::OpConstant, {0}),
+              Code::make(Ops::OpAdd, {}),
+              Code::make(Ops::OpPop, {}),
+          },
+      },
   };
 
   for (auto &&test : tests) {
@@ -494,6 +574,60 @@ TEST(Compiler, TestArrayLiterals) {
   }
 }
 
+TEST(Compiler, TestHashLiterals) {
+  std::vector<CompilerTestCase<int>> tests{
+      {
+          "{}",
+          {},
+          {
+              Code::make(Ops::OpHash, {0}),
+              Code::make(Ops::OpPop, {}),
+          },
+      },
+      {
+          "{1: 2, 3: 4, 5: 6}",
+          {1, 2, 3, 4, 5, 6},
+          {
+              Code::make(Ops::OpConstant, {0}),
+              Code::make(Ops::OpConstant, {1}),
+              Code::make(Ops::OpConstant, {2}),
+              Code::make(Ops::OpConstant, {3}),
+              Code::make(Ops::OpConstant, {4}),
+              Code::make(Ops::OpConstant, {5}),
+              Code::make(Ops::OpHash, {6}),
+              Code::make(Ops::OpPop, {}),
+          },
+      },
+      {
+          "{1: 2 + 3, 4: 5 * 6}[4]",
+          {1, 2, 3, 4, 5, 6, 4},
+          {
+              Code::make(Ops::OpConstant, {0}),
+              Code::make(Ops::OpConstant, {1}),
+              Code::make(Ops::OpConstant, {2}),
+              Code::make(Ops::OpAdd, {}),
+              Code::make(Ops::OpConstant, {3}),
+              Code::make(Ops::OpConstant, {4}),
+              Code::make(Ops::OpConstant, {5}),
+              Code::make(Ops::OpMul, {}),
+              Code::make(Ops::OpHash, {4}),
+              Code::make(Ops::OpConstant, {6}),
+              Code::make(Ops::OpIndex, {}),
+              Code::make(Ops::OpPop, {}),
+          },
+      },
+  };
+
+  for (auto &&test : tests) {
+    auto program = parse(test.input);
+    Compiler compiler;
+    compiler.compile(program.get());
+    auto instructions = compiler.getBytecode().instructions;
+    EXPECT_TRUE(testInstructions(test.expectedInstructions, instructions));
+    EXPECT_TRUE(testConstants(test.expectedConstants, compiler.getBytecode().constants));
+  }
+}
+
 TEST(Compiler, TestIndexExpressions) {
   std::vector<CompilerTestCase<int>> tests{
       {
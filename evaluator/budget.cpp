@@ -0,0 +1,13 @@
+#include "budget.hpp"
+
+#include <string>
+
+void Budget::start() {
+  nursery = &Nursery::current();
+  allocationBase = allocated();
+}
+
+const std::string &Budget::name(BudgetKind kind) {
+  static const std::string names[] = {"none", "fuel", "call depth", "allocations", "deadline"};
+  return names[static_cast<uint8_t>(kind)];
+}
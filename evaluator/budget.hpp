@@ -0,0 +1,136 @@
+#ifndef _EVALUATOR_BUDGET_HPP_
+#define _EVALUATOR_BUDGET_HPP_
+
+#include "nursery.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+/**
+ * @brief Which budget runs out
+ *
+ */
+enum class BudgetKind : uint8_t {
+  None,
+  Fuel,
+  Depth,
+  Allocations,
+  Deadline,
+};
+
+/**
+ * @brief Budget bounds one sandboxed run of `Evaluator`. Every evaluated
+ * node, and every element of a native loop such as `count`, burns one
+ * unit of fuel, and every function call takes one level of depth. The
+ * allocations are every runtime object the thread's `Nursery` allocates
+ * during the run, including the ones the builtins create, they are
+ * checked at each tick, so a builtin could overshoot by what one call
+ * allocates. The text of a string and the buffer of an unboxed array
+ * belong to their object, they are not counted on their own. The clock
+ * is expensive compared with a decrement, so the deadline is only
+ * checked every `ClockInterval` ticks.
+ *
+ * All the limits are unlimited by default. A budget is used up by one
+ * run, create a new one for the next run.
+ *
+ */
+class Budget {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr uint64_t Unlimited = std::numeric_limits<uint64_t>::max();
+  static constexpr uint32_t ClockInterval = 1024;
+
+  uint64_t fuel{Unlimited};
+  uint64_t maxDepth{Unlimited};
+  uint64_t maxAllocations{Unlimited};
+  Clock::time_point deadline{Clock::time_point::max()};
+
+  uint64_t depth{};
+  // The objects allocated during the run, as of the last tick
+  uint64_t allocations{};
+  BudgetKind exhausted{BudgetKind::None};
+
+private:
+  uint32_t clockCountdown{ClockInterval};
+
+  // The nursery the run allocates from, and its count before the run
+  const Nursery *nursery{nullptr};
+  uint64_t allocationBase{};
+
+  inline uint64_t allocated() const { return nursery->stats.allocations + nursery->stats.fallbacks; }
+
+public:
+  Budget() = default;
+
+  /**
+   * @brief count the allocations of the current thread from now on,
+   * `Evaluator::setBudget` calls it
+   *
+   */
+  void start();
+
+  /**
+   * @brief set the deadline `timeout` from now
+   *
+   */
+  inline void setTimeout(Clock::duration timeout) { deadline = Clock::now() + timeout; }
+
+  /**
+   * @brief burn the fuel for one node or one element
+   *
+   * @return false if any budget is exhausted
+   */
+  inline bool tick() {
+    if (fuel == 0) {
+      exhausted = BudgetKind::Fuel;
+      return false;
+    }
+    fuel--;
+
+    if (maxAllocations != Unlimited && nursery != nullptr) {
+      allocations = allocated() - allocationBase;
+      if (allocations > maxAllocations) {
+        exhausted = BudgetKind::Allocations;
+        return false;
+      }
+    }
+
+    if (--clockCountdown == 0) {
+      clockCountdown = ClockInterval;
+      if (Clock::now() >= deadline) {
+        exhausted = BudgetKind::Deadline;
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * @brief enter a function call, should be paired with `exitCall`
+   * when it succeeds.
+   *
+   * @return false if the call is too deep
+   */
+  inline bool enterCall() {
+    if (depth >= maxDepth) {
+      exhausted = BudgetKind::Depth;
+      return false;
+    }
+    depth++;
+    return true;
+  }
+
+  inline void exitCall() { depth--; }
+
+  /**
+   * @brief get the name of the budget used by the error message
+   *
+   */
+  static const std::string &name(BudgetKind kind);
+};
+
+#endif  // _EVALUATOR_BUDGET_HPP_
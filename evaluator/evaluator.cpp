@@ -1,8 +1,11 @@
 #include "evaluator.hpp"
 
 #include "ast.hpp"
+#include "budget.hpp"
 #include "builtins.hpp"
+#include "heap.hpp"
 #include "object.hpp"
+#include "profiler.hpp"
 #include "spdlog/spdlog.h"
 
 #include <iostream>
@@ -12,18 +15,134 @@
 #include <utility>
 #include <vector>
 
-constexpr std::string_view INTEGER_OBJ = "INTEGER";
-constexpr std::string_view BOOLEAN_OBJ = "BOOLEAN";
-constexpr std::string_view RETURN_VALUE_OBJ = "RETURN_VALUE";
-constexpr std::string_view ERROR_OBJ = "ERROR";
-constexpr std::string_view STRING_OBJ = "STRING";
-constexpr std::string_view ARRAY_OBJ = "ARRAY";
+Ref<Boolean> Evaluator::True = Boolean::of(true);
+Ref<Boolean> Evaluator::False = Boolean::of(false);
+thread_local Profiler *Evaluator::profiler = nullptr;
+thread_local Budget *Evaluator::budget = nullptr;
 
-std::shared_ptr<Boolean> Evaluator::True = std::make_shared<Boolean>(true);
-std::shared_ptr<Boolean> Evaluator::False = std::make_shared<Boolean>(false);
-std::vector<std::shared_ptr<Environment>> Evaluator::environments = {};
+static std::string typeName(const Ref<Object> &object);
 
-std::shared_ptr<Object> Evaluator::eval(Node *node, std::shared_ptr<Environment> &env) {
+static std::string typeName(const Ref<Object> &object) {
+  // Here, I don't use `Null` class, nullptr is the null value.
+  return object == nullptr ? "NULL" : object->type();
+}
+
+EvalResult EvalResult::error(ErrorCode c,
+                             std::string o,
+                             Ref<Object> left,
+                             Ref<Object> right) {
+  EvalResult result{};
+  result.signal = Signal::Error;
+  result.code = c;
+  result.op = std::move(o);
+  result.value = std::move(left);
+  result.other = std::move(right);
+  return result;
+}
+
+std::string EvalResult::message() const {
+  switch (code) {
+    case ErrorCode::UnknownPrefixOperator:
+      return "unknown operator: " + op + typeName(value);
+    case ErrorCode::UnknownInfixOperator:
+      return "unknown operator: " + typeName(value) + " " + op + " " + typeName(other);
+    case ErrorCode::TypeMismatch:
+      return "type mismatch: " + typeName(value) + " " + op + " " + typeName(other);
+    case ErrorCode::IdentifierNotFound:
+      return "identifier not found: " + op;
+    case ErrorCode::NotAFunction:
+      return "not a function: " + typeName(value);
+    case ErrorCode::IndexNotSupported:
+      return "index operator not supported: " + typeName(value);
+    case ErrorCode::UnusableHashKey:
+      return "unusable as hash key: " + typeName(value);
+    case ErrorCode::BudgetExhausted:
+      return "budget exhausted: " + op;
+    case ErrorCode::Native:
+      return static_cast<Error *>(value.get())->message;
+    default:
+      return "";
+  }
+}
+
+Ref<Object> Evaluator::eval(Node *node, Ref<Environment> &env) {
+  auto result = evalNode(node, env);
+  return unwrap(result);
+}
+
+/**
+ * @brief EvaluatorCaller calls the functions for the builtins such as
+ * `map`, the errors are returned as the `Error` objects so the builtin
+ * stops and the evaluator reports them as its own.
+ *
+ */
+class EvaluatorCaller : public Caller {
+public:
+  Value call(const Value &fn, const Value *values, std::size_t count) override {
+    // The builtins check their own arity
+    if (fn.is<Function>() && fn.as<Function>()->parameters.size() != count) {
+      return makeRef<Error>("wrong number of arguments. got=" + std::to_string(count) +
+                            ", want=" + std::to_string(fn.as<Function>()->parameters.size()));
+    }
+
+    Ref<Object> function = fn.toObject();
+    std::vector<Ref<Object>> arguments{};
+    arguments.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+      arguments.push_back(values[i].toObject());
+    }
+
+    auto result = Evaluator::evalFunctions(function, arguments);
+    return Evaluator::unwrap(result);
+  }
+
+  bool tick(Value &error) override {
+    if (Evaluator::budget != nullptr && !Evaluator::budget->tick()) {
+      error = makeRef<BudgetError>(Budget::name(Evaluator::budget->exhausted));
+      return false;
+    }
+    return true;
+  }
+};
+
+static EvaluatorCaller caller{};
+
+Ref<Object> Evaluator::unwrap(EvalResult &result) {
+  if (result.signal != Signal::Error) {
+    return std::move(result.value);
+  }
+
+  if (result.code == ErrorCode::Native) {
+    return std::move(result.value);
+  }
+
+  if (result.code == ErrorCode::BudgetExhausted) {
+    return makeRef<BudgetError>(result.op);
+  }
+
+  return makeRef<Error>(result.message());
+}
+
+EvalResult Evaluator::budgetExhausted() {
+  return EvalResult::error(ErrorCode::BudgetExhausted, Budget::name(budget->exhausted), nullptr);
+}
+
+EvalResult Evaluator::evalNode(Node *node, Ref<Environment> &env) {
+  if (budget != nullptr && !budget->tick()) {
+    return budgetExhausted();
+  }
+
+  if (profiler == nullptr) {
+    return dispatch(node, env);
+  }
+
+  profiler->enterNode(node);
+  auto result = dispatch(node, env);
+  profiler->exitNode();
+  return result;
+}
+
+EvalResult Evaluator::dispatch(Node *node, Ref<Environment> &env) {
   Program *program = dynamic_cast<Program *>(node);
 
   if (program != nullptr) {
@@ -33,55 +152,80 @@ std::shared_ptr<Object> Evaluator::eval(Node *node, std::shared_ptr<Environment>
   ExpressionStatement *expressionStatement = dynamic_cast<ExpressionStatement *>(node);
 
   if (expressionStatement != nullptr) {
-    return std::move(eval(expressionStatement->expression.get(), env));
+    return evalNode(expressionStatement->expression.get(), env);
   }
 
   BlockStatement *blockStatement = dynamic_cast<BlockStatement *>(node);
   if (blockStatement != nullptr) {
-    return std::move(evalBlockStatement(blockStatement, env));
+    return evalBlockStatement(blockStatement, env);
   }
 
   IntegerLiteral *integer = dynamic_cast<IntegerLiteral *>(node);
 
   if (integer != nullptr) {
-    return std::move(std::make_unique<Integer>(integer->value));
+    if (integer->object == nullptr) {
+      integer->object = Integer::of(integer->value);
+    }
+    return integer->object.cast<Object>();
+  }
+
+  FloatLiteral *floatLiteral = dynamic_cast<FloatLiteral *>(node);
+  if (floatLiteral != nullptr) {
+    if (floatLiteral->object == nullptr) {
+      floatLiteral->object = makeRef<Float>(floatLiteral->value);
+    }
+    return floatLiteral->object.cast<Object>();
   }
 
   BooleanExpression *booleanExpression = dynamic_cast<BooleanExpression *>(node);
   if (booleanExpression != nullptr) {
-    return std::move(std::make_unique<Boolean>(booleanExpression->value));
+    return booleanExpression->value ? True : False;
   }
 
   PrefixExpression *prefixExpression = dynamic_cast<PrefixExpression *>(node);
   if (prefixExpression != nullptr) {
-    auto right = eval(prefixExpression->right.get(), env);
-    return std::move(evalPrefixExpression(prefixExpression->_operator, right));
+    auto right = evalNode(prefixExpression->right.get(), env);
+    if (!right.isNormal()) {
+      return right;
+    }
+    return evalPrefixExpression(prefixExpression->_operator, right.value);
   }
 
   InfixExpression *infixExpression = dynamic_cast<InfixExpression *>(node);
   if (infixExpression != nullptr) {
-    auto left = eval(infixExpression->left.get(), env);
-    auto right = eval(infixExpression->right.get(), env);
-    return evalInfixExpression(infixExpression->_operator, left, right);
+    auto left = evalNode(infixExpression->left.get(), env);
+    if (!left.isNormal()) {
+      return left;
+    }
+    auto right = evalNode(infixExpression->right.get(), env);
+    if (!right.isNormal()) {
+      return right;
+    }
+    return evalInfixExpression(infixExpression->_operator, left.value, right.value);
   }
 
   IfExpression *ifExpression = dynamic_cast<IfExpression *>(node);
   if (ifExpression != nullptr) {
-    return std::move(evalIfExpression(ifExpression, env));
+    return evalIfExpression(ifExpression, env);
   }
 
   ReturnStatement *returnStatement = dynamic_cast<ReturnStatement *>(node);
   if (returnStatement != nullptr) {
-    auto val = eval(returnStatement->returnValue.get(), env);
-    auto returnValue = std::make_shared<ReturnValue>();
-    returnValue->value = val;
-    return std::move(returnValue);
+    auto result = evalNode(returnStatement->returnValue.get(), env);
+    if (result.isNormal()) {
+      result.signal = Signal::Return;
+    }
+    return result;
   }
 
   LetStatement *letStatement = dynamic_cast<LetStatement *>(node);
   if (letStatement != nullptr) {
-    auto val = eval(letStatement->value.get(), env);
-    env->set(letStatement->name->value, std::move(val));
+    auto result = evalNode(letStatement->value.get(), env);
+    if (!result.isNormal()) {
+      return result;
+    }
+    env->set(letStatement->name->value, std::move(result.value));
+    return nullptr;
   }
 
   Identifier *identifier = dynamic_cast<Identifier *>(node);
@@ -92,286 +236,421 @@ std::shared_ptr<Object> Evaluator::eval(Node *node, std::shared_ptr<Environment>
   FunctionLiteral *functionLiteral = dynamic_cast<FunctionLiteral *>(node);
   if (functionLiteral != nullptr) {
     auto function =
-        std::make_shared<Function>(std::move(functionLiteral->parameters), std::move(functionLiteral->body), env);
+        makeRef<Function>(std::move(functionLiteral->parameters), std::move(functionLiteral->body), env);
     return function;
   }
 
   CallExpression *callExpression = dynamic_cast<CallExpression *>(node);
   if (callExpression != nullptr) {
-    auto function = eval(callExpression->function.get(), env);
-    auto arguments = evalExpressions(callExpression->arguments, env);
-    return evalFunctions(function.get(), arguments);
+    auto function = evalNode(callExpression->function.get(), env);
+    if (!function.isNormal()) {
+      return function;
+    }
+    std::vector<Ref<Object>> arguments{};
+    auto error = evalExpressions(callExpression->arguments, env, arguments);
+    if (!error.isNormal()) {
+      return error;
+    }
+    if (profiler == nullptr) {
+      return evalFunctions(function.value, arguments);
+    }
+
+    profiler->enterFunction(callExpression->function.get(), function.value.get());
+    auto result = evalFunctions(function.value, arguments);
+    profiler->exitFunction();
+    return result;
   }
 
   StringLiteral *stringLiteral = dynamic_cast<StringLiteral *>(node);
   if (stringLiteral != nullptr) {
-    return std::make_shared<String>(stringLiteral->value);
+    if (stringLiteral->object == nullptr) {
+      stringLiteral->object = Interner::current().intern(stringLiteral->value);
+    }
+    return stringLiteral->object.cast<Object>();
   }
 
   ArrayLiteral *arrayLiteral = dynamic_cast<ArrayLiteral *>(node);
   if (arrayLiteral != nullptr) {
-    auto elements = evalExpressions(arrayLiteral->elements, env);
-    auto result = std::make_shared<Array>();
-    result->elements = std::move(elements);
-    return result;
+    std::vector<Ref<Object>> elements{};
+    auto error = evalExpressions(arrayLiteral->elements, env, elements);
+    if (!error.isNormal()) {
+      return error;
+    }
+    return Array::from(elements.data(), elements.size());
   }
 
   IndexExpression *indexExpression = dynamic_cast<IndexExpression *>(node);
   if (indexExpression != nullptr) {
-    auto left = eval(indexExpression->left.get(), env);
-    auto index = eval(indexExpression->index.get(), env);
-    return evalIndexExpression(left, index);
+    auto left = evalNode(indexExpression->left.get(), env);
+    if (!left.isNormal()) {
+      return left;
+    }
+    auto index = evalNode(indexExpression->index.get(), env);
+    if (!index.isNormal()) {
+      return index;
+    }
+    return evalIndexExpression(left.value, index.value);
+  }
+
+  HashLiteral *hashLiteral = dynamic_cast<HashLiteral *>(node);
+  if (hashLiteral != nullptr) {
+    std::vector<Ref<Object>> pairs{};
+    pairs.reserve(hashLiteral->pairs.size() * 2);
+    for (auto &&[key, value] : hashLiteral->pairs) {
+      auto evaluatedKey = evalNode(key.get(), env);
+      if (!evaluatedKey.isNormal()) {
+        return evaluatedKey;
+      }
+      pairs.push_back(std::move(evaluatedKey.value));
+
+      auto evaluatedValue = evalNode(value.get(), env);
+      if (!evaluatedValue.isNormal()) {
+        return evaluatedValue;
+      }
+      pairs.push_back(std::move(evaluatedValue.value));
+    }
+    return buildHash(pairs.data(), pairs.size());
   }
 
   return nullptr;
 }
 
-std::shared_ptr<Object> Evaluator::evalProgram(std::vector<std::unique_ptr<Statement>> &statements,
-                                               std::shared_ptr<Environment> &env) {
-  std::shared_ptr<Object> result{};
+EvalResult Evaluator::evalProgram(std::vector<std::unique_ptr<Statement>> &statements,
+                                  Ref<Environment> &env) {
+  EvalResult result{};
 
   for (auto &&statement : statements) {
-    result = std::move(eval(statement.get(), env));
+    result = evalNode(statement.get(), env);
 
-    ReturnValue *returnValue = dynamic_cast<ReturnValue *>(result.get());
-    if (returnValue != nullptr) {
-      return std::move(returnValue->value);
+    if (result.signal == Signal::Return) {
+      result.signal = Signal::Normal;
+      return result;
     }
 
-    Error *error = dynamic_cast<Error *>(result.get());
-    if (error != nullptr) {
-      return std::move(result);
+    if (result.signal == Signal::Error) {
+      return result;
     }
   }
 
-  return std::move(result);
+  return result;
 }
 
-std::shared_ptr<Object> Evaluator::evalPrefixExpression(const std::string &op, std::shared_ptr<Object> &right) {
+EvalResult Evaluator::evalPrefixExpression(const std::string &op, Ref<Object> &right) {
   if (op == "!") {
     return evalBangOperationExpression(right);
   } else if (op == "-") {
-    return std::move(evalMinusOperationExpression(right));
+    return evalMinusOperationExpression(op, right);
   }
-  return newError("unkown operator: " + op + right->type());
+  return EvalResult::error(ErrorCode::UnknownPrefixOperator, op, right);
 }
 
-std::shared_ptr<Object> Evaluator::evalBangOperationExpression(std::shared_ptr<Object> &right) {
-  Boolean *boolean = dynamic_cast<Boolean *>(right.get());
-
+EvalResult Evaluator::evalBangOperationExpression(Ref<Object> &right) {
   // Here, I don't use `Null` class, I just use `nullptr`
   // for simplicity.
-  if (boolean == nullptr) {
-    return std::shared_ptr<Boolean>(False);
+  if (right == nullptr || !right->is<Boolean>()) {
+    return False;
   }
 
-  if (!boolean->value) {
-    return std::shared_ptr<Boolean>(True);
+  if (!right->as<Boolean>()->value) {
+    return True;
   }
 
-  return std::shared_ptr<Boolean>(False);
+  return False;
 }
 
-std::shared_ptr<Object> Evaluator::evalMinusOperationExpression(std::shared_ptr<Object> &right) {
-  if (right->type() != INTEGER_OBJ) {
-    return newError("unknown operator: -" + right->type());
+EvalResult Evaluator::evalMinusOperationExpression(const std::string &op, Ref<Object> &right) {
+  if (right != nullptr && right->is<Float>()) {
+    return makeRef<Float>(-right->as<Float>()->value);
   }
 
-  Integer *integer = dynamic_cast<Integer *>(right.get());
+  if (right == nullptr || !right->is<Integer>()) {
+    return EvalResult::error(ErrorCode::UnknownPrefixOperator, op, right);
+  }
+
+  return Integer::of(-right->as<Integer>()->value);
+}
 
-  return std::make_shared<Integer>(-integer->value);
+EvalResult Evaluator::evalInfixExpression(const std::string &op,
+                                          Ref<Object> &left,
+                                          Ref<Object> &right) {
+  if (left == nullptr || right == nullptr) {
+    return EvalResult::error(ErrorCode::TypeMismatch, op, left, right);
+  }
+
+  auto leftKind = left->kind;
+  auto rightKind = right->kind;
+
+  if (leftKind == ObjectKind::Integer && rightKind == ObjectKind::Integer) {
+    return evalIntegerInfixExpression(op, left, right);
+  } else if ((leftKind == ObjectKind::Float || leftKind == ObjectKind::Integer) &&
+             (rightKind == ObjectKind::Float || rightKind == ObjectKind::Integer)) {
+    return evalFloatInfixExpression(op, left, right);
+  } else if (leftKind == ObjectKind::Boolean && rightKind == ObjectKind::Boolean) {
+    return evalBooleanInfixExpression(op, left, right);
+  } else if (leftKind == ObjectKind::String && rightKind == ObjectKind::String) {
+    return evalStringInfixExpression(op, left, right);
+  } else if (leftKind != rightKind) {
+    return EvalResult::error(ErrorCode::TypeMismatch, op, left, right);
+  }
+  return EvalResult::error(ErrorCode::UnknownInfixOperator, op, left, right);
+}
+
+EvalResult Evaluator::evalIntegerInfixExpression(const std::string &op,
+                                                 Ref<Object> &left,
+                                                 Ref<Object> &right) {
+  Integer *leftInteger = left->as<Integer>();
+  Integer *rightInteger = right->as<Integer>();
+
+  if (op == "+") {
+    return Integer::of(leftInteger->value + rightInteger->value);
+  } else if (op == "-") {
+    return Integer::of(leftInteger->value - rightInteger->value);
+  } else if (op == "*") {
+    return Integer::of(leftInteger->value * rightInteger->value);
+  } else if (op == "/") {
+    return Integer::of(leftInteger->value / rightInteger->value);
+  } else if (op == "<") {
+    return leftInteger->value < rightInteger->value ? True : False;
+  } else if (op == ">") {
+    return leftInteger->value > rightInteger->value ? True : False;
+  } else if (op == "==") {
+    return leftInteger->value == rightInteger->value ? True : False;
+  } else if (op == "!=") {
+    return leftInteger->value != rightInteger->value ? True : False;
+  }
+  return EvalResult::error(ErrorCode::UnknownInfixOperator, op, left, right);
 }
 
-std::shared_ptr<Object> Evaluator::evalInfixExpression(const std::string &op,
-                                                       std::shared_ptr<Object> &left,
-                                                       std::shared_ptr<Object> &right) {
-  if (left->type() == INTEGER_OBJ && right->type() == INTEGER_OBJ) {
-    return std::move(evalIntegerInfixExpression(op, left, right));
-  } else if (left->type() == BOOLEAN_OBJ && right->type() == BOOLEAN_OBJ) {
-    return std::move(evalBooleanInfixExpression(op, left, right));
-  } else if (left->type() == STRING_OBJ && right->type() == STRING_OBJ) {
-    return std::move(evalStringInfixExpression(op, left, right));
-  } else if (left->type() != right->type()) {
-    return newError("type mismatch: " + left->type() + " " + op + " " + right->type());
-  }
-  return newError("unknown operator: " + left->type() + " " + op + " " + right->type());
+/**
+ * @brief the integer or the float promoted to double
+ *
+ */
+static inline double numberOf(const Object *object) {
+  return object->is<Float>() ? object->as<Float>()->value : static_cast<double>(object->as<Integer>()->value);
 }
 
-std::shared_ptr<Object> Evaluator::evalIntegerInfixExpression(const std::string &op,
-                                                              std::shared_ptr<Object> &left,
-                                                              std::shared_ptr<Object> &right) {
-  Integer *leftInteger = dynamic_cast<Integer *>(left.get());
-  Integer *rightInteger = dynamic_cast<Integer *>(right.get());
+EvalResult Evaluator::evalFloatInfixExpression(const std::string &op,
+                                               Ref<Object> &left,
+                                               Ref<Object> &right) {
+  double leftFloat = numberOf(left.get());
+  double rightFloat = numberOf(right.get());
 
   if (op == "+") {
-    return std::make_shared<Integer>(leftInteger->value + rightInteger->value);
+    return makeRef<Float>(leftFloat + rightFloat);
   } else if (op == "-") {
-    return std::make_shared<Integer>(leftInteger->value - rightInteger->value);
+    return makeRef<Float>(leftFloat - rightFloat);
   } else if (op == "*") {
-    return std::make_shared<Integer>(leftInteger->value * rightInteger->value);
+    return makeRef<Float>(leftFloat * rightFloat);
   } else if (op == "/") {
-    return std::make_shared<Integer>(leftInteger->value / rightInteger->value);
+    return makeRef<Float>(leftFloat / rightFloat);
   } else if (op == "<") {
-    return leftInteger->value < rightInteger->value ? std::shared_ptr<Boolean>(True) : std::shared_ptr<Boolean>(False);
+    return leftFloat < rightFloat ? True : False;
   } else if (op == ">") {
-    return leftInteger->value > rightInteger->value ? std::shared_ptr<Boolean>(True) : std::shared_ptr<Boolean>(False);
+    return leftFloat > rightFloat ? True : False;
   } else if (op == "==") {
-    return leftInteger->value == rightInteger->value ? std::shared_ptr<Boolean>(True) : std::shared_ptr<Boolean>(False);
+    return leftFloat == rightFloat ? True : False;
   } else if (op == "!=") {
-    return leftInteger->value != rightInteger->value ? std::shared_ptr<Boolean>(True) : std::shared_ptr<Boolean>(False);
+    return leftFloat != rightFloat ? True : False;
   }
-  return newError("unknown operator: " + left->type() + " " + op + " " + right->type());
+  return EvalResult::error(ErrorCode::UnknownInfixOperator, op, left, right);
 }
 
-std::shared_ptr<Object> Evaluator::evalBooleanInfixExpression(const std::string &op,
-                                                              std::shared_ptr<Object> &left,
-                                                              std::shared_ptr<Object> &right) {
-  Boolean *leftBoolean = dynamic_cast<Boolean *>(left.get());
-  Boolean *rightBoolean = dynamic_cast<Boolean *>(right.get());
+EvalResult Evaluator::evalBooleanInfixExpression(const std::string &op,
+                                                 Ref<Object> &left,
+                                                 Ref<Object> &right) {
+  Boolean *leftBoolean = left->as<Boolean>();
+  Boolean *rightBoolean = right->as<Boolean>();
 
   if (op == "==") {
-    return leftBoolean->value == rightBoolean->value ? std::shared_ptr<Boolean>(True) : std::shared_ptr<Boolean>(False);
+    return leftBoolean->value == rightBoolean->value ? True : False;
   } else if (op == "!=") {
-    return leftBoolean->value != rightBoolean->value ? std::shared_ptr<Boolean>(True) : std::shared_ptr<Boolean>(False);
+    return leftBoolean->value != rightBoolean->value ? True : False;
   }
 
-  return newError("unknown operator: " + left->type() + " " + op + " " + right->type());
+  return EvalResult::error(ErrorCode::UnknownInfixOperator, op, left, right);
 }
 
-std::shared_ptr<Object> Evaluator::evalStringInfixExpression(const std::string &op,
-                                                             std::shared_ptr<Object> &left,
-                                                             std::shared_ptr<Object> &right) {
-  if (op != "+") {
-    return newError("unknown operator: " + left->type() + " " + op + " " + right->type());
+EvalResult Evaluator::evalStringInfixExpression(const std::string &op,
+                                                Ref<Object> &left,
+                                                Ref<Object> &right) {
+  if (op == "==") {
+    return left->as<String>()->equals(right->as<String>()) ? True : False;
+  } else if (op == "!=") {
+    return left->as<String>()->equals(right->as<String>()) ? False : True;
+  } else if (op != "+") {
+    return EvalResult::error(ErrorCode::UnknownInfixOperator, op, left, right);
   }
 
-  String *leftString = dynamic_cast<String *>(left.get());
-  String *rightString = dynamic_cast<String *>(right.get());
+  String *leftString = left->as<String>();
+  String *rightString = right->as<String>();
 
-  return std::make_shared<String>(leftString->value + rightString->value);
+  return String::concat(leftString, rightString);
 }
 
-std::shared_ptr<Object> Evaluator::evalIfExpression(IfExpression *ie, std::shared_ptr<Environment> &env) {
-  auto condition = eval(ie->condition.get(), env);
+EvalResult Evaluator::evalIfExpression(IfExpression *ie, Ref<Environment> &env) {
+  auto condition = evalNode(ie->condition.get(), env);
+  if (!condition.isNormal()) {
+    return condition;
+  }
 
-  if (condition == nullptr) {
+  if (condition.value == nullptr) {
     // Here, if the condition is nullptr, means it is falsy.
     // Corner case.
     if (ie->alternative != nullptr) {
-      return eval(ie->alternative.get(), env);
+      return evalNode(ie->alternative.get(), env);
     }
+    return nullptr;
   }
 
-  Boolean *result = dynamic_cast<Boolean *>(condition.get());
+  Object *object = condition.value.get();
 
   // Corner case: if (1) {10} else {20}
-  Integer *integer = dynamic_cast<Integer *>(condition.get());
-
-  if (result == nullptr && integer != nullptr) {
-    if (integer->value != 0) {
-      return eval(ie->consequence.get(), env);
-    } else {
-      return eval(ie->alternative.get(), env);
+  if (object->is<Integer>()) {
+    if (object->as<Integer>()->value != 0) {
+      return evalNode(ie->consequence.get(), env);
+    } else if (ie->alternative != nullptr) {
+      return evalNode(ie->alternative.get(), env);
     }
-  } else if (!result->value) {
+  } else if (object->is<Boolean>() && !object->as<Boolean>()->value) {
     if (ie->alternative != nullptr) {
-      return eval(ie->alternative.get(), env);
+      return evalNode(ie->alternative.get(), env);
     }
   } else {
-    return eval(ie->consequence.get(), env);
+    return evalNode(ie->consequence.get(), env);
   }
 
   return nullptr;
 }
 
-std::shared_ptr<Object> Evaluator::evalBlockStatement(BlockStatement *bs, std::shared_ptr<Environment> &env) {
-  std::shared_ptr<Object> result{};
+EvalResult Evaluator::evalBlockStatement(BlockStatement *bs, Ref<Environment> &env) {
+  EvalResult result{};
 
   for (auto &&statement : bs->statements) {
-    result = eval(statement.get(), env);
+    result = evalNode(statement.get(), env);
 
-    if (result != nullptr) {
-      if (result->type() == RETURN_VALUE_OBJ || result->type() == ERROR_OBJ)
-        return result;
+    if (!result.isNormal()) {
+      return result;
     }
   }
 
   return result;
 }
 
-std::shared_ptr<Object> Evaluator::evalIdentifier(Identifier *i, std::shared_ptr<Environment> &env) {
+EvalResult Evaluator::evalIdentifier(Identifier *i, Ref<Environment> &env) {
   auto result = env->get(i->value);
   if (result == nullptr) {
-    auto builtin = Builtins::getBuiltins()[i->value];
+    auto builtin = Builtins::lookup(i->value);
     if (builtin != nullptr) {
       return builtin;
     }
-    return std::make_shared<Error>("identifier not found: " + i->value);
+    return EvalResult::error(ErrorCode::IdentifierNotFound, i->value, nullptr);
   }
   return result;
 }
 
-std::shared_ptr<Error> Evaluator::newError(const std::string &s) { return std::make_shared<Error>(s); }
-
-std::vector<std::shared_ptr<Object>> Evaluator::evalExpressions(std::vector<std::unique_ptr<Expression>> &arguments,
-                                                                std::shared_ptr<Environment> &env) {
-  std::vector<std::shared_ptr<Object>> results{};
+EvalResult Evaluator::evalExpressions(std::vector<std::unique_ptr<Expression>> &arguments,
+                                      Ref<Environment> &env,
+                                      std::vector<Ref<Object>> &results) {
+  results.reserve(arguments.size());
 
   for (auto &&argument : arguments) {
-    auto evaluated = eval(argument.get(), env);
-    results.push_back(evaluated);
+    auto evaluated = evalNode(argument.get(), env);
+    if (!evaluated.isNormal()) {
+      return evaluated;
+    }
+    results.push_back(std::move(evaluated.value));
   }
 
-  return results;
+  return nullptr;
 }
 
-std::shared_ptr<Object> Evaluator::evalFunctions(Object *fn, std::vector<std::shared_ptr<Object>> &arguments) {
-  Function *function = dynamic_cast<Function *>(fn);
-  if (function == nullptr) {
-    Builtin *builtin = dynamic_cast<Builtin *>(fn);
-    if (builtin != nullptr) {
-      return builtin->fn(arguments);
+EvalResult Evaluator::evalFunctions(Ref<Object> &fn, std::vector<Ref<Object>> &arguments) {
+  if (fn == nullptr || !fn->is<Function>()) {
+    if (fn != nullptr && fn->is<Builtin>()) {
+      std::vector<Value> values(arguments.begin(), arguments.end());
+      auto value = fn->as<Builtin>()->call(Arguments{values.data(), values.size(), &caller});
+      // Builtins report the errors with the `Error` object.
+      if (value.is<Error>()) {
+        return EvalResult::error(ErrorCode::Native, {}, value.toObject());
+      }
+      return value.toObject();
     }
-    return newError("not a function: " + fn->type());
+    return EvalResult::error(ErrorCode::NotAFunction, {}, fn);
+  }
+  Function *function = fn->as<Function>();
+
+  // Every recursion goes through a call, it is where the cycles are
+  // collected. Everything in use is referenced by the locals here.
+  Heap::current().poll();
+
+  if (budget != nullptr && !budget->enterCall()) {
+    return budgetExhausted();
   }
 
-  auto extendedEnv = std::make_shared<Environment>(function->env.lock());
+  auto extendedEnv = makeRef<Environment>(function->env);
 
   int i = 0;
   for (auto &&parameter : function->parameters) {
     extendedEnv->set(parameter->value, arguments[i++]);
   }
 
-  auto evaluated = eval(function->body.get(), extendedEnv);
+  auto evaluated = evalNode(function->body.get(), extendedEnv);
 
-  // Here, we must push this ptr into the environ vector, because we use
-  // weak_ptr for function, we should keep its lifetime.
-  environments.push_back(extendedEnv);
+  if (budget != nullptr) {
+    budget->exitCall();
+  }
 
-  ReturnValue *returnValue = dynamic_cast<ReturnValue *>(evaluated.get());
-  if (returnValue != nullptr) {
-    return returnValue->value;
+  // The return stops at the function boundary.
+  if (evaluated.signal == Signal::Return) {
+    evaluated.signal = Signal::Normal;
   }
   return evaluated;
 }
 
-std::shared_ptr<Object> Evaluator::evalIndexExpression(std::shared_ptr<Object> left, std::shared_ptr<Object> index) {
-  if (left->type() == ARRAY_OBJ && index->type() == INTEGER_OBJ) {
+EvalResult Evaluator::evalIndexExpression(Ref<Object> left, Ref<Object> index) {
+  if (left != nullptr && index != nullptr && left->is<Array>() && index->is<Integer>()) {
     return evalArrayIndexExpression(left, index);
   }
+  if (left != nullptr && left->is<Hash>()) {
+    return evalHashIndexExpression(left, index);
+  }
 
-  return newError("index operator not supported: " + left->type());
+  return EvalResult::error(ErrorCode::IndexNotSupported, {}, left);
 }
 
-std::shared_ptr<Object> Evaluator::evalArrayIndexExpression(std::shared_ptr<Object> left,
-                                                            std::shared_ptr<Object> index) {
-  Array *array = dynamic_cast<Array *>(left.get());
+EvalResult Evaluator::evalArrayIndexExpression(Ref<Object> left, Ref<Object> index) {
+  Array *array = left->as<Array>();
+  Integer *integer = index->as<Integer>();
+
+  if (integer->value < 0 || integer->value >= static_cast<int64_t>(array->size())) {
+    return nullptr;
+  }
+
+  return array->get(integer->value);
+}
 
-  Integer *integer = dynamic_cast<Integer *>(index.get());
+EvalResult Evaluator::evalHashIndexExpression(Ref<Object> left, Ref<Object> index) {
+  if (!HashTable::hashable(index.get())) {
+    return EvalResult::error(ErrorCode::UnusableHashKey, {}, index);
+  }
 
-  if (integer->value < 0 || integer->value > array->elements.size() - 1) {
+  auto value = left->as<Hash>()->pairs.find(index.get());
+  if (value == nullptr) {
     return nullptr;
   }
+  return *value;
+}
+
+EvalResult Evaluator::buildHash(Ref<Object> *pairs, std::size_t count) {
+  auto hash = makeRef<Hash>();
+  hash->pairs.reserve(count / 2);
+
+  for (std::size_t i = 0; i < count; i += 2) {
+    if (!HashTable::hashable(pairs[i].get())) {
+      return EvalResult::error(ErrorCode::UnusableHashKey, {}, pairs[i]);
+    }
+    hash->pairs.set(pairs[i], pairs[i + 1]);
+  }
 
-  return array->elements[integer->value];
+  return hash;
 }
@@ -2,38 +2,177 @@
 #define _EVALUATOR_EVALUATOR_HPP_
 
 #include "ast.hpp"
+#include "budget.hpp"
 #include "object.hpp"
+#include "profiler.hpp"
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+/**
+ * @brief How the control leaves a node. Most of the nodes finish
+ * normally, `return` unwinds to the function boundary and an error
+ * unwinds to the top level.
+ *
+ */
+enum class Signal : uint8_t {
+  Normal,
+  Return,
+  Error,
+};
+
+/**
+ * @brief The kind of the error. We don't build the message when the
+ * error happens, it is only formatted when the error reaches the
+ * top level.
+ *
+ */
+enum class ErrorCode : uint8_t {
+  None,
+  UnknownPrefixOperator,
+  UnknownInfixOperator,
+  TypeMismatch,
+  IdentifierNotFound,
+  NotAFunction,
+  IndexNotSupported,
+  UnusableHashKey,
+  BudgetExhausted,
+  Native,  // the `Error` object is already built, for example by builtins
+};
+
+/**
+ * @brief EvalResult is the value travelling alongside its control signal,
+ * so `return` and errors need neither wrapper objects nor RTTI checks.
+ * For an error, `value` and `other` hold the operands needed by the
+ * message, and `op` holds a copy of the operator or the identifier name,
+ * the AST of a function could be freed before the message is formatted.
+ *
+ */
+struct EvalResult {
+  Signal signal{Signal::Normal};
+  ErrorCode code{ErrorCode::None};
+  std::string op{};
+  Ref<Object> value{};
+  Ref<Object> other{};
+
+  EvalResult() = default;
+  EvalResult(std::nullptr_t) {}
+  template <typename T>
+  EvalResult(Ref<T> v) : value{std::move(v)} {}
+
+  inline bool isNormal() const { return signal == Signal::Normal; }
+
+  /**
+   * @brief build an error result
+   *
+   * @param c the error code
+   * @param o the operator or the identifier name
+   * @param left the left (or the only) operand
+   * @param right the right operand
+   * @return EvalResult
+   */
+  static EvalResult error(ErrorCode c,
+                          std::string o,
+                          Ref<Object> left,
+                          Ref<Object> right = nullptr);
+
+  /**
+   * @brief format the error message
+   *
+   * @return std::string
+   */
+  std::string message() const;
+};
+
 class Evaluator {
 private:
-  static std::shared_ptr<Boolean> True;
-  static std::shared_ptr<Boolean> False;
+  static Ref<Boolean> True;
+  static Ref<Boolean> False;
 
-  static std::vector<std::shared_ptr<Environment>> environments;
+  // Profiling is opt-in, nullptr means disabled. Like the heap, both are
+  // per thread, so the runs on other threads are not affected.
+  static thread_local Profiler *profiler;
+
+  // The budget of a sandboxed run, nullptr means unlimited.
+  static thread_local Budget *budget;
+
+  friend class StackEvaluator;
+  friend class EvaluatorCaller;
+
+  /**
+   * @brief evaluate the node without the profiling hooks
+   *
+   */
+  static EvalResult dispatch(Node *node, Ref<Environment> &env);
+
+  /**
+   * @brief build the error for the exhausted budget
+   *
+   */
+  static EvalResult budgetExhausted();
 
 public:
   /**
-   * @brief evaluate the node
+   * @brief enable the profiling of the current thread with `p`, or
+   * disable it with nullptr. The profiler is not owned by the evaluator.
+   *
+   */
+  static inline void setProfiler(Profiler *p) { profiler = p; }
+
+  /**
+   * @brief bound the next run of the current thread with `b`, or remove
+   * the bound with nullptr. When the budget runs out, the run stops with
+   * `BudgetError`. The budget is not owned by the evaluator.
+   *
+   */
+  static inline void setBudget(Budget *b) {
+    budget = b;
+    if (budget != nullptr) {
+      budget->start();
+    }
+  }
+
+  /**
+   * @brief evaluate the node, this is the top level entry. An error
+   * which reaches here is turned into the `Error` object.
    *
    * @param node the unique_ptr parsed by `Parser::program()`
    * @param env the environment
-   * @return std::shared_ptr<Object>
+   * @return Ref<Object>
+   */
+  static Ref<Object> eval(Node *node, Ref<Environment> &env);
+
+  /**
+   * @brief evaluate the node recursively
+   *
+   * @param node the node
+   * @param env the environment
+   * @return EvalResult
+   */
+  static EvalResult evalNode(Node *node, Ref<Environment> &env);
+
+  /**
+   * @brief turn the result into the object, an error is formatted
+   * into the `Error` object.
+   *
+   * @param result the evaluated result
+   * @return Ref<Object>
    */
-  static std::shared_ptr<Object> eval(Node *node, std::shared_ptr<Environment> &env);
+  static Ref<Object> unwrap(EvalResult &result);
 
   /**
    * @brief iteratively evaluate the program
    *
    * @param statements
    * @param env
-   * @return std::shared_ptr<Object>
+   * @return EvalResult
    */
-  static std::shared_ptr<Object> evalProgram(std::vector<std::unique_ptr<Statement>> &statements,
-                                             std::shared_ptr<Environment> &env);
+  static EvalResult evalProgram(std::vector<std::unique_ptr<Statement>> &statements,
+                                Ref<Environment> &env);
 
   /**
    * @brief First calculate the right object, and then calculate
@@ -41,25 +180,26 @@ public:
    *
    * @param op the prefix operation
    * @param right the right evaluated object
-   * @return std::shared_ptr<Object>
+   * @return EvalResult
    */
-  static std::shared_ptr<Object> evalPrefixExpression(const std::string &op, std::shared_ptr<Object> &right);
+  static EvalResult evalPrefixExpression(const std::string &op, Ref<Object> &right);
 
   /**
    * @brief should be called by `evalPrefixExpression`
    *
    * @param right the right evaluated object
-   * @return std::shared_ptr<Object>
+   * @return EvalResult
    */
-  static std::shared_ptr<Object> evalBangOperationExpression(std::shared_ptr<Object> &right);
+  static EvalResult evalBangOperationExpression(Ref<Object> &right);
 
   /**
    * @brief should be called by `evalPrefixExpression`
    *
+   * @param op the prefix operation
    * @param right the right evaluated object
-   * @return std::shared_ptr<Object>
+   * @return EvalResult
    */
-  static std::shared_ptr<Object> evalMinusOperationExpression(std::shared_ptr<Object> &right);
+  static EvalResult evalMinusOperationExpression(const std::string &op, Ref<Object> &right);
 
   /**
    * @brief First calculate the left expression and right
@@ -68,11 +208,11 @@ public:
    * @param op the infix operator
    * @param left the left evaluated object
    * @param right the right evaluated object
-   * @return std::shared_ptr<Object>
+   * @return EvalResult
    */
-  static std::shared_ptr<Object> evalInfixExpression(const std::string &op,
-                                                     std::shared_ptr<Object> &left,
-                                                     std::shared_ptr<Object> &right);
+  static EvalResult evalInfixExpression(const std::string &op,
+                                        Ref<Object> &left,
+                                        Ref<Object> &right);
 
   /**
    * @brief Integer infix expression evaluation
@@ -80,11 +220,24 @@ public:
    * @param op the infix operator
    * @param left the left evaluated object
    * @param right the right evaluated object
-   * @return std::shared_ptr<Object>
+   * @return EvalResult
+   */
+  static EvalResult evalIntegerInfixExpression(const std::string &op,
+                                               Ref<Object> &left,
+                                               Ref<Object> &right);
+
+  /**
+   * @brief Float infix expression evaluation, one side could be an
+   * integer, it is promoted to double
+   *
+   * @param op the infix operator
+   * @param left the left evaluated object
+   * @param right the right evaluated object
+   * @return EvalResult
    */
-  static std::shared_ptr<Object> evalIntegerInfixExpression(const std::string &op,
-                                                            std::shared_ptr<Object> &left,
-                                                            std::shared_ptr<Object> &right);
+  static EvalResult evalFloatInfixExpression(const std::string &op,
+                                             Ref<Object> &left,
+                                             Ref<Object> &right);
 
   /**
    * @brief Boolean infix expression evaluation
@@ -92,11 +245,11 @@ public:
    * @param op the infix operator
    * @param left the left evaluated object
    * @param right the right evaluated object
-   * @return std::shared_ptr<Object>
+   * @return EvalResult
    */
-  static std::shared_ptr<Object> evalBooleanInfixExpression(const std::string &op,
-                                                            std::shared_ptr<Object> &left,
-                                                            std::shared_ptr<Object> &right);
+  static EvalResult evalBooleanInfixExpression(const std::string &op,
+                                               Ref<Object> &left,
+                                               Ref<Object> &right);
 
   /**
    * @brief String infix expression evaluation
@@ -104,80 +257,92 @@ public:
    * @param op the infix operator
    * @param left the left evaluated object
    * @param right the right evaluated object
-   * @return std::shared_ptr<Object>
+   * @return EvalResult
    */
-  static std::shared_ptr<Object> evalStringInfixExpression(const std::string &op,
-                                                           std::shared_ptr<Object> &left,
-                                                           std::shared_ptr<Object> &right);
+  static EvalResult evalStringInfixExpression(const std::string &op,
+                                              Ref<Object> &left,
+                                              Ref<Object> &right);
 
   /**
    * @brief Evaluate the `IfExpression`
    *
    * @param ie IfExpression
    * @param en
-   * @return std::shared_ptr<Object>
+   * @return EvalResult
    */
-  static std::shared_ptr<Object> evalIfExpression(IfExpression *ie, std::shared_ptr<Environment> &env);
+  static EvalResult evalIfExpression(IfExpression *ie, Ref<Environment> &env);
 
   /**
-   * @brief Evaluate the the block statement
+   * @brief Evaluate the the block statement, stop at the first
+   * statement which does not finish normally.
    *
    * @param bs
    * @param env
-   * @return std::shared_ptr<Object>
-   */
-  static std::shared_ptr<Object> evalBlockStatement(BlockStatement *bs, std::shared_ptr<Environment> &env);
-
-  /**
-   * @brief Generate the Error message
-   *
-   * @param s the error message
-   * @return std::shared_ptr<Error>
+   * @return EvalResult
    */
-  static std::shared_ptr<Error> newError(const std::string &s);
+  static EvalResult evalBlockStatement(BlockStatement *bs, Ref<Environment> &env);
 
   /**
    * @brief eval the identifier
    *
    * @param i
    * @param env
-   * @return std::shared_ptr<Object>
+   * @return EvalResult
    */
-  static std::shared_ptr<Object> evalIdentifier(Identifier *i, std::shared_ptr<Environment> &env);
+  static EvalResult evalIdentifier(Identifier *i, Ref<Environment> &env);
 
   /**
    * @brief eval the index
    *
    * @param left the left identifier
    * @param index the index expression
-   * @return std::shared_ptr<Object>
+   * @return EvalResult
+   */
+  static EvalResult evalIndexExpression(Ref<Object> left, Ref<Object> index);
+
+  /**
+   * @brief should be called by `evalIndexExpression`
+   *
    */
-  static std::shared_ptr<Object> evalIndexExpression(std::shared_ptr<Object> left, std::shared_ptr<Object> index);
+  static EvalResult evalArrayIndexExpression(Ref<Object> left, Ref<Object> index);
 
   /**
    * @brief should be called by `evalIndexExpression`
    *
    */
-  static std::shared_ptr<Object> evalArrayIndexExpression(std::shared_ptr<Object> left, std::shared_ptr<Object> index);
+  static EvalResult evalHashIndexExpression(Ref<Object> left, Ref<Object> index);
+
+  /**
+   * @brief build the hash from the evaluated keys and values, which are
+   * interleaved
+   *
+   * @param pairs the first key
+   * @param count the number of the keys and the values
+   * @return EvalResult the hash or the error of an unusable key
+   */
+  static EvalResult buildHash(Ref<Object> *pairs, std::size_t count);
 
   /**
-   * @brief eval the vector of expressions
+   * @brief eval the vector of expressions into `results`, stop at
+   * the first error.
    *
    * @param arguments the expressions
    * @param env the environment
-   * @return std::vector<std::shared_ptr<Object>>
+   * @param results the evaluated objects
+   * @return EvalResult the error or an empty result
    */
-  static std::vector<std::shared_ptr<Object>> evalExpressions(std::vector<std::unique_ptr<Expression>> &arguments,
-                                                              std::shared_ptr<Environment> &env);
+  static EvalResult evalExpressions(std::vector<std::unique_ptr<Expression>> &arguments,
+                                    Ref<Environment> &env,
+                                    std::vector<Ref<Object>> &results);
 
   /**
    * @brief Evaluate functions
    *
-   * @param fn the function pointer
+   * @param fn the function object
    * @param arguments the evaluated arguments.
-   * @return std::shared_ptr<Object>
+   * @return EvalResult
    */
-  static std::shared_ptr<Object> evalFunctions(Object *fn, std::vector<std::shared_ptr<Object>> &arguments);
+  static EvalResult evalFunctions(Ref<Object> &fn, std::vector<Ref<Object>> &arguments);
 };
 
 #endif  // _EVALUATOR_EVALUATOR_HPP_
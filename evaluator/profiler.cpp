@@ -0,0 +1,232 @@
+#include "profiler.hpp"
+
+#include "ast.hpp"
+#include "object.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+static constexpr std::size_t SnippetLength = 48;
+
+static std::string snippet(std::string s);
+static std::string functionLabel(Node *callee, Object *fn);
+static double milliseconds(std::chrono::nanoseconds t);
+
+static std::string snippet(std::string s) {
+  std::replace(s.begin(), s.end(), '\n', ' ');
+  if (s.size() > SnippetLength) {
+    s.resize(SnippetLength);
+    s += "...";
+  }
+  return s;
+}
+
+static std::string functionLabel(Node *callee, Object *fn) {
+  // Functions are anonymous, the name they are called by is the
+  // best label we have.
+  Identifier *identifier = dynamic_cast<Identifier *>(callee);
+  if (identifier != nullptr) {
+    return identifier->value;
+  }
+
+  if (fn->is<Function>()) {
+    Function *function = fn->as<Function>();
+    std::string label = "fn(";
+    for (std::size_t i = 0; i < function->parameters.size(); i++) {
+      if (i != 0) {
+        label += ", ";
+      }
+      label += function->parameters[i]->value;
+    }
+    return label + ")";
+  }
+
+  return snippet(callee->getString());
+}
+
+static double milliseconds(std::chrono::nanoseconds t) { return t.count() / 1e6; }
+
+Profiler::Profiler() { reset(); }
+
+void Profiler::push(std::vector<Frame> &frames, ProfileEntry *entry, std::size_t callNode) {
+  entry->visits++;
+  entry->active++;
+  frames.push_back(Frame{entry, Clock::now(), std::chrono::nanoseconds{0}, callNode});
+}
+
+std::chrono::nanoseconds Profiler::pop(std::vector<Frame> &frames) {
+  Frame &frame = frames.back();
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - frame.start);
+  auto exclusive = elapsed - frame.children;
+
+  frame.entry->exclusive += exclusive;
+  if (--frame.entry->active == 0) {
+    frame.entry->inclusive += elapsed;
+  }
+
+  frames.pop_back();
+  if (!frames.empty()) {
+    frames.back().children += elapsed;
+  }
+
+  return exclusive;
+}
+
+void Profiler::enterNode(Node *node) {
+  if (nodeFrames.empty()) {
+    // The top level node starts, time the program as the root function.
+    currentCall = 0;
+    push(functionFrames, callTree[0].function, 0);
+  }
+
+  auto it = nodeCache.find(node);
+  if (it == nodeCache.end()) {
+    // A statement prints like its expression, the type tells them apart
+    std::string label = snippet(node->getString());
+    ProfileEntry &entry = nodes[std::string{typeid(*node).name()} + ":" + label];
+    entry.label = std::move(label);
+    it = nodeCache.emplace(node, &entry).first;
+  }
+
+  push(nodeFrames, it->second, 0);
+}
+
+void Profiler::exitNode() {
+  pop(nodeFrames);
+
+  if (nodeFrames.empty()) {
+    if (!functionFrames.empty()) {
+      callTree[0].self += pop(functionFrames);
+    }
+    // The program is done, its nodes could be freed from now on
+    nodeCache.clear();
+    functionCache.clear();
+  }
+}
+
+void Profiler::enterFunction(Node *callee, Object *fn) {
+  const void *key = fn;
+  if (fn->is<Function>()) {
+    // A new function object is created every time the literal is
+    // evaluated, but the body is the same.
+    key = fn->as<Function>()->body.get();
+  }
+
+  auto it = functionCache.find(key);
+  if (it == functionCache.end()) {
+    std::string label = functionLabel(callee, fn);
+    ProfileEntry &entry = functions[label];
+    entry.label = std::move(label);
+    it = functionCache.emplace(key, &entry).first;
+  }
+  ProfileEntry *entry = it->second;
+
+  auto &children = callTree[currentCall].children;
+  auto child = children.find(entry);
+  std::size_t next{};
+  if (child == children.end()) {
+    next = callTree.size();
+    children.emplace(entry, next);
+    callTree.push_back(CallNode{entry, currentCall});
+  } else {
+    next = child->second;
+  }
+
+  currentCall = next;
+  push(functionFrames, entry, next);
+}
+
+void Profiler::exitFunction() {
+  std::size_t callNode = functionFrames.back().callNode;
+
+  callTree[callNode].self += pop(functionFrames);
+  currentCall = callTree[callNode].parent;
+}
+
+std::vector<ProfileEntry> Profiler::top(const std::unordered_map<std::string, ProfileEntry> &entries,
+                                        std::size_t n,
+                                        bool byInclusive) {
+  std::vector<ProfileEntry> result{};
+  result.reserve(entries.size());
+  for (auto &&[label, entry] : entries) {
+    result.push_back(entry);
+  }
+
+  std::sort(result.begin(), result.end(), [byInclusive](const ProfileEntry &a, const ProfileEntry &b) {
+    return byInclusive ? a.inclusive > b.inclusive : a.exclusive > b.exclusive;
+  });
+
+  if (result.size() > n) {
+    result.resize(n);
+  }
+  return result;
+}
+
+std::vector<ProfileEntry> Profiler::topFunctions(std::size_t n) { return top(functions, n, true); }
+
+std::vector<ProfileEntry> Profiler::topNodes(std::size_t n) { return top(nodes, n, false); }
+
+void Profiler::report(std::ostream &os, std::size_t n) {
+  os << std::fixed << std::setprecision(3);
+
+  os << "hottest functions:\n";
+  os << std::setw(10) << "calls" << std::setw(14) << "incl(ms)" << std::setw(14) << "excl(ms)"
+     << "  function\n";
+  for (auto &&entry : topFunctions(n)) {
+    os << std::setw(10) << entry.visits << std::setw(14) << milliseconds(entry.inclusive) << std::setw(14)
+       << milliseconds(entry.exclusive) << "  " << entry.label << "\n";
+  }
+
+  os << "hottest nodes:\n";
+  os << std::setw(10) << "visits" << std::setw(14) << "incl(ms)" << std::setw(14) << "excl(ms)"
+     << "  node\n";
+  for (auto &&entry : topNodes(n)) {
+    os << std::setw(10) << entry.visits << std::setw(14) << milliseconds(entry.inclusive) << std::setw(14)
+       << milliseconds(entry.exclusive) << "  " << entry.label << "\n";
+  }
+
+  os << std::defaultfloat;
+}
+
+void Profiler::writeCollapsedStacks(std::ostream &os) {
+  // Depth first, carry the path from the root to the call node
+  std::vector<std::pair<std::size_t, std::string>> pending{{0, callTree[0].function->label}};
+
+  while (!pending.empty()) {
+    auto [index, path] = std::move(pending.back());
+    pending.pop_back();
+
+    CallNode &node = callTree[index];
+    if (node.self.count() > 0) {
+      os << path << " " << node.self.count() << "\n";
+    }
+
+    for (auto &&[function, child] : node.children) {
+      pending.emplace_back(child, path + ";" + function->label);
+    }
+  }
+}
+
+void Profiler::reset() {
+  nodes.clear();
+  functions.clear();
+  nodeFrames.clear();
+  functionFrames.clear();
+  callTree.clear();
+  nodeCache.clear();
+  functionCache.clear();
+
+  program = ProfileEntry{};
+  program.label = "main";
+  callTree.push_back(CallNode{&program, 0});
+  currentCall = 0;
+}
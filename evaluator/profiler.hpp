@@ -0,0 +1,166 @@
+#ifndef _EVALUATOR_PROFILER_HPP_
+#define _EVALUATOR_PROFILER_HPP_
+
+#include "ast.hpp"
+#include "object.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief The statistics of one AST node or one function. The inclusive
+ * time contains the time spent in the children, the exclusive time does
+ * not.
+ *
+ */
+struct ProfileEntry {
+  std::string label{};
+  uint64_t visits{};
+  std::chrono::nanoseconds inclusive{};
+  std::chrono::nanoseconds exclusive{};
+
+  // How many times the entry is on the stack, the inclusive time of
+  // the recursive calls should only be counted by the outermost one.
+  int active{};
+};
+
+/**
+ * @brief Profiler counts the visits and accumulates the time per AST
+ * node and per function for `Evaluator`. It also records the call tree
+ * to export collapsed stacks for the flamegraph tools.
+ *
+ * The AST nodes carry no source offsets, so the node is labeled by a
+ * snippet of its `getString()`. The entries are keyed by their labels
+ * and the types of the nodes, the same code merges across the programs.
+ * The addresses of the nodes only find their entries while the program
+ * runs, its AST is freed after it and the addresses are reused by the
+ * next one.
+ *
+ */
+class Profiler {
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Frame {
+    ProfileEntry *entry;
+    Clock::time_point start;
+    std::chrono::nanoseconds children;
+    std::size_t callNode;
+  };
+
+  struct CallNode {
+    ProfileEntry *function;
+    std::size_t parent;
+    std::unordered_map<ProfileEntry *, std::size_t> children{};
+    std::chrono::nanoseconds self{};
+  };
+
+  // The entries by their keys: the type and the label of a node, the
+  // label of a function
+  std::unordered_map<std::string, ProfileEntry> nodes{};
+  std::unordered_map<std::string, ProfileEntry> functions{};
+
+  // The top level program, it is not reported as a function
+  ProfileEntry program{};
+
+  // The entries of the nodes and the function bodies of the running
+  // program by their addresses, cleared when it finishes
+  std::unordered_map<const void *, ProfileEntry *> nodeCache{};
+  std::unordered_map<const void *, ProfileEntry *> functionCache{};
+
+  std::vector<Frame> nodeFrames{};
+  std::vector<Frame> functionFrames{};
+
+  // The root of the call tree represents the top level program
+  std::vector<CallNode> callTree{};
+  std::size_t currentCall{};
+
+  /**
+   * @brief start to time the entry
+   *
+   */
+  void push(std::vector<Frame> &frames, ProfileEntry *entry, std::size_t callNode);
+
+  /**
+   * @brief stop timing the top entry and return its exclusive time
+   *
+   */
+  std::chrono::nanoseconds pop(std::vector<Frame> &frames);
+
+  /**
+   * @brief sort the entries by the time
+   *
+   */
+  static std::vector<ProfileEntry> top(const std::unordered_map<std::string, ProfileEntry> &entries,
+                                       std::size_t n,
+                                       bool byInclusive);
+
+public:
+  Profiler();
+
+  /**
+   * @brief called before the node is evaluated
+   *
+   */
+  void enterNode(Node *node);
+
+  /**
+   * @brief called after the node is evaluated
+   *
+   */
+  void exitNode();
+
+  /**
+   * @brief called before a function is applied
+   *
+   * @param callee the callee expression of the call
+   * @param fn the function or the builtin object
+   */
+  void enterFunction(Node *callee, Object *fn);
+
+  /**
+   * @brief called after the function returns
+   *
+   */
+  void exitFunction();
+
+  /**
+   * @brief get the top-N hottest functions by inclusive time
+   *
+   */
+  std::vector<ProfileEntry> topFunctions(std::size_t n);
+
+  /**
+   * @brief get the top-N hottest nodes by exclusive time
+   *
+   */
+  std::vector<ProfileEntry> topNodes(std::size_t n);
+
+  /**
+   * @brief write the human readable report
+   *
+   * @param os the output stream
+   * @param n the number of entries in each table
+   */
+  void report(std::ostream &os, std::size_t n);
+
+  /**
+   * @brief write the collapsed stacks such as `main;fib;fib 1200`, the
+   * number is the exclusive time in nanoseconds.
+   *
+   */
+  void writeCollapsedStacks(std::ostream &os);
+
+  /**
+   * @brief drop all the statistics
+   *
+   */
+  void reset();
+};
+
+#endif  // _EVALUATOR_PROFILER_HPP_
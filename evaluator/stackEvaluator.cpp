@@ -0,0 +1,362 @@
+#include "stackEvaluator.hpp"
+
+#include "ast.hpp"
+#include "builtins.hpp"
+#include "evaluator.hpp"
+#include "heap.hpp"
+#include "object.hpp"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+static bool isError(const Ref<Object> &object);
+static bool isTruthy(const Ref<Object> &object);
+
+static bool isError(const Ref<Object> &object) { return object != nullptr && object->is<Error>(); }
+
+static bool isTruthy(const Ref<Object> &object) {
+  // Keep the same rules as `Evaluator::evalIfExpression`, nullptr is falsy
+  // and integer is truthy when it is not zero.
+  if (object == nullptr) {
+    return false;
+  }
+
+  if (object->is<Boolean>()) {
+    return object->as<Boolean>()->value;
+  }
+
+  if (object->is<Integer>()) {
+    return object->as<Integer>()->value != 0;
+  }
+
+  return true;
+}
+
+void StackEvaluator::start(Node *node, Ref<Environment> &env) {
+  stack.clear();
+  values.clear();
+  schedule(node, env);
+}
+
+bool StackEvaluator::step(std::size_t maxSteps) {
+  while (maxSteps > 0 && !stack.empty()) {
+    advance();
+    maxSteps--;
+  }
+  return stack.empty();
+}
+
+Ref<Object> StackEvaluator::result() {
+  if (!finished() || values.empty()) {
+    return nullptr;
+  }
+  return values.back();
+}
+
+Ref<Object> StackEvaluator::eval(Node *node, Ref<Environment> &env) {
+  start(node, env);
+  while (!step(4096)) {
+  }
+  return result();
+}
+
+void StackEvaluator::schedule(Node *node, const Ref<Environment> &env, bool functionBody) {
+  // Copy the environment before `push_back`, `env` may live in `stack`.
+  Continuation continuation{node, env, functionBody};
+  stack.push_back(std::move(continuation));
+}
+
+void StackEvaluator::finish(Ref<Object> value) {
+  stack.pop_back();
+  values.push_back(std::move(value));
+}
+
+template <typename F>
+bool StackEvaluator::operands(std::size_t count, F operandAt) {
+  Continuation &k = stack.back();
+
+  if (k.stage > 0 && isError(values.back())) {
+    auto error = values.back();
+    values.resize(values.size() - k.stage);
+    finish(std::move(error));
+    return false;
+  }
+
+  if (k.stage < count) {
+    Node *operand = operandAt(k.stage);
+    k.stage++;
+    schedule(operand, k.env);
+    return false;
+  }
+
+  return true;
+}
+
+void StackEvaluator::advance() {
+  Continuation &k = stack.back();
+  Node *node = k.node;
+
+  Program *program = dynamic_cast<Program *>(node);
+  if (program != nullptr) {
+    return advanceStatements(program->statements, true);
+  }
+
+  BlockStatement *blockStatement = dynamic_cast<BlockStatement *>(node);
+  if (blockStatement != nullptr) {
+    return advanceStatements(blockStatement->statements, false);
+  }
+
+  ExpressionStatement *expressionStatement = dynamic_cast<ExpressionStatement *>(node);
+  if (expressionStatement != nullptr) {
+    if (k.stage == 0) {
+      k.stage++;
+      return schedule(expressionStatement->expression.get(), k.env);
+    }
+    auto value = values.back();
+    values.pop_back();
+    return finish(std::move(value));
+  }
+
+  IntegerLiteral *integer = dynamic_cast<IntegerLiteral *>(node);
+  if (integer != nullptr) {
+    if (integer->object == nullptr) {
+      integer->object = Integer::of(integer->value);
+    }
+    return finish(integer->object.cast<Object>());
+  }
+
+  FloatLiteral *floatLiteral = dynamic_cast<FloatLiteral *>(node);
+  if (floatLiteral != nullptr) {
+    if (floatLiteral->object == nullptr) {
+      floatLiteral->object = makeRef<Float>(floatLiteral->value);
+    }
+    return finish(floatLiteral->object.cast<Object>());
+  }
+
+  BooleanExpression *booleanExpression = dynamic_cast<BooleanExpression *>(node);
+  if (booleanExpression != nullptr) {
+    return finish(Boolean::of(booleanExpression->value));
+  }
+
+  StringLiteral *stringLiteral = dynamic_cast<StringLiteral *>(node);
+  if (stringLiteral != nullptr) {
+    if (stringLiteral->object == nullptr) {
+      stringLiteral->object = Interner::current().intern(stringLiteral->value);
+    }
+    return finish(stringLiteral->object.cast<Object>());
+  }
+
+  Identifier *identifier = dynamic_cast<Identifier *>(node);
+  if (identifier != nullptr) {
+    auto value = Evaluator::evalIdentifier(identifier, k.env);
+    return finish(Evaluator::unwrap(value));
+  }
+
+  PrefixExpression *prefixExpression = dynamic_cast<PrefixExpression *>(node);
+  if (prefixExpression != nullptr) {
+    if (!operands(1, [&](std::size_t) -> Node * { return prefixExpression->right.get(); })) {
+      return;
+    }
+    auto right = values.back();
+    values.pop_back();
+    auto value = Evaluator::evalPrefixExpression(prefixExpression->_operator, right);
+    return finish(Evaluator::unwrap(value));
+  }
+
+  InfixExpression *infixExpression = dynamic_cast<InfixExpression *>(node);
+  if (infixExpression != nullptr) {
+    if (!operands(2, [&](std::size_t i) -> Node * {
+          return i == 0 ? infixExpression->left.get() : infixExpression->right.get();
+        })) {
+      return;
+    }
+    auto right = values.back();
+    values.pop_back();
+    auto left = values.back();
+    values.pop_back();
+    auto value = Evaluator::evalInfixExpression(infixExpression->_operator, left, right);
+    return finish(Evaluator::unwrap(value));
+  }
+
+  IfExpression *ifExpression = dynamic_cast<IfExpression *>(node);
+  if (ifExpression != nullptr) {
+    if (k.stage == 0) {
+      if (!operands(1, [&](std::size_t) -> Node * { return ifExpression->condition.get(); })) {
+        return;
+      }
+    }
+
+    if (k.stage == 1) {
+      auto condition = values.back();
+      if (isError(condition)) {
+        values.pop_back();
+        return finish(std::move(condition));
+      }
+      values.pop_back();
+
+      BlockStatement *branch = isTruthy(condition) ? ifExpression->consequence.get() : ifExpression->alternative.get();
+      if (branch == nullptr) {
+        return finish(nullptr);
+      }
+      k.stage++;
+      return schedule(branch, k.env);
+    }
+
+    // The value of the branch is the value of the if expression.
+    auto value = values.back();
+    values.pop_back();
+    return finish(std::move(value));
+  }
+
+  ReturnStatement *returnStatement = dynamic_cast<ReturnStatement *>(node);
+  if (returnStatement != nullptr) {
+    if (!operands(1, [&](std::size_t) -> Node * { return returnStatement->returnValue.get(); })) {
+      return;
+    }
+    auto returnValue = makeRef<ReturnValue>();
+    returnValue->value = values.back();
+    values.pop_back();
+    return finish(std::move(returnValue));
+  }
+
+  LetStatement *letStatement = dynamic_cast<LetStatement *>(node);
+  if (letStatement != nullptr) {
+    if (!operands(1, [&](std::size_t) -> Node * { return letStatement->value.get(); })) {
+      return;
+    }
+    k.env->set(letStatement->name->value, values.back());
+    values.pop_back();
+    return finish(nullptr);
+  }
+
+  FunctionLiteral *functionLiteral = dynamic_cast<FunctionLiteral *>(node);
+  if (functionLiteral != nullptr) {
+    auto function =
+        makeRef<Function>(std::move(functionLiteral->parameters), std::move(functionLiteral->body), k.env);
+    return finish(std::move(function));
+  }
+
+  CallExpression *callExpression = dynamic_cast<CallExpression *>(node);
+  if (callExpression != nullptr) {
+    std::size_t count = callExpression->arguments.size() + 1;
+    if (k.stage < count || (k.stage == count && isError(values.back()))) {
+      operands(count, [&](std::size_t i) -> Node * {
+        return i == 0 ? callExpression->function.get() : callExpression->arguments[i - 1].get();
+      });
+      return;
+    }
+
+    if (k.stage == count) {
+      // All the operands are ready, the function is below the arguments.
+      std::vector<Ref<Object>> arguments(values.end() - (count - 1), values.end());
+      values.resize(values.size() - (count - 1));
+      auto function = values.back();
+      values.pop_back();
+
+      k.stage++;
+      return applyFunction(function, arguments);
+    }
+
+    // The function body is done, its value is the value of the call.
+    auto value = values.back();
+    values.pop_back();
+    return finish(std::move(value));
+  }
+
+  ArrayLiteral *arrayLiteral = dynamic_cast<ArrayLiteral *>(node);
+  if (arrayLiteral != nullptr) {
+    std::size_t count = arrayLiteral->elements.size();
+    if (!operands(count, [&](std::size_t i) -> Node * { return arrayLiteral->elements[i].get(); })) {
+      return;
+    }
+    auto result = Array::from(values.data() + values.size() - count, count);
+    values.resize(values.size() - count);
+    return finish(std::move(result));
+  }
+
+  IndexExpression *indexExpression = dynamic_cast<IndexExpression *>(node);
+  if (indexExpression != nullptr) {
+    if (!operands(2, [&](std::size_t i) -> Node * {
+          return i == 0 ? indexExpression->left.get() : indexExpression->index.get();
+        })) {
+      return;
+    }
+    auto index = values.back();
+    values.pop_back();
+    auto left = values.back();
+    values.pop_back();
+    auto value = Evaluator::evalIndexExpression(left, index);
+    return finish(Evaluator::unwrap(value));
+  }
+
+  HashLiteral *hashLiteral = dynamic_cast<HashLiteral *>(node);
+  if (hashLiteral != nullptr) {
+    // The keys and the values are interleaved on the value stack
+    std::size_t count = hashLiteral->pairs.size() * 2;
+    if (!operands(count, [&](std::size_t i) -> Node * {
+          auto &&pair = hashLiteral->pairs[i / 2];
+          return i % 2 == 0 ? pair.first.get() : pair.second.get();
+        })) {
+      return;
+    }
+    auto value = Evaluator::buildHash(values.data() + values.size() - count, count);
+    values.resize(values.size() - count);
+    return finish(Evaluator::unwrap(value));
+  }
+
+  finish(nullptr);
+}
+
+void StackEvaluator::advanceStatements(std::vector<std::unique_ptr<Statement>> &statements, bool isProgram) {
+  Continuation &k = stack.back();
+
+  Ref<Object> result{};
+  if (k.stage > 0) {
+    result = values.back();
+    values.pop_back();
+
+    if (result != nullptr && result->is<ReturnValue>()) {
+      ReturnValue *returnValue = result->as<ReturnValue>();
+      // A program or a function body is where the return stops, a
+      // nested block should hand the wrapper to its parent.
+      if (isProgram || k.functionBody) {
+        return finish(returnValue->value);
+      }
+      return finish(std::move(result));
+    }
+
+    if (isError(result)) {
+      return finish(std::move(result));
+    }
+  }
+
+  if (k.stage == statements.size()) {
+    return finish(std::move(result));
+  }
+
+  Node *statement = statements[k.stage].get();
+  k.stage++;
+  schedule(statement, k.env);
+}
+
+void StackEvaluator::applyFunction(Ref<Object> &fn, std::vector<Ref<Object>> &arguments) {
+  if (fn == nullptr || !fn->is<Function>()) {
+    // Builtins are native, they return the value immediately.
+    auto value = Evaluator::evalFunctions(fn, arguments);
+    values.push_back(Evaluator::unwrap(value));
+    return;
+  }
+  Function *function = fn->as<Function>();
+
+  Heap::current().poll();
+
+  auto extendedEnv = makeRef<Environment>(function->env);
+
+  int i = 0;
+  for (auto &&parameter : function->parameters) {
+    extendedEnv->set(parameter->value, arguments[i++]);
+  }
+
+  schedule(function->body.get(), extendedEnv, true);
+}
@@ -0,0 +1,132 @@
+#ifndef _EVALUATOR_STACK_EVALUATOR_HPP_
+#define _EVALUATOR_STACK_EVALUATOR_HPP_
+
+#include "ast.hpp"
+#include "object.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief A continuation records which node we are evaluating, in which
+ * environment, and how far we have got. `stage` counts the operands which
+ * have already been evaluated and pushed to the value stack.
+ *
+ */
+struct Continuation {
+  Node *node;
+  Ref<Environment> env;
+  std::size_t stage;
+  bool functionBody;
+
+  Continuation() = default;
+  Continuation(Node *n, Ref<Environment> e, bool f = false)
+      : node{n}, env{std::move(e)}, stage{0}, functionBody{f} {}
+};
+
+/**
+ * @brief StackEvaluator is a variant of `Evaluator` which never recurses
+ * on the C++ stack. All the pending work lives in an explicit continuation
+ * stack on the heap, so the recursion depth of a Monkey program is only
+ * limited by the memory. Because the state is explicit, the evaluation could
+ * be suspended after any number of steps and resumed later, which makes it
+ * possible to time-slice many scripts on one thread.
+ *
+ * Unlike `Evaluator`, an error produced by an operand is propagated
+ * immediately instead of being fed into the enclosing operation.
+ *
+ */
+class StackEvaluator {
+private:
+  std::vector<Continuation> stack{};
+  std::vector<Ref<Object>> values{};
+
+  /**
+   * @brief schedule `node` to be evaluated in `env`
+   *
+   */
+  void schedule(Node *node, const Ref<Environment> &env, bool functionBody = false);
+
+  /**
+   * @brief pop the current continuation and hand `value` to its parent
+   *
+   */
+  void finish(Ref<Object> value);
+
+  /**
+   * @brief Schedule the next operand of the current continuation. Return
+   * true only when all the `count` operands are on the value stack. If an
+   * operand evaluates to an error, the current continuation is finished
+   * with the error.
+   *
+   * @param count the number of the operands
+   * @param operandAt get the i-th operand node
+   */
+  template <typename F>
+  bool operands(std::size_t count, F operandAt);
+
+  /**
+   * @brief execute one step of the top continuation
+   *
+   */
+  void advance();
+
+  /**
+   * @brief advance the sequence of statements of a program or a block
+   *
+   */
+  void advanceStatements(std::vector<std::unique_ptr<Statement>> &statements, bool isProgram);
+
+  /**
+   * @brief apply the function to the evaluated arguments
+   *
+   */
+  void applyFunction(Ref<Object> &fn, std::vector<Ref<Object>> &arguments);
+
+public:
+  StackEvaluator() = default;
+  StackEvaluator(const StackEvaluator &) = delete;
+
+  /**
+   * @brief start to evaluate the node, any previous unfinished work
+   * is dropped.
+   *
+   * @param node the node to evaluate
+   * @param env the environment
+   */
+  void start(Node *node, Ref<Environment> &env);
+
+  /**
+   * @brief run at most `maxSteps` steps, and return whether the
+   * evaluation is finished. It could be called again to resume.
+   *
+   * @param maxSteps the maximum number of steps to run
+   * @return true if the evaluation is finished
+   */
+  bool step(std::size_t maxSteps);
+
+  /**
+   * @brief whether the evaluation is finished
+   *
+   */
+  inline bool finished() { return stack.empty(); }
+
+  /**
+   * @brief get the result, only valid when `finished()` is true
+   *
+   * @return Ref<Object>
+   */
+  Ref<Object> result();
+
+  /**
+   * @brief evaluate the node to the end
+   *
+   * @param node the node to evaluate
+   * @param env the environment
+   * @return Ref<Object>
+   */
+  Ref<Object> eval(Node *node, Ref<Environment> &env);
+};
+
+#endif  // _EVALUATOR_STACK_EVALUATOR_HPP_
@@ -1,28 +1,34 @@
+#include "budget.hpp"
 #include "evaluator.hpp"
 #include "lexer.hpp"
+#include "output.hpp"
 #include "object.hpp"
 #include "parser.hpp"
 #include "spdlog/spdlog.h"
 
+#include <chrono>
+#include <cstdio>
 #include <cstdint>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 
 Evaluator evaluator{};
 
-std::shared_ptr<Object> testEval(const std::string &input, std::shared_ptr<Environment> &env);
+Ref<Object> testEval(const std::string &input, Ref<Environment> &env);
 bool testIntegerObject(Object *object, int64_t expected);
 bool testBooleanObject(Object *object, bool expected);
 bool testNullObject(Object *object);
 
-std::shared_ptr<Object> testEval(const std::string &input) {
+Ref<Object> testEval(const std::string &input) {
   Lexer lexer{input};
   Parser parser{&lexer};
 
   auto program = parser.parseProgram();
-  auto env = std::make_shared<Environment>();
+  auto env = makeRef<Environment>();
 
   return evaluator.eval(program.get(), env);
 }
@@ -101,6 +107,38 @@ TEST(Evaluator, TestEvalIntegerExpression) {
   }
 }
 
+TEST(Evaluator, TestEvalFloatExpression) {
+  struct TestData {
+    std::string input;
+    double expected;
+
+    TestData(const std::string &s, double v) : input{s}, expected{v} {}
+  };
+
+  std::vector<TestData> tests{
+      {"2.5", 2.5},
+      {"-2.5", -2.5},
+      {"1.25 + 1.25", 2.5},
+      {"1 + 0.5", 1.5},
+      {"0.5 * 4", 2.0},
+      {"7 / 2.0", 3.5},
+      {"(1.5 + 2) * -2", -7.0},
+  };
+
+  for (auto &&test : tests) {
+    auto evaluated = testEval(test.input);
+    Float *floating = dynamic_cast<Float *>(evaluated.get());
+    ASSERT_NE(floating, nullptr) << test.input;
+    ASSERT_EQ(floating->value, test.expected) << test.input;
+  }
+
+  ASSERT_TRUE(testBooleanObject(testEval("1.5 < 2").get(), true));
+  ASSERT_TRUE(testBooleanObject(testEval("2.0 == 2").get(), true));
+  ASSERT_EQ(testEval("2.0").get()->inspect(), "2.0");
+  ASSERT_EQ(testEval("0.1 + 0.2").get()->inspect(), "0.30000000000000004");
+  ASSERT_EQ(testEval("1.5 + true").get()->inspect(), "ERROR: type mismatch: FLOAT + BOOLEAN");
+}
+
 TEST(Evaluator, TestEvalBooleanExpression) {
   struct TestData {
     std::string input;
@@ -129,6 +167,10 @@ TEST(Evaluator, TestEvalBooleanExpression) {
       {"(1 < 2) == false", false},
       {"(1 > 2) == true", false},
       {"(1 > 2) == false", true},
+      {R"("monkey" == "monkey")", true},
+      {R"("mon" + "key" == "monkey")", true},
+      {R"("monkey" != "banana")", true},
+      {R"("monkey" == "banana")", false},
   };
 
   for (auto &&test : tests) {
@@ -280,6 +322,30 @@ TEST(Evaluator, TestErrorHandling) {
           R"("Hello" - "World")",
           "unknown operator: STRING - STRING",
       },
+      {
+          "let f = fn() { foobar; }; f() + 1;",
+          "identifier not found: foobar",
+      },
+      {
+          "let a = -true; 5;",
+          "unknown operator: -BOOLEAN",
+      },
+      {
+          "fn() { foobar; }();",
+          "identifier not found: foobar",
+      },
+      {
+          "fn(x) { x + true; }(1);",
+          "type mismatch: INTEGER + BOOLEAN",
+      },
+      {
+          "5(1)",
+          "not a function: INTEGER",
+      },
+      {
+          R"({"name": "Monkey"}[fn(x) { x }];)",
+          "unusable as hash key: FUNCTION",
+      },
   };
 
   for (auto &&test : tests) {
@@ -410,8 +476,8 @@ TEST(Evaluator, TestStringLiterator) {
     FAIL();
   }
 
-  if (str->value != "Hello World!") {
-    spdlog::error("String has wrong value. got='{}'", str->value);
+  if (str->value() != "Hello World!") {
+    spdlog::error("String has wrong value. got='{}'", str->value());
     FAIL();
   }
 }
@@ -426,8 +492,8 @@ TEST(Evaluator, TestStringConcatenation) {
     FAIL();
   }
 
-  if (str->value != "Hello World!") {
-    spdlog::error("String has wrong value. got='{}'", str->value);
+  if (str->value() != "Hello World!") {
+    spdlog::error("String has wrong value. got='{}'", str->value());
     FAIL();
   }
 }
@@ -484,6 +550,158 @@ TEST(Evaluator, TestBuiltinLenError) {
   }
 }
 
+TEST(Evaluator, TestHigherOrderBuiltins) {
+  struct TestData {
+    std::string input;
+    int64_t expected;
+
+    TestData(const std::string &s, int64_t v) : input{s}, expected{v} {}
+  };
+
+  std::vector<TestData> tests{
+      {"reduce(map([1, 2, 3], fn(x) { x * x }), 0, fn(a, b) { a + b })", 14},
+      {"count(filter(range(10), fn(x) { x > 4 }))", 5},
+      {"let k = 3; first(collect(map(range(5, 0, -1), fn(x) { x * k })))", 15},
+      {"sum(map(take(range(1000000000), 4), fn(x) { x * 2 }))", 12},
+      {"let count = fn(a) { reduce(a, 0, fn(n, x) { n + 1 }) }; count(range(1000))", 1000},
+      {"sum(map([[1], [1, 2]], len))", 3},
+      {"let k = 1; first(sort([3, 1, 2], fn(a, b) { a * k > b * k }))", 3},
+  };
+
+  for (auto &&test : tests) {
+    auto evaluated = testEval(test.input);
+    if (!testIntegerObject(evaluated.get(), test.expected)) {
+      FAIL() << test.input;
+    }
+  }
+
+  ASSERT_TRUE(testNullObject(testEval("each([1, 2], fn(x) { x })").get()));
+
+  // An error in the callback stops the builtin
+  auto evaluated = testEval("map([1, 2], fn(x) { x + true })");
+  Error *error = dynamic_cast<Error *>(evaluated.get());
+  ASSERT_NE(error, nullptr);
+  ASSERT_EQ(error->message, "type mismatch: INTEGER + BOOLEAN");
+
+  // The callback takes as many parameters as the builtin passes
+  std::vector<std::pair<std::string, std::string>> arities{
+      {"map([1, 2], fn(x, y) { y })", "wrong number of arguments. got=1, want=2"},
+      {"reduce([1, 2], 0, fn(x) { x })", "wrong number of arguments. got=2, want=1"},
+      {"count(filter(range(3), fn() { true }))", "wrong number of arguments. got=1, want=0"},
+  };
+  for (auto &&[input, expected] : arities) {
+    evaluated = testEval(input);
+    error = dynamic_cast<Error *>(evaluated.get());
+    ASSERT_NE(error, nullptr) << input;
+    EXPECT_EQ(error->message, expected) << input;
+  }
+}
+
+TEST(Evaluator, TestFiles) {
+  std::string path = ::testing::TempDir() + "monkey_lines.txt";
+  {
+    std::ofstream file{path};
+    file << "let\r\nfive = 5;\n\nmonkey";
+  }
+
+  // The lines are pulled one at a time without the line breaks
+  auto evaluated = testEval("collect(readLines(\"" + path + "\"))");
+  auto array = dynamic_cast<Array *>(evaluated.get());
+  ASSERT_NE(array, nullptr);
+  std::vector<std::string> expected{"let", "five = 5;", "", "monkey"};
+  ASSERT_EQ(array->size(), expected.size());
+  for (std::size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(array->get(i).cast<String>()->value(), expected[i]);
+  }
+
+  ASSERT_TRUE(testIntegerObject(testEval("count(filter(readLines(\"" + path + "\"), fn(l) { len(l) > 3 }))").get(), 2));
+
+  // The mapped text behaves like any other string
+  std::string read = "let text = readFile(\"" + path + "\"); ";
+  ASSERT_TRUE(testIntegerObject(testEval(read + "len(text)").get(), 22));
+  ASSERT_TRUE(testIntegerObject(testEval(read + "len(text + \"!\")").get(), 23));
+  ASSERT_TRUE(testIntegerObject(testEval(read + "count(lines(text))").get(), 4));
+  ASSERT_TRUE(testBooleanObject(testEval(read + "{text: 1}[text + \"\"] == 1").get(), true));
+
+  // Writing replaces the file
+  evaluated = testEval("writeFile(\"" + path + "\", \"monkey!\")");
+  ASSERT_TRUE(testNullObject(evaluated.get()));
+  ASSERT_TRUE(testIntegerObject(testEval(read + "len(text)").get(), 7));
+  evaluated = testEval("writeFile(\"" + path + "\", \"\")");
+  ASSERT_TRUE(testIntegerObject(testEval(read + "len(text)").get(), 0));
+  std::remove(path.c_str());
+
+  evaluated = testEval(read);
+  Error *error = dynamic_cast<Error *>(evaluated.get());
+  ASSERT_NE(error, nullptr);
+  ASSERT_EQ(error->message, "could not read " + path + ": No such file or directory");
+}
+
+TEST(Evaluator, TestPuts) {
+  Output &output = Output::current();
+  output.flush();
+
+  ASSERT_TRUE(testNullObject(testEval("puts(1, \"two\", [3]); print(\"a\", 4, true)").get()));
+  ASSERT_EQ(output.pending(), "1\ntwo\n[3]\na4true");
+  output.discard();
+
+  // The big values are streamed to the file in blocks, the text is the same
+  auto value = testEval("[collect(range(100000)), \"" + std::string(Output::BlockSize, 'm') + "\"]");
+  std::FILE *file = std::tmpfile();
+  ASSERT_NE(file, nullptr);
+  {
+    Output streamed{file};
+    Writer writer{streamed};
+    value->inspect(writer);
+    writer.flush();
+    streamed.write("!");
+  }
+  std::string text(static_cast<std::size_t>(std::ftell(file)), '\0');
+  std::rewind(file);
+  ASSERT_EQ(std::fread(text.data(), 1, text.size(), file), text.size());
+  std::fclose(file);
+  ASSERT_EQ(text, value->inspect() + "!");
+}
+
+TEST(Evaluator, TestInspect) {
+  auto evaluated = testEval(R"([1, [2.5, "a"], {"k": [true]}, first([])])");
+  ASSERT_EQ(evaluated->inspect(), "[1, [2.5, a], {k: [true]}, null]");
+
+  // The text is cut at the length, the rest is not visited
+  Writer writer{10};
+  testEval("collect(range(100000))")->inspect(writer);
+  ASSERT_TRUE(writer.full());
+  ASSERT_EQ(writer.str(), "[0, 1, 2, ...");
+
+  // The deep containers are elided, a cycle ends too
+  Writer shallow{Writer::Unlimited, 2};
+  testEval("[[[1]], {1: [2]}]")->inspect(shallow);
+  ASSERT_EQ(shallow.str(), "[[[...]], {1: [...]}]");
+
+  auto cyclic = makeRef<Array>();
+  cyclic->elements.push_back(cyclic);
+  Writer bounded{Writer::Unlimited, 3};
+  cyclic->inspect(bounded);
+  ASSERT_EQ(bounded.str(), "[[[[...]]]]");
+  cyclic->elements = PersistentVector{};
+
+  // The string of a deep container is complete
+  Value deep = makeRef<Array>();
+  for (int i = 0; i < 600; i++) {
+    deep = Array::from(&deep, 1);
+  }
+  ASSERT_EQ(deep.inspect(), std::string(601, '[') + std::string(601, ']'));
+
+  // With a stream the text goes out in blocks
+  std::ostringstream out{};
+  {
+    Writer streaming{out};
+    testEval("collect(range(50000))")->inspect(streaming);
+    ASSERT_LT(streaming.str().size(), Writer::BlockSize);
+  }
+  ASSERT_EQ(out.str(), testEval("collect(range(50000))")->inspect());
+}
+
 TEST(Evaluator, TestArrayLiterals) {
   std::string input{"[1, 2 * 2, 3 + 3]"};
 
@@ -495,20 +713,20 @@ TEST(Evaluator, TestArrayLiterals) {
     FAIL();
   }
 
-  if (array->elements.size() != 3) {
-    spdlog::error("array has wrong number of elements. got={}", array->elements.size());
+  if (array->size() != 3) {
+    spdlog::error("array has wrong number of elements. got={}", array->size());
     FAIL();
   }
 
-  if (!testIntegerObject(array->elements[0].get(), 1)) {
+  if (!testIntegerObject(array->get(0).get(), 1)) {
     FAIL();
   }
 
-  if (!testIntegerObject(array->elements[1].get(), 4)) {
+  if (!testIntegerObject(array->get(1).get(), 4)) {
     FAIL();
   }
 
-  if (!testIntegerObject(array->elements[2].get(), 6)) {
+  if (!testIntegerObject(array->get(2).get(), 6)) {
     FAIL();
   }
 }
@@ -538,3 +756,181 @@ TEST(Evaluator, TestArrayIndexExpressions) {
     }
   }
 }
+
+TEST(Evaluator, TestHashLiterals) {
+  std::string input = R"(let two = "two";
+  {
+    "one": 10 - 9,
+    two: 1 + 1,
+    "thr" + "ee": 6 / 2,
+    4: 4,
+    true: 5,
+    false: 6
+  })";
+
+  auto evaluated = testEval(input);
+  Hash *hash = dynamic_cast<Hash *>(evaluated.get());
+  if (hash == nullptr) {
+    spdlog::error("object is not Hash");
+    FAIL();
+  }
+
+  std::vector<std::pair<Ref<Object>, int64_t>> expected{
+      {makeRef<String>("one"), 1},
+      {makeRef<String>("two"), 2},
+      {makeRef<String>("three"), 3},
+      {Integer::of(4), 4},
+      {Boolean::of(true), 5},
+      {Boolean::of(false), 6},
+  };
+
+  ASSERT_EQ(hash->pairs.size(), expected.size());
+  for (auto &&[key, value] : expected) {
+    auto found = hash->pairs.find(key.get());
+    ASSERT_NE(found, nullptr);
+    if (!testIntegerObject(found->get(), value)) {
+      FAIL();
+    }
+  }
+}
+
+TEST(Evaluator, TestHashIndexExpressions) {
+  struct TestData {
+    std::string input;
+    int64_t expected;
+    bool isNull;
+
+    TestData(const std::string &s, int64_t v, bool n = false) : input{s}, expected{v}, isNull{n} {}
+  };
+
+  std::vector<TestData> tests{
+      {R"({"foo": 5}["foo"])", 5},
+      {R"({"foo": 5}["bar"])", 0, true},
+      {R"(let key = "foo"; {"foo": 5}[key])", 5},
+      {R"({}["foo"])", 0, true},
+      {R"({5: 5}[5])", 5},
+      {R"({true: 5}[true])", 5},
+      {R"({false: 5}[false])", 5},
+  };
+
+  for (auto &&test : tests) {
+    auto evaluated = testEval(test.input);
+    if (test.isNull ? !testNullObject(evaluated.get()) : !testIntegerObject(evaluated.get(), test.expected)) {
+      FAIL();
+    }
+  }
+}
+
+TEST(Evaluator, TestSharedSingletons) {
+  // Booleans and small integers are shared, big integers are not.
+  ASSERT_EQ(testEval("true").get(), testEval("1 < 2").get());
+  ASSERT_EQ(testEval("!true").get(), testEval("false").get());
+  ASSERT_EQ(testEval("1 + 2").get(), Integer::of(3).get());
+  ASSERT_EQ(testEval("-128").get(), Integer::of(-128).get());
+  ASSERT_NE(testEval("1000 + 24").get(), Integer::of(1024).get());
+
+  if (!testIntegerObject(testEval("1000 * 1000").get(), 1000000)) {
+    FAIL();
+  }
+}
+
+TEST(Evaluator, TestInternedStrings) {
+  // The literals and the short results are shared while they are alive
+  auto monkey = testEval(R"("monkey")");
+  ASSERT_EQ(monkey.get(), testEval(R"("mon" + "key")").get());
+  ASSERT_TRUE(monkey->as<String>()->isInterned());
+
+  auto size = Interner::current().size();
+  monkey.reset();
+  ASSERT_EQ(Interner::current().size(), size - 1);
+
+  // The long results are not interned, but still equal
+  std::string input = R"("a long string which is not interned" + "!")";
+  auto left = testEval(input);
+  auto right = testEval(input);
+  ASSERT_NE(left.get(), right.get());
+  ASSERT_FALSE(left->as<String>()->isInterned());
+  ASSERT_TRUE(left->as<String>()->equals(right->as<String>()));
+  ASSERT_EQ(left->as<String>()->hash(), right->as<String>()->hash());
+}
+
+TEST(Evaluator, TestObjectKinds) {
+  ASSERT_TRUE(testEval("1")->is<Integer>());
+  ASSERT_TRUE(testEval("true")->is<Boolean>());
+  ASSERT_TRUE(testEval(R"("foo")")->is<String>());
+  ASSERT_TRUE(testEval("[1, 2]")->is<Array>());
+  ASSERT_TRUE(testEval("fn(x) { x }")->is<Function>());
+  ASSERT_TRUE(testEval("len")->is<Builtin>());
+  ASSERT_FALSE(testEval("1")->is<Boolean>());
+
+  auto error = testEval("1 + true");
+  ASSERT_TRUE(error->is<Error>());
+  ASSERT_EQ(error->type(), "ERROR");
+  ASSERT_EQ(error->as<Error>()->message, "type mismatch: INTEGER + BOOLEAN");
+}
+
+TEST(Evaluator, TestBudgets) {
+  struct TestData {
+    std::string input;
+    std::string expectedResource;
+    Budget budget;
+
+    TestData(const std::string &s, const std::string &r, Budget b) : input{s}, expectedResource{r}, budget{b} {}
+  };
+
+  Budget fuel{};
+  fuel.fuel = 1000;
+  Budget depth{};
+  depth.maxDepth = 100;
+  Budget allocations{};
+  allocations.maxAllocations = 50;
+  // The deadline is set when the run starts, the runs never end by themselves
+  Budget deadline{};
+
+  std::vector<TestData> tests{
+      {"let loop = fn(n) { loop(n + 1) + 1 }; loop(0);", "fuel", fuel},
+      {"let loop = fn(n) { loop(n + 1) + 1 }; loop(0);", "call depth", depth},
+      {"let grow = fn(a) { grow(push(a, [1])) }; grow([]);", "allocations", allocations},
+      {"let loop = fn(n) { if (n == 0) { 0 } else { loop(n - 1) + loop(n - 1) } }; loop(100);", "deadline", deadline},
+      // The native loops of the builtins tick the budget too
+      {"count(range(0, 9223372036854775807));", "deadline", deadline},
+      {"sum(range(0, 1000000000000));", "fuel", fuel},
+      {"collect(range(0, 1000000000000));", "fuel", fuel},
+      // The objects the builtins allocate are counted
+      {"count(zip(range(100000), range(100000)));", "allocations", allocations},
+  };
+
+  for (auto &&test : tests) {
+    if (test.expectedResource == "deadline") {
+      test.budget.setTimeout(std::chrono::milliseconds{50});
+    }
+    Evaluator::setBudget(&test.budget);
+    auto evaluated = testEval(test.input);
+    Evaluator::setBudget(nullptr);
+
+    BudgetError *error = dynamic_cast<BudgetError *>(evaluated.get());
+    if (error == nullptr) {
+      spdlog::error("no budget error returned for {}", test.input);
+      FAIL();
+    }
+
+    if (error->resource != test.expectedResource) {
+      spdlog::error("wrong budget. expected='{}', got='{}'", test.expectedResource, error->resource);
+      FAIL();
+    }
+  }
+
+  // A run within its budget is not affected
+  Budget budget{};
+  budget.fuel = 1000;
+  budget.maxDepth = 10;
+  Evaluator::setBudget(&budget);
+  auto evaluated = testEval("let f = fn(n) { if (n == 0) { 0 } else { n + f(n - 1) } }; f(5);");
+  Evaluator::setBudget(nullptr);
+
+  if (!testIntegerObject(evaluated.get(), 15)) {
+    FAIL();
+  }
+  ASSERT_EQ(budget.depth, 0);
+  ASSERT_EQ(budget.exhausted, BudgetKind::None);
+}
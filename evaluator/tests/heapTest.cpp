@@ -0,0 +1,276 @@
+#include "evaluator.hpp"
+#include "heap.hpp"
+#include "lexer.hpp"
+#include "nursery.hpp"
+#include "object.hpp"
+#include "parser.hpp"
+
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+Ref<Object> testEval(const std::string &input, Ref<Environment> &env);
+
+Ref<Object> testEval(const std::string &input, Ref<Environment> &env) {
+  Lexer lexer{input};
+  Parser parser{&lexer};
+
+  auto program = parser.parseProgram();
+  return Evaluator::eval(program.get(), env);
+}
+
+TEST(Heap, TestArrayCycle) {
+  Heap &heap = Heap::current();
+  std::size_t before = heap.size(HeapSpace::Arrays);
+
+  {
+    auto array = makeRef<Array>();
+    array->elements.push_back(array);
+    array->elements.push_back(makeRef<String>("monkey"));
+  }
+
+  // The reference count alone never frees it
+  ASSERT_EQ(heap.size(HeapSpace::Arrays), before + 1);
+  // The array and the leaf holding its elements
+  ASSERT_EQ(heap.collect(), 2u);
+  ASSERT_EQ(heap.size(HeapSpace::Arrays), before);
+}
+
+TEST(Heap, TestEnvironmentCycle) {
+  Heap &heap = Heap::current();
+  std::size_t before = heap.size();
+
+  auto env = makeRef<Environment>();
+  auto result = testEval("let add = fn(x) { fn(y) { x + y } }; let addTwo = add(2); addTwo(3);", env);
+  ASSERT_EQ(result.cast<Integer>()->value, 5);
+
+  // The functions and the environments referenced by `env` are alive.
+  heap.collect();
+  ASSERT_GT(heap.size(), before);
+  result = testEval("addTwo(40)", env);
+  ASSERT_EQ(result.cast<Integer>()->value, 42);
+
+  // A function and the environment it is defined in reference each other.
+  env.reset();
+  heap.collect();
+  ASSERT_EQ(heap.size(), before);
+}
+
+TEST(Heap, TestYoungCycle) {
+  Heap &heap = Heap::current();
+  heap.collect();
+
+  auto old = makeRef<Array>();
+  heap.collect();
+  ASSERT_TRUE(old->isOld());
+
+  // The young array is only referenced by the old one, it survives.
+  auto young = makeRef<Array>();
+  old->elements.push_back(young);
+  young.reset();
+
+  {
+    auto array = makeRef<Array>();
+    array->elements.push_back(array);
+  }
+
+  // The arrays and the leaves of their elements
+  ASSERT_EQ(heap.sizeYoung(), 4u);
+  ASSERT_EQ(heap.collectYoung(), 2u);
+  ASSERT_EQ(heap.sizeYoung(), 0u);
+  ASSERT_TRUE(old->elements[0]->isOld());
+}
+
+TEST(Heap, TestGrowthTrigger) {
+  Heap &heap = Heap::current();
+  heap.youngLimit = 16;
+  heap.minThreshold = 64;
+  heap.collect();
+  auto collections = heap.stats.collections;
+
+  auto env = makeRef<Environment>();
+  auto result = testEval("let sum = fn(n) { if (n == 0) { 0 } else { n + sum(n - 1) } }; sum(200);", env);
+  ASSERT_EQ(result.cast<Integer>()->value, 20100);
+
+  ASSERT_GT(heap.stats.collections, collections);
+  ASSERT_GT(heap.stats.minorCollections, 0u);
+  ASSERT_GE(heap.stats.maxPause, heap.stats.lastPause);
+  heap.youngLimit = Heap::DefaultYoungLimit;
+  heap.minThreshold = Heap::DefaultThreshold;
+}
+
+TEST(Heap, TestNursery) {
+  Nursery &nursery = Nursery::current();
+  auto stats = nursery.stats;
+
+  // The temporaries keep reusing the same slot
+  for (int i = 0; i < 100000; i++) {
+    auto string = makeRef<String>("monkey");
+  }
+  ASSERT_EQ(nursery.stats.allocations, stats.allocations + 100000);
+  ASSERT_LE(nursery.stats.chunks, stats.chunks + 1);
+
+  // A long lived object is still valid after the others are freed
+  auto kept = makeRef<String>("kept");
+  for (int i = 0; i < 10000; i++) {
+    auto array = makeRef<Array>();
+  }
+  ASSERT_EQ(kept->value(), "kept");
+
+  // The freed slots are reused by the same size class
+  auto sizeClass = Nursery::sizeClassOf(sizeof(Array));
+  auto slabs = nursery.classes[sizeClass].slabs;
+  std::vector<Ref<Array>> arrays(1000);
+  for (int round = 0; round < 10; round++) {
+    for (auto &&array : arrays) {
+      array = makeRef<Array>();
+    }
+  }
+  ASSERT_LE(nursery.classes[sizeClass].slabs, slabs + 2);
+  ASSERT_EQ(Object::counters().allocated[static_cast<std::size_t>(ObjectKind::Array)] -
+                Object::counters().freed[static_cast<std::size_t>(ObjectKind::Array)],
+            1000u);
+
+  nursery.enabled = false;
+  auto string = makeRef<String>("malloc");
+  ASSERT_EQ(nursery.stats.fallbacks, stats.fallbacks + 1);
+  nursery.enabled = true;
+}
+
+TEST(Heap, TestPersistentVector) {
+  Heap &heap = Heap::current();
+  // The garbage of the earlier tests must not be counted
+  heap.collect();
+  std::size_t before = heap.size();
+
+  {
+    // Each push keeps the previous arrays unchanged
+    std::vector<Ref<Array>> arrays{makeRef<Array>()};
+    for (int i = 0; i < 2000; i++) {
+      auto array = makeRef<Array>();
+      array->elements = arrays.back()->elements;
+      array->elements.push_back(Integer::of(i));
+      arrays.push_back(array);
+    }
+    for (std::size_t i = 0; i < arrays.size(); i += 97) {
+      ASSERT_EQ(arrays[i]->elements.size(), i);
+      for (std::size_t j = 0; j < i; j++) {
+        ASSERT_EQ(arrays[i]->elements[j].cast<Integer>()->value, static_cast<int64_t>(j));
+      }
+    }
+
+    // Appending to a shared tail twice copies it for the second one
+    auto left = arrays[10]->elements;
+    auto right = arrays[10]->elements;
+    left.push_back(makeRef<String>("left"));
+    right.push_back(makeRef<String>("right"));
+    ASSERT_EQ(left.back().cast<String>()->value(), "left");
+    ASSERT_EQ(right.back().cast<String>()->value(), "right");
+    ASSERT_EQ(arrays[11]->elements[10].cast<Integer>()->value, 10);
+
+    // The rest is a view
+    auto rest = arrays.back()->elements.rest().rest();
+    ASSERT_EQ(rest.size(), 1998u);
+    ASSERT_EQ(rest.front().cast<Integer>()->value, 2);
+    ASSERT_EQ(rest.back().cast<Integer>()->value, 1999);
+  }
+  ASSERT_EQ(heap.size(), before);
+
+  // A cycle through the leaves is collected
+  {
+    auto array = makeRef<Array>();
+    for (int i = 0; i < 100; i++) {
+      array->elements.push_back(Integer::of(i));
+    }
+    array->elements.push_back(array);
+  }
+  ASSERT_GT(heap.size(), before);
+  heap.collect();
+  ASSERT_EQ(heap.size(), before);
+}
+
+TEST(Heap, TestHashTable) {
+  Heap &heap = Heap::current();
+  std::size_t before = heap.size();
+
+  {
+    auto hash = makeRef<Hash>();
+    for (int i = 0; i < 10000; i++) {
+      hash->pairs.set(Integer::of(i * 7), Integer::of(i));
+      hash->pairs.set(makeRef<String>("key" + std::to_string(i)), Integer::of(-i));
+    }
+    ASSERT_EQ(hash->pairs.size(), 20000u);
+
+    // Overwriting keeps the order and the size
+    hash->pairs.set(Integer::of(0), makeRef<String>("zero"));
+    ASSERT_EQ(hash->pairs.size(), 20000u);
+    ASSERT_EQ(hash->pairs.entries()[0].value.cast<String>()->value(), "zero");
+
+    for (int i = 1; i < 10000; i++) {
+      auto found = hash->pairs.find(Integer::of(i * 7).get());
+      ASSERT_NE(found, nullptr);
+      ASSERT_EQ(found->cast<Integer>()->value, i);
+
+      auto key = makeRef<String>("key" + std::to_string(i));
+      ASSERT_EQ(hash->pairs.find(key.get())->cast<Integer>()->value, -i);
+    }
+    ASSERT_EQ(hash->pairs.find(Integer::of(1).get()), nullptr);
+    ASSERT_EQ(hash->pairs.find(Boolean::of(true).get()), nullptr);
+
+    // The hash is a container, it could be part of a cycle
+    hash->pairs.set(makeRef<String>("self"), hash);
+  }
+  heap.collect();
+  ASSERT_EQ(heap.size(), before);
+}
+
+TEST(Heap, TestUnboxedArray) {
+  auto env = makeRef<Environment>();
+
+  // The arrays of integers are stored unboxed
+  auto result = testEval("[1, 2, 3]", env);
+  ASSERT_TRUE(result.cast<Array>()->unboxed);
+  ASSERT_EQ(result.cast<Array>()->get(2).cast<Integer>()->value, 3);
+
+  // Pushing another type boxes the new array only
+  result = testEval(R"(let a = push([1, 2], 3); let b = push(a, "monkey"); [a, b])", env);
+  auto a = result.cast<Array>()->get(0).cast<Array>();
+  auto b = result.cast<Array>()->get(1).cast<Array>();
+  ASSERT_TRUE(a->unboxed);
+  ASSERT_FALSE(b->unboxed);
+  ASSERT_EQ(a->size(), 3u);
+  ASSERT_EQ(b->size(), 4u);
+  ASSERT_EQ(b->get(2).cast<Integer>()->value, 3);
+  ASSERT_EQ(b->get(3).cast<String>()->value(), "monkey");
+
+  // Pushing twice onto the same array keeps both
+  result = testEval("let c = push(a, 4); let d = push(a, 5); [sum(c), sum(d), len(a)]", env);
+  ASSERT_EQ(result.cast<Array>()->get(0).cast<Integer>()->value, 10);
+  ASSERT_EQ(result.cast<Array>()->get(1).cast<Integer>()->value, 11);
+  ASSERT_EQ(result.cast<Array>()->get(2).cast<Integer>()->value, 3);
+
+  // The kernels accept the boxed arrays of integers too
+  result = testEval(R"(sum(rest(push(["x"], 2))))", env);
+  ASSERT_EQ(result.cast<Integer>()->value, 2);
+  result = testEval("sum([[1], 2])", env);
+  ASSERT_TRUE(result->is<Error>());
+  result = testEval("min([])", env);
+  ASSERT_EQ(result, nullptr);
+}
+
+TEST(Heap, TestIteratorCycle) {
+  Heap &heap = Heap::current();
+  std::size_t before = heap.size();
+
+  // The mapped iterator holds the function, whose environment holds the iterator
+  auto env = makeRef<Environment>();
+  auto result = testEval("let f = fn(x) { x + 1 }; let it = map(range(10), f); sum(take(it, 3))", env);
+  ASSERT_EQ(result.cast<Integer>()->value, 6);
+  ASSERT_GT(heap.size(HeapSpace::Iterators), 0u);
+
+  env.reset();
+  result.reset();
+  heap.collect();
+  ASSERT_EQ(heap.size(), before);
+}
@@ -0,0 +1,105 @@
+#include "evaluator.hpp"
+#include "lexer.hpp"
+#include "object.hpp"
+#include "parser.hpp"
+#include "profiler.hpp"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <sstream>
+#include <string>
+
+Ref<Object> testEval(const std::string &input, Profiler *profiler);
+
+Ref<Object> testEval(const std::string &input, Profiler *profiler) {
+  Lexer lexer{input};
+  Parser parser{&lexer};
+
+  auto program = parser.parseProgram();
+  auto env = makeRef<Environment>();
+
+  Evaluator::setProfiler(profiler);
+  auto result = Evaluator::eval(program.get(), env);
+  Evaluator::setProfiler(nullptr);
+
+  return result;
+}
+
+TEST(Profiler, TestFunctionStatistics) {
+  std::string input = "let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }; \
+                       let double = fn(x) { x * 2 }; \
+                       double(fib(10));";
+
+  Profiler profiler{};
+  auto result = testEval(input, &profiler);
+
+  Integer *integer = dynamic_cast<Integer *>(result.get());
+  ASSERT_NE(integer, nullptr);
+  ASSERT_EQ(integer->value, 110);
+
+  auto functions = profiler.topFunctions(10);
+  ASSERT_EQ(functions.size(), 2);
+  ASSERT_EQ(functions[0].label, "fib");
+  ASSERT_EQ(functions[0].visits, 177);
+  ASSERT_EQ(functions[1].label, "double");
+  ASSERT_EQ(functions[1].visits, 1);
+
+  // The recursive calls are not counted twice
+  ASSERT_LE(functions[0].exclusive, functions[0].inclusive);
+
+  auto nodes = profiler.topNodes(3);
+  ASSERT_EQ(nodes.size(), 3);
+  for (auto &&node : nodes) {
+    ASSERT_FALSE(node.label.empty());
+    ASSERT_GT(node.visits, 0);
+  }
+}
+
+TEST(Profiler, TestCollapsedStacks) {
+  std::string input = "let f = fn(n) { if (n == 0) { 0 } else { f(n - 1) } }; \
+                       let g = fn() { f(2) }; \
+                       g();";
+
+  Profiler profiler{};
+  testEval(input, &profiler);
+
+  std::stringstream ss;
+  profiler.writeCollapsedStacks(ss);
+  std::string stacks = ss.str();
+
+  ASSERT_NE(stacks.find("main "), std::string::npos);
+  ASSERT_NE(stacks.find("main;g;f;f;f "), std::string::npos);
+  ASSERT_EQ(stacks.find("main;f"), std::string::npos);
+
+  std::stringstream report;
+  profiler.report(report, 5);
+  ASSERT_NE(report.str().find("hottest functions"), std::string::npos);
+}
+
+TEST(Profiler, TestDisabled) {
+  Profiler profiler{};
+  testEval("let f = fn(x) { x }; f(1);", nullptr);
+
+  ASSERT_TRUE(profiler.topFunctions(10).empty());
+  ASSERT_TRUE(profiler.topNodes(10).empty());
+}
+
+TEST(Profiler, TestPrograms) {
+  // Each program is freed after it runs, the next one could reuse the
+  // addresses of its nodes.
+  Profiler profiler{};
+  for (int i = 0; i < 3; i++) {
+    testEval("1 + 2;", &profiler);
+    testEval("3 * 4;", &profiler);
+  }
+
+  // The program, the statement and the expression print alike
+  std::size_t sums{0}, products{0};
+  for (auto &&node : profiler.topNodes(100)) {
+    ASSERT_EQ(node.visits, 3) << node.label;
+    sums += node.label == "(1 + 2)";
+    products += node.label == "(3 * 4)";
+  }
+  ASSERT_EQ(sums, 3);
+  ASSERT_EQ(products, 3);
+}
@@ -0,0 +1,151 @@
+#include "lexer.hpp"
+#include "object.hpp"
+#include "parser.hpp"
+#include "spdlog/spdlog.h"
+#include "stackEvaluator.hpp"
+
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+Ref<Object> testEval(const std::string &input);
+bool testIntegerObject(Object *object, int64_t expected);
+
+Ref<Object> testEval(const std::string &input) {
+  Lexer lexer{input};
+  Parser parser{&lexer};
+
+  auto program = parser.parseProgram();
+  auto env = makeRef<Environment>();
+
+  StackEvaluator evaluator{};
+  return evaluator.eval(program.get(), env);
+}
+
+bool testIntegerObject(Object *object, int64_t expected) {
+  Integer *integer = dynamic_cast<Integer *>(object);
+
+  if (integer == nullptr) {
+    spdlog::error("object is not Integer");
+    return false;
+  }
+
+  if (integer->value != expected) {
+    spdlog::error("object has wrong value. got={}, want={}", integer->value, expected);
+    return false;
+  }
+
+  return true;
+}
+
+TEST(StackEvaluator, TestIntegerResults) {
+  struct TestData {
+    std::string input;
+    int64_t expected;
+
+    TestData(const std::string &s, int64_t v) : input{s}, expected{v} {}
+  };
+
+  std::vector<TestData> tests{
+      {"(5 + 10 * 2 + 15 / 3) * 2 + -10", 50},
+      {"if (1 > 2) { 10 } else { 20 }", 20},
+      {"9; return 2 * 5; 9;", 10},
+      {"if (10 > 1) { if (10 > 1) {return 10;} return 1;}", 10},
+      {"let a = 5; let b = a; let c = a + b + 5; c;", 15},
+      {"let add = fn(x, y) { x + y; }; add(5 + 5, add(5, 5));", 20},
+      {"let f = fn(x) { if (x > 1) { return x; } 0; }; f(3) + f(1);", 3},
+      {"let newAdder = fn(x) { fn(y){x + y}; }; let addTwo = newAdder(2); addTwo(2);", 4},
+      {"let applyFunc = fn(a, b, func) { func(a, b)}; applyFunc(10, 2, fn(a, b) {a - b})", 8},
+      {"let myArray = [1,2,3]; myArray[0] + myArray[1] + myArray[2];", 6},
+      {R"(len("four") + len(push([1], 2)))", 6},
+      {R"(let h = {"one": 1, 2: 20, true: 300}; h["one"] + h[1 + 1] + h[1 < 2])", 321},
+  };
+
+  for (auto &&test : tests) {
+    if (!testIntegerObject(testEval(test.input).get(), test.expected)) {
+      FAIL();
+    }
+  }
+}
+
+TEST(StackEvaluator, TestErrorHandling) {
+  struct TestData {
+    std::string input;
+    std::string expectedMessage;
+
+    TestData(const std::string &s, const std::string &m) : input{s}, expectedMessage{m} {}
+  };
+
+  std::vector<TestData> tests{
+      {"5 + true; 5;", "type mismatch: INTEGER + BOOLEAN"},
+      {"if (10 > 1) { if (10 > 1) {return true + false;} return 1;}", "unknown operator: BOOLEAN + BOOLEAN"},
+      {"-foobar", "identifier not found: foobar"},
+      {"let f = fn(x) { x + y }; f(1) + 2;", "identifier not found: y"},
+      {"{[1]: 2}", "unusable as hash key: ARRAY"},
+  };
+
+  for (auto &&test : tests) {
+    auto evaluated = testEval(test.input);
+
+    Error *error = dynamic_cast<Error *>(evaluated.get());
+    if (error == nullptr) {
+      spdlog::error("no error object returned");
+      FAIL();
+    }
+
+    if (error->message != test.expectedMessage) {
+      spdlog::error("wrong error message. expected='{}', got='{}'", test.expectedMessage, error->message);
+      FAIL();
+    }
+  }
+}
+
+TEST(StackEvaluator, TestDeepRecursion) {
+  // This would overflow the C++ stack with the recursive `Evaluator`.
+  std::string input = "let countDown = fn(n) { if (n == 0) { 0 } else { 1 + countDown(n - 1) } }; \
+                       countDown(100000);";
+
+  if (!testIntegerObject(testEval(input).get(), 100000)) {
+    FAIL();
+  }
+}
+
+TEST(StackEvaluator, TestSuspendAndResume) {
+  std::string input = "let sum = fn(n) { if (n == 0) { 0 } else { n + sum(n - 1) } }; sum(100);";
+
+  Lexer lexer{input};
+  Parser parser{&lexer};
+  auto program = parser.parseProgram();
+  auto env = makeRef<Environment>();
+
+  StackEvaluator evaluator{};
+  evaluator.start(program.get(), env);
+
+  int slices = 0;
+  while (!evaluator.step(10)) {
+    ASSERT_EQ(evaluator.result(), nullptr);
+    slices++;
+  }
+
+  ASSERT_GT(slices, 1);
+  if (!testIntegerObject(evaluator.result().get(), 5050)) {
+    FAIL();
+  }
+}
+
+TEST(StackEvaluator, TestLongStringConcatenation) {
+  // Each `+` makes a rope node, the rope is 30000 levels deep.
+  std::string input = R"(let build = fn(n, s) { if (n == 0) { s } else { build(n - 1, s + "ab") } };
+                         build(30000, "");)";
+
+  auto evaluated = testEval(input);
+  ASSERT_TRUE(evaluated->is<String>());
+
+  String *string = evaluated->as<String>();
+  ASSERT_EQ(string->size(), 60000u);
+  ASSERT_TRUE(string->isRope());
+  ASSERT_EQ(string->value().substr(0, 6), "ababab");
+  ASSERT_FALSE(string->isRope());
+}
@@ -37,6 +37,9 @@ Token Lexer::nextToken() {
     case ';':
       token.setToken(TokenTypes::SEMICOLON, ch);
       break;
+    case ':':
+      token.setToken(TokenTypes::COLON, ch);
+      break;
     case '(':
       token.setToken(TokenTypes::LPAREN, ch);
       break;
@@ -99,9 +102,7 @@ Token Lexer::nextToken() {
         token.setIdentifiers(token.Literal);
         return token;
       } else if (isDigit(ch)) {
-        token.Type = TokenTypes::INT;
-        token.Literal = consecutiveSubstring(isDigit);
-        return token;
+        return readNumber();
       } else {
         token.setToken(TokenTypes::ILLEGAL, ch);
       }
@@ -129,6 +130,24 @@ std::string Lexer::consecutiveSubstring(std::function<bool(char)> fn) {
   return input.substr(originalPosition, position - originalPosition);
 }
 
+Token Lexer::readNumber() {
+  Token token{};
+  int originalPosition = position;
+
+  consecutiveSubstring(isDigit);
+  token.Type = TokenTypes::INT;
+
+  // A dot followed by a digit makes it a decimal, `1.` is not.
+  if (ch == '.' && isDigit(examineNextChar())) {
+    readChar();
+    consecutiveSubstring(isDigit);
+    token.Type = TokenTypes::FLOAT;
+  }
+
+  token.Literal = input.substr(originalPosition, position - originalPosition);
+  return token;
+}
+
 std::string Lexer::readString() {
   int originalPosition = position + 1;
 
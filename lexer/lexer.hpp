@@ -46,6 +46,13 @@ public:
    */
   std::string consecutiveSubstring(std::function<bool(char)> fn);
 
+  /**
+   * @brief read the integer such as `5`, or the decimal such as `3.14`.
+   *
+   * @return Token
+   */
+  Token readNumber();
+
   /**
    * @brief read the string.
    *
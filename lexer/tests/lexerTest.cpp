@@ -309,3 +309,69 @@ TEST(Lexer, TestArrayToken) {
     }
   }
 }
+
+TEST(Lexer, TestHashToken) {
+  std::string input = R"({"one": 1})";
+
+  std::vector<TestToken> tests{
+      {TokenTypes::LBRACE, "{"},
+      {TokenTypes::STRING, "one"},
+      {TokenTypes::COLON, ":"},
+      {TokenTypes::INT, "1"},
+      {TokenTypes::RBRACE, "}"},
+      {TokenTypes::_EOF, ""},
+  };
+
+  Lexer l{input};
+
+  for (int i = 0; i < tests.size(); ++i) {
+    Token token = l.nextToken();
+
+    TestToken &testToken = tests[i];
+
+    if (token.Type != testToken.expectedType) {
+      spdlog::error("test[{}] - token type wrong. expected='{}', got='{}'", i, testToken.expectedType, token.Type);
+      FAIL();
+    }
+
+    if (token.Literal != testToken.expectedLiteral) {
+      spdlog::error(
+          "test[{}] - token literal wrong. expected='{}', got='{}'", i, testToken.expectedLiteral, token.Literal);
+      FAIL();
+    }
+  }
+}
+
+TEST(Lexer, TestFloatToken) {
+  std::string input = "3.14 + 10. 2.5.1";
+
+  std::vector<TestToken> tests{
+      {TokenTypes::FLOAT, "3.14"},
+      {TokenTypes::PLUS, "+"},
+      {TokenTypes::INT, "10"},
+      {TokenTypes::ILLEGAL, "."},
+      {TokenTypes::FLOAT, "2.5"},
+      {TokenTypes::ILLEGAL, "."},
+      {TokenTypes::INT, "1"},
+      {TokenTypes::_EOF, ""},
+  };
+
+  Lexer l{input};
+
+  for (int i = 0; i < tests.size(); ++i) {
+    Token token = l.nextToken();
+
+    TestToken &testToken = tests[i];
+
+    if (token.Type != testToken.expectedType) {
+      spdlog::error("test[{}] - token type wrong. expected='{}', got='{}'", i, testToken.expectedType, token.Type);
+      FAIL();
+    }
+
+    if (token.Literal != testToken.expectedLiteral) {
+      spdlog::error(
+          "test[{}] - token literal wrong. expected='{}', got='{}'", i, testToken.expectedLiteral, token.Literal);
+      FAIL();
+    }
+  }
+}
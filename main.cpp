@@ -4,8 +4,10 @@
 #include <iostream>
 
 int main(int argc, char *argv[]) {
-  if (argc != 2 || (strcmp(argv[1], "i") != 0 && strcmp(argv[1], "c") != 0)) {
-    std::cout << "usage: ./cppmpiler [i|c] (i: interpreter mode, c : compiler mode)\n";
+  if (argc < 2 || argc > 3 || (strcmp(argv[1], "i") != 0 && strcmp(argv[1], "c") != 0) ||
+      (argc == 3 && (strcmp(argv[1], "i") != 0 || strcmp(argv[2], "--profile") != 0))) {
+    std::cout << "usage: ./cppmpiler [i|c] [--profile] (i: interpreter mode, c : compiler mode, --profile: profile "
+                 "the interpreter)\n";
     return 0;
   }
 
@@ -13,7 +15,7 @@ int main(int argc, char *argv[]) {
   std::cout << "Feel free to type in commands\n";
 
   if (strcmp(argv[1], "i") == 0) {
-    startInterpreter();
+    startInterpreter(argc == 3);
   } else {
     startCompiler();
   }
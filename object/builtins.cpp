@@ -1,115 +1,686 @@
 #include "builtins.hpp"
 
+#include "iterator.hpp"
+#include "json.hpp"
+#include "kernels.hpp"
+#include "mappedFile.hpp"
+#include "output.hpp"
+#include "serializer.hpp"
+#include "sort.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
 #include <string_view>
+#include <vector>
+
+static Value newError(const std::string &s);
+static Ref<Builtin> newBuiltin(const char *name, BuiltinFunction fn, int minArity, int maxArity);
+static bool integersOf(const Value &value, std::vector<int64_t> &scratch, const int64_t *&integers);
+static Value checkCallback(const std::string &name, Arguments &arguments, const Value &fn);
+static Value sumOf(Iterator *iterator, Caller *caller);
+static Value elementwise(const std::string &name,
+                         Arguments arguments,
+                         void (*kernel)(const int64_t *, const int64_t *, int64_t *, std::size_t));
 
-static std::shared_ptr<Error> newError(const std::string &s);
+static Value newError(const std::string &s) { return makeRef<Error>(s); }
 
-static std::shared_ptr<Error> newError(const std::string &s) { return std::make_shared<Error>(s); }
+/**
+ * @brief tick the budget of the caller for one element of a native loop
+ *
+ * @return bool false if it is exhausted, `error` is the `BudgetError` then
+ */
+static inline bool ticked(Caller *caller, Value &error) { return caller == nullptr || caller->tick(error); }
 
-constexpr std::string_view INTEGER_OBJ = "INTEGER";
-constexpr std::string_view BOOLEAN_OBJ = "BOOLEAN";
-constexpr std::string_view RETURN_VALUE_OBJ = "RETURN_VALUE";
-constexpr std::string_view ERROR_OBJ = "ERROR";
-constexpr std::string_view STRING_OBJ = "STRING";
-constexpr std::string_view ARRAY_OBJ = "ARRAY";
+static Ref<Builtin> newBuiltin(const char *name, BuiltinFunction fn, int minArity, int maxArity) {
+  // The builtins are shared by all the VMs, they must not be counted.
+  auto builtin = makeRef<Builtin>(name, fn, minArity, maxArity);
+  builtin->freeze();
+  return builtin;
+}
 
-std::unordered_map<std::string, std::shared_ptr<Builtin>> Builtins::builtins = {
-    {"len", std::make_shared<Builtin>(len)},
-    {"first", std::make_shared<Builtin>(first)},
-    {"last", std::make_shared<Builtin>(last)},
-    {"rest", std::make_shared<Builtin>(rest)},
-    {"push", std::make_shared<Builtin>(push)},
+// The index of a builtin is its id in the bytecode, append the new ones.
+std::vector<Ref<Builtin>> Builtins::builtins = {
+    newBuiltin("len", len, 1, 1),
+    newBuiltin("first", first, 1, 1),
+    newBuiltin("last", last, 1, 1),
+    newBuiltin("rest", rest, 1, 1),
+    newBuiltin("push", push, 2, 2),
+    newBuiltin("sum", sum, 1, 1),
+    newBuiltin("min", min, 1, 1),
+    newBuiltin("max", max, 1, 1),
+    newBuiltin("dot", dot, 2, 2),
+    newBuiltin("add", add, 2, 2),
+    newBuiltin("mul", mul, 2, 2),
+    newBuiltin("map", map, 2, 2),
+    newBuiltin("filter", filter, 2, 2),
+    newBuiltin("reduce", reduce, 3, 3),
+    newBuiltin("range", range, 1, 3),
+    newBuiltin("each", each, 2, 2),
+    newBuiltin("take", take, 2, 2),
+    newBuiltin("zip", zip, 2, 2),
+    newBuiltin("chars", chars, 1, 1),
+    newBuiltin("lines", lines, 1, 1),
+    newBuiltin("collect", collect, 1, 1),
+    newBuiltin("count", count, 1, 1),
+    newBuiltin("sort", sort, 1, 2),
+    newBuiltin("readFile", readFile, 1, 1),
+    newBuiltin("readLines", readLines, 1, 1),
+    newBuiltin("writeFile", writeFile, 2, 2),
+    newBuiltin("puts", puts, 0, Builtin::Variadic),
+    newBuiltin("print", print, 0, Builtin::Variadic),
+    newBuiltin("jsonParse", jsonParse, 1, 1),
+    newBuiltin("jsonStringify", jsonStringify, 1, 1),
+    newBuiltin("serialize", serialize, 1, 1),
+    newBuiltin("deserialize", deserialize, 1, 1),
 };
 
-std::vector<std::string> Builtins::builtinNames = {"len", "first", "last", "rest", "push"};
+std::vector<std::string> Builtins::builtinNames = [] {
+  std::vector<std::string> names{};
+  for (auto &&builtin : builtins) {
+    names.emplace_back(builtin->name);
+  }
+  return names;
+}();
+
+std::vector<Value> Builtins::values{builtins.begin(), builtins.end()};
+
+std::unordered_map<std::string, int> Builtins::indices = [] {
+  std::unordered_map<std::string, int> indices{};
+  for (std::size_t i = 0; i < builtins.size(); i++) {
+    indices.emplace(builtins[i]->name, static_cast<int>(i));
+  }
+  return indices;
+}();
+
+Ref<Builtin> Builtins::lookup(const std::string &name) {
+  auto iter = indices.find(name);
+  if (iter == indices.end()) {
+    return nullptr;
+  }
+  return builtins[iter->second];
+}
+
+/**
+ * @brief get the integers of an array, an unboxed array is used in place
+ * and the boxed one is copied into `scratch`
+ *
+ * @return bool whether the value is an array of integers
+ */
+static bool integersOf(const Value &value, std::vector<int64_t> &scratch, const int64_t *&integers) {
+  if (!value.is<Array>()) {
+    return false;
+  }
+
+  Array *array = value.as<Array>();
+  if (array->unboxed) {
+    integers = array->integers.data();
+    return true;
+  }
+
+  scratch.clear();
+  scratch.reserve(array->size());
+  for (auto &&element : array->elements) {
+    if (element == nullptr || !element->is<Integer>()) {
+      return false;
+    }
+    scratch.push_back(element->as<Integer>()->value);
+  }
+  integers = scratch.data();
+  return true;
+}
 
-std::shared_ptr<Object> Builtins::len(std::vector<std::shared_ptr<Object>> &arguments) {
-  if (arguments.size() != 1) {
-    return newError("wrong number of arguments. got=" + std::to_string(arguments.size()) + ", want=1");
+/**
+ * @brief check the callback of the higher-order builtins
+ *
+ * @return Value the error, null if the callback could be called
+ */
+static Value checkCallback(const std::string &name, Arguments &arguments, const Value &fn) {
+  if (!fn.is<Closure>() && !fn.is<Function>() && !fn.is<Builtin>()) {
+    return newError("argument to " + name + " must be a function, got " + fn.type());
   }
+  if (arguments.caller == nullptr) {
+    return newError(name + " could not call back here");
+  }
+  return nullptr;
+}
 
-  String *str = dynamic_cast<String *>(arguments[0].get());
-  if (str == nullptr) {
-    Array *array = dynamic_cast<Array *>(arguments[0].get());
-    if (array != nullptr) {
-      return std::make_shared<Integer>(array->elements.size());
+/**
+ * @brief sum the numbers of the iterator as they are pulled, the sum of
+ * the integers is an integer until a float comes
+ *
+ */
+static Value sumOf(Iterator *iterator, Caller *caller) {
+  int64_t integer{0};
+  double floating{0};
+  bool isFloat{false};
+
+  Value element{};
+  while (iterator->next(caller, element)) {
+    if (!ticked(caller, element)) {
+      return element;
+    }
+    if (element.isInteger() && !isFloat) {
+      integer = static_cast<int64_t>(static_cast<uint64_t>(integer) + static_cast<uint64_t>(element.getInteger()));
+    } else if (element.isNumber()) {
+      if (!isFloat) {
+        isFloat = true;
+        floating = static_cast<double>(integer);
+      }
+      floating += element.getNumber();
+    } else {
+      return newError("elements of sum must be INTEGER or FLOAT, got " + element.type());
     }
-    return newError("argument to len not supported, got " + arguments[0]->type());
+  }
+  if (!element.isNull()) {
+    return element;
   }
 
-  return std::make_shared<Integer>(str->value.size());
+  return isFloat ? Value::fromFloat(floating) : Value::fromInteger(integer);
 }
 
-std::shared_ptr<Object> Builtins::first(std::vector<std::shared_ptr<Object>> &arguments) {
-  if (arguments.size() != 1) {
-    return newError("wrong number of arguments. got=" + std::to_string(arguments.size()) + ", want=1");
+/**
+ * @brief apply the elementwise kernel on two arrays of the same length
+ *
+ */
+static Value elementwise(const std::string &name,
+                         Arguments arguments,
+                         void (*kernel)(const int64_t *, const int64_t *, int64_t *, std::size_t)) {
+  std::vector<int64_t> leftScratch{}, rightScratch{};
+  const int64_t *left{}, *right{};
+  if (!integersOf(arguments[0], leftScratch, left) || !integersOf(arguments[1], rightScratch, right)) {
+    return newError("arguments to " + name + " must be ARRAY of INTEGER");
   }
 
-  if (arguments[0]->type() != ARRAY_OBJ) {
+  std::size_t count = arguments[0].as<Array>()->size();
+  if (arguments[1].as<Array>()->size() != count) {
+    return newError("arguments to " + name + " must have the same length");
+  }
+
+  IntVector result{};
+  kernel(left, right, result.resize(count), count);
+  return Array::from(std::move(result));
+}
+
+Value Builtins::len(Arguments arguments) {
+  if (arguments[0].is<String>()) {
+    return Value::fromInteger(arguments[0].as<String>()->size());
+  }
+
+  if (arguments[0].is<Array>()) {
+    return Value::fromInteger(arguments[0].as<Array>()->size());
+  }
+
+  return newError("argument to len not supported, got " + arguments[0].type());
+}
+
+Value Builtins::first(Arguments arguments) {
+  if (!arguments[0].is<Array>()) {
     return newError("argument to first must be ARRAY");
   }
 
-  Array *array = dynamic_cast<Array *>(arguments[0].get());
-  if (array->elements.size() > 0) {
-    return array->elements[0];
+  Array *array = arguments[0].as<Array>();
+  if (!array->empty()) {
+    return array->valueAt(0);
   }
   return nullptr;
 }
 
-std::shared_ptr<Object> Builtins::last(std::vector<std::shared_ptr<Object>> &arguments) {
-  if (arguments.size() != 1) {
-    return newError("wrong number of arguments. got=" + std::to_string(arguments.size()) + ", want=1");
+Value Builtins::last(Arguments arguments) {
+  if (!arguments[0].is<Array>()) {
+    return newError("argument to first must be ARRAY");
+  }
+
+  Array *array = arguments[0].as<Array>();
+  if (!array->empty()) {
+    return array->valueAt(array->size() - 1);
   }
+  return nullptr;
+}
 
-  if (arguments[0]->type() != ARRAY_OBJ) {
+Value Builtins::rest(Arguments arguments) {
+  if (!arguments[0].is<Array>()) {
     return newError("argument to first must be ARRAY");
   }
 
-  Array *array = dynamic_cast<Array *>(arguments[0].get());
-  if (array->elements.size() > 0) {
-    return array->elements[array->elements.size() - 1];
+  Array *array = arguments[0].as<Array>();
+  if (!array->empty()) {
+    return array->rest();
   }
+
   return nullptr;
 }
 
-std::shared_ptr<Object> Builtins::rest(std::vector<std::shared_ptr<Object>> &arguments) {
-  if (arguments.size() != 1) {
-    return newError("wrong number of arguments. got=" + std::to_string(arguments.size()) + ", want=1");
+Value Builtins::push(Arguments arguments) {
+  if (!arguments[0].is<Array>()) {
+    return newError("argument to first must be ARRAY");
   }
 
-  if (arguments[0]->type() != ARRAY_OBJ) {
-    return newError("argument to first must be ARRAY");
+  // The new array shares the elements, the original one is unchanged
+  return arguments[0].as<Array>()->pushed(arguments[1]);
+}
+
+Value Builtins::sum(Arguments arguments) {
+  if (arguments[0].is<Iterator>()) {
+    return sumOf(arguments[0].as<Iterator>(), arguments.caller);
+  }
+
+  std::vector<int64_t> scratch{};
+  const int64_t *integers{};
+  if (!integersOf(arguments[0], scratch, integers)) {
+    return newError("argument to sum must be ARRAY of INTEGER");
+  }
+
+  return Value::fromInteger(Kernels::sum(integers, arguments[0].as<Array>()->size()));
+}
+
+Value Builtins::min(Arguments arguments) {
+  std::vector<int64_t> scratch{};
+  const int64_t *integers{};
+  if (!integersOf(arguments[0], scratch, integers)) {
+    return newError("argument to min must be ARRAY of INTEGER");
+  }
+
+  std::size_t count = arguments[0].as<Array>()->size();
+  if (count == 0) {
+    return nullptr;
+  }
+  return Value::fromInteger(Kernels::min(integers, count));
+}
+
+Value Builtins::max(Arguments arguments) {
+  std::vector<int64_t> scratch{};
+  const int64_t *integers{};
+  if (!integersOf(arguments[0], scratch, integers)) {
+    return newError("argument to max must be ARRAY of INTEGER");
+  }
+
+  std::size_t count = arguments[0].as<Array>()->size();
+  if (count == 0) {
+    return nullptr;
+  }
+  return Value::fromInteger(Kernels::max(integers, count));
+}
+
+Value Builtins::dot(Arguments arguments) {
+  std::vector<int64_t> leftScratch{}, rightScratch{};
+  const int64_t *left{}, *right{};
+  if (!integersOf(arguments[0], leftScratch, left) || !integersOf(arguments[1], rightScratch, right)) {
+    return newError("arguments to dot must be ARRAY of INTEGER");
+  }
+
+  std::size_t count = arguments[0].as<Array>()->size();
+  if (arguments[1].as<Array>()->size() != count) {
+    return newError("arguments to dot must have the same length");
+  }
+
+  return Value::fromInteger(Kernels::dot(left, right, count));
+}
+
+Value Builtins::add(Arguments arguments) { return elementwise("add", arguments, Kernels::add); }
+
+Value Builtins::mul(Arguments arguments) { return elementwise("mul", arguments, Kernels::mul); }
+
+Value Builtins::map(Arguments arguments) {
+  auto error = checkCallback("map", arguments, arguments[1]);
+  if (!error.isNull()) {
+    return error;
+  }
+
+  // An iterator is mapped lazily
+  if (arguments[0].is<Iterator>()) {
+    return makeRef<MapIterator>(arguments[0].share<Iterator>(), arguments[1]);
+  }
+  if (!arguments[0].is<Array>()) {
+    return newError("argument to map must be ARRAY or ITERATOR, got " + arguments[0].type());
+  }
+
+  Array *array = arguments[0].as<Array>();
+  std::vector<Value> results{};
+  results.reserve(array->size());
+  for (std::size_t i = 0; i < array->size(); i++) {
+    Value element = array->valueAt(i);
+    Value result{};
+    if (!ticked(arguments.caller, result)) {
+      return result;
+    }
+    result = arguments.caller->call(arguments[1], &element, 1);
+    if (result.is<Error>()) {
+      return result;
+    }
+    results.push_back(std::move(result));
+  }
+
+  return Array::from(results.data(), results.size());
+}
+
+Value Builtins::filter(Arguments arguments) {
+  auto error = checkCallback("filter", arguments, arguments[1]);
+  if (!error.isNull()) {
+    return error;
+  }
+
+  if (arguments[0].is<Iterator>()) {
+    return makeRef<FilterIterator>(arguments[0].share<Iterator>(), arguments[1]);
+  }
+  if (!arguments[0].is<Array>()) {
+    return newError("argument to filter must be ARRAY or ITERATOR, got " + arguments[0].type());
+  }
+
+  Array *array = arguments[0].as<Array>();
+  std::vector<Value> results{};
+  for (std::size_t i = 0; i < array->size(); i++) {
+    Value element = array->valueAt(i);
+    Value keep{};
+    if (!ticked(arguments.caller, keep)) {
+      return keep;
+    }
+    keep = arguments.caller->call(arguments[1], &element, 1);
+    if (keep.is<Error>()) {
+      return keep;
+    }
+    if (keep.isTruthy()) {
+      results.push_back(std::move(element));
+    }
+  }
+
+  return Array::from(results.data(), results.size());
+}
+
+Value Builtins::reduce(Arguments arguments) {
+  auto iterator = Iterator::of(arguments[0]);
+  if (iterator == nullptr) {
+    return newError("argument to reduce must be ARRAY or ITERATOR, got " + arguments[0].type());
+  }
+  auto error = checkCallback("reduce", arguments, arguments[2]);
+  if (!error.isNull()) {
+    return error;
   }
 
-  Array *array = dynamic_cast<Array *>(arguments[0].get());
-  int length = array->elements.size();
-  if (length > 0) {
-    auto result = std::make_shared<Array>();
-    for (int i = 1; i < length; ++i) {
-      result->elements.push_back(array->elements[i]);
+  // The accumulator and the element, passed as the two arguments
+  Value pair[2] = {arguments[1], nullptr};
+  while (iterator->next(arguments.caller, pair[1])) {
+    Value result{};
+    if (!ticked(arguments.caller, result)) {
+      return result;
+    }
+    result = arguments.caller->call(arguments[2], pair, 2);
+    if (result.is<Error>()) {
+      return result;
     }
-    return result;
+    pair[0] = std::move(result);
+  }
+
+  // The iterator failed
+  if (!pair[1].isNull()) {
+    return pair[1];
+  }
+  return pair[0];
+}
+
+Value Builtins::range(Arguments arguments) {
+  for (auto &&argument : arguments) {
+    if (!argument.isInteger()) {
+      return newError("arguments to range must be INTEGER, got " + argument.type());
+    }
+  }
+
+  // range(end), range(start, end) or range(start, end, step)
+  int64_t start = arguments.size() == 1 ? 0 : arguments[0].getInteger();
+  int64_t end = arguments.size() == 1 ? arguments[0].getInteger() : arguments[1].getInteger();
+  int64_t step = arguments.size() == 3 ? arguments[2].getInteger() : 1;
+  if (step == 0) {
+    return newError("step of range must not be 0");
+  }
+
+  return makeRef<RangeIterator>(start, end, step);
+}
+
+Value Builtins::each(Arguments arguments) {
+  auto iterator = Iterator::of(arguments[0]);
+  if (iterator == nullptr) {
+    return newError("argument to each must be ARRAY or ITERATOR, got " + arguments[0].type());
+  }
+  auto error = checkCallback("each", arguments, arguments[1]);
+  if (!error.isNull()) {
+    return error;
+  }
+
+  Value element{};
+  while (iterator->next(arguments.caller, element)) {
+    Value result{};
+    if (!ticked(arguments.caller, result)) {
+      return result;
+    }
+    result = arguments.caller->call(arguments[1], &element, 1);
+    if (result.is<Error>()) {
+      return result;
+    }
+  }
+
+  // The error of the iterator, or null
+  return element;
+}
+
+Value Builtins::take(Arguments arguments) {
+  auto iterator = Iterator::of(arguments[0]);
+  if (iterator == nullptr) {
+    return newError("argument to take must be ARRAY or ITERATOR, got " + arguments[0].type());
+  }
+  if (!arguments[1].isInteger()) {
+    return newError("count of take must be INTEGER, got " + arguments[1].type());
+  }
+
+  return makeRef<TakeIterator>(std::move(iterator), arguments[1].getInteger());
+}
+
+Value Builtins::zip(Arguments arguments) {
+  auto left = Iterator::of(arguments[0]);
+  auto right = Iterator::of(arguments[1]);
+  if (left == nullptr || right == nullptr) {
+    return newError("arguments to zip must be ARRAY or ITERATOR, got " + arguments[0].type() + " and " +
+                    arguments[1].type());
+  }
+
+  return makeRef<ZipIterator>(std::move(left), std::move(right));
+}
+
+Value Builtins::chars(Arguments arguments) {
+  if (!arguments[0].is<String>()) {
+    return newError("argument to chars must be STRING, got " + arguments[0].type());
+  }
+
+  return makeRef<CharsIterator>(arguments[0].share<String>());
+}
+
+Value Builtins::lines(Arguments arguments) {
+  if (!arguments[0].is<String>()) {
+    return newError("argument to lines must be STRING, got " + arguments[0].type());
+  }
+
+  return makeRef<LinesIterator>(arguments[0].share<String>());
+}
+
+Value Builtins::collect(Arguments arguments) {
+  if (arguments[0].is<Array>()) {
+    return arguments[0];
+  }
+  if (!arguments[0].is<Iterator>()) {
+    return newError("argument to collect must be ARRAY or ITERATOR, got " + arguments[0].type());
+  }
+
+  Iterator *iterator = arguments[0].as<Iterator>();
+  std::vector<Value> elements{};
+  Value element{};
+  while (iterator->next(arguments.caller, element)) {
+    elements.push_back(std::move(element));
+    if (!ticked(arguments.caller, element)) {
+      return element;
+    }
+  }
+  if (!element.isNull()) {
+    return element;
+  }
+
+  return Array::from(elements.data(), elements.size());
+}
+
+Value Builtins::count(Arguments arguments) {
+  if (arguments[0].is<Array>()) {
+    return Value::fromInteger(arguments[0].as<Array>()->size());
+  }
+  if (!arguments[0].is<Iterator>()) {
+    return newError("argument to count must be ARRAY or ITERATOR, got " + arguments[0].type());
+  }
+
+  Iterator *iterator = arguments[0].as<Iterator>();
+  int64_t total{0};
+  Value element{};
+  while (iterator->next(arguments.caller, element)) {
+    if (!ticked(arguments.caller, element)) {
+      return element;
+    }
+    total++;
+  }
+  if (!element.isNull()) {
+    return element;
+  }
+
+  return Value::fromInteger(total);
+}
+
+Value Builtins::sort(Arguments arguments) {
+  if (!arguments[0].is<Array>()) {
+    return newError("argument to sort must be ARRAY, got " + arguments[0].type());
+  }
+  Array *array = arguments[0].as<Array>();
+
+  // The native sort is charged once per element before it starts
+  Value exhausted{};
+  for (std::size_t i = 0; i < array->size(); i++) {
+    if (!ticked(arguments.caller, exhausted)) {
+      return exhausted;
+    }
+  }
+
+  // The integers are sorted in a copy of their buffer
+  if (array->unboxed && arguments.size() == 1) {
+    IntVector integers{};
+    int64_t *values = integers.resize(array->size());
+    std::copy(array->integers.begin(), array->integers.end(), values);
+    Sort::integers(values, array->size());
+    return Array::from(std::move(integers));
+  }
+
+  std::vector<Value> values{};
+  values.reserve(array->size());
+  for (std::size_t i = 0; i < array->size(); i++) {
+    values.push_back(array->valueAt(i));
+  }
+
+  if (arguments.size() == 2) {
+    auto error = checkCallback("sort", arguments, arguments[1]);
+    if (!error.isNull()) {
+      return error;
+    }
+    error = Sort::by(values.data(), values.size(), arguments.caller, arguments[1]);
+    if (!error.isNull()) {
+      return error;
+    }
+    return Array::from(values.data(), values.size());
+  }
+
+  bool numbers = std::all_of(values.begin(), values.end(), [](const Value &v) { return v.isNumber(); });
+  bool strings = std::all_of(values.begin(), values.end(), [](const Value &v) { return v.is<String>(); });
+  if (numbers) {
+    Sort::numbers(values.data(), values.size());
+  } else if (strings) {
+    Sort::strings(values.data(), values.size());
+  } else {
+    return newError("elements of sort must be all numbers or all STRING without a comparator");
+  }
+
+  return Array::from(values.data(), values.size());
+}
+
+Value Builtins::readFile(Arguments arguments) {
+  if (!arguments[0].is<String>()) {
+    return newError("argument to readFile must be STRING, got " + arguments[0].type());
+  }
+
+  std::string path{arguments[0].as<String>()->value()}, reason{};
+  auto file = MappedFile::open(path, reason);
+  if (file == nullptr) {
+    return newError("could not read " + path + ": " + reason);
+  }
+
+  std::string_view text = file->text();
+  return String::view(std::move(file), text);
+}
+
+Value Builtins::readLines(Arguments arguments) {
+  Value file = readFile(arguments);
+  if (file.is<Error>()) {
+    return file;
+  }
+
+  return makeRef<LinesIterator>(file.share<String>());
+}
+
+Value Builtins::writeFile(Arguments arguments) {
+  if (!arguments[0].is<String>() || !arguments[1].is<String>()) {
+    return newError("arguments to writeFile must be STRING, got " + arguments[0].type() + " and " +
+                    arguments[1].type());
+  }
+
+  std::string path{arguments[0].as<String>()->value()};
+  std::string_view text = arguments[1].as<String>()->value();
+  std::ofstream file{path, std::ios::binary};
+  if (!file.write(text.data(), text.size()) || !file.flush()) {
+    return newError("could not write " + path);
   }
 
   return nullptr;
 }
 
-std::shared_ptr<Object> Builtins::push(std::vector<std::shared_ptr<Object>> &arguments) {
-  if (arguments.size() != 2) {
-    return newError("wrong number of arguments. got=" + std::to_string(arguments.size()) + ", want=1");
+Value Builtins::puts(Arguments arguments) {
+  // The text of the containers is streamed, it is never built whole
+  Writer writer{Output::current()};
+  for (auto &&argument : arguments) {
+    argument.inspect(writer);
+    writer.write('\n');
   }
 
-  if (arguments[0]->type() != ARRAY_OBJ) {
-    return newError("argument to first must be ARRAY");
+  return nullptr;
+}
+
+Value Builtins::print(Arguments arguments) {
+  Writer writer{Output::current()};
+  for (auto &&argument : arguments) {
+    argument.inspect(writer);
   }
 
-  Array *array = dynamic_cast<Array *>(arguments[0].get());
-  int length = array->elements.size();
+  return nullptr;
+}
 
-  auto result = std::make_shared<Array>();
-  for (int i = 0; i < length; ++i) {
-    result->elements.push_back(array->elements[i]);
+Value Builtins::jsonParse(Arguments arguments) {
+  if (!arguments[0].is<String>()) {
+    return newError("argument to jsonParse must be STRING, got " + arguments[0].type());
   }
-  result->elements.push_back(arguments[1]);
-  return result;
+
+  return Json::parse(arguments[0].as<String>()->value());
+}
+
+Value Builtins::jsonStringify(Arguments arguments) { return Json::stringify(arguments[0]); }
+
+Value Builtins::serialize(Arguments arguments) { return Serializer::serialize(arguments[0]); }
+
+Value Builtins::deserialize(Arguments arguments) {
+  if (!arguments[0].is<String>()) {
+    return newError("argument to deserialize must be STRING, got " + arguments[0].type());
+  }
+
+  return Serializer::deserialize(arguments[0].as<String>());
 }
@@ -4,58 +4,299 @@
 #include "object.hpp"
 
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+/**
+ * @brief Builtins is the table of the builtin functions. A builtin is
+ * referenced by its index in the bytecode, and by its name in the
+ * interpreter.
+ *
+ */
 class Builtins {
 private:
-  static std::unordered_map<std::string, std::shared_ptr<Builtin>> builtins;
+  static std::vector<Ref<Builtin>> builtins;
   static std::vector<std::string> builtinNames;
+  // The builtins as the values, the VM pushes them without converting
+  static std::vector<Value> values;
+  static std::unordered_map<std::string, int> indices;
 
 public:
   /**
    * @brief The built function len to calculate the string length
    *
    * @param arguments the arguments
-   * @return std::shared_ptr<Object>;
+   * @return Value
    */
-  static std::shared_ptr<Object> len(std::vector<std::shared_ptr<Object>> &arguments);
+  static Value len(Arguments arguments);
 
   /**
    * @brief The built function to get the first element of the array
    *
    * @param arguments the arguments
-   * @return std::shared_ptr<Object>
+   * @return Value
    */
-  static std::shared_ptr<Object> first(std::vector<std::shared_ptr<Object>> &arguments);
+  static Value first(Arguments arguments);
 
   /**
    * @brief The built function to get the last element of the array
    *
    * @param arguments the arguments
-   * @return std::shared_ptr<Object>
+   * @return Value
    */
-  static std::shared_ptr<Object> last(std::vector<std::shared_ptr<Object>> &arguments);
+  static Value last(Arguments arguments);
 
   /**
    * @brief The built function to drop the first element of the array
    *
    * @param arguments the arguments
-   * @return std::shared_ptr<Object>
+   * @return Value
    */
-  static std::shared_ptr<Object> rest(std::vector<std::shared_ptr<Object>> &arguments);
+  static Value rest(Arguments arguments);
 
   /**
    * @brief Push a new element to the a and get the b.
    *
    * @param arguments the arguments
-   * @return std::shared_ptr<Object>
+   * @return Value
    */
-  static std::shared_ptr<Object> push(std::vector<std::shared_ptr<Object>> &arguments);
+  static Value push(Arguments arguments);
 
-  static inline std::unordered_map<std::string, std::shared_ptr<Builtin>> &getBuiltins() { return builtins; }
-  static inline std::vector<std::string> &getBuiltinNames() { return builtinNames; }
-  static inline std::shared_ptr<Builtin> getBuiltinByIndex(int i) { return builtins[builtinNames[i]]; }
+  /**
+   * @brief The sum of an array of integers
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value sum(Arguments arguments);
+
+  /**
+   * @brief The smallest integer of an array, null for an empty one
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value min(Arguments arguments);
+
+  /**
+   * @brief The largest integer of an array, null for an empty one
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value max(Arguments arguments);
+
+  /**
+   * @brief The dot product of two arrays of integers
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value dot(Arguments arguments);
+
+  /**
+   * @brief Add two arrays of integers elementwise
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value add(Arguments arguments);
+
+  /**
+   * @brief Multiply two arrays of integers elementwise
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value mul(Arguments arguments);
+
+  /**
+   * @brief Apply the function to each element of the array, get the
+   * array of the results. An iterator is mapped lazily.
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value map(Arguments arguments);
+
+  /**
+   * @brief Get the array of the elements for which the function is
+   * truthy. An iterator is filtered lazily.
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value filter(Arguments arguments);
+
+  /**
+   * @brief Fold the array from the initial value with the function of
+   * the accumulator and the element
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value reduce(Arguments arguments);
+
+  /**
+   * @brief Get the iterator of the integers from the start up to but not
+   * including the end, by the step
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value range(Arguments arguments);
+
+  /**
+   * @brief Call the function on each element of the array, get null
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value each(Arguments arguments);
+
+  /**
+   * @brief Get the iterator of the first n elements
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value take(Arguments arguments);
+
+  /**
+   * @brief Get the iterator of the pairs of the elements of two sequences
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value zip(Arguments arguments);
+
+  /**
+   * @brief Get the iterator of the characters of the string
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value chars(Arguments arguments);
+
+  /**
+   * @brief Get the iterator of the lines of the string
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value lines(Arguments arguments);
+
+  /**
+   * @brief Pull all the elements of the iterator into an array
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value collect(Arguments arguments);
+
+  /**
+   * @brief Count the elements of the array or the iterator
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value count(Arguments arguments);
+
+  /**
+   * @brief Get the sorted array. The numbers and the strings are sorted
+   * natively, the other elements need a comparator `cmp(a, b)` which is
+   * true or negative when `a` goes before `b`, and that sort is stable.
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value sort(Arguments arguments);
+
+  /**
+   * @brief Get the text of the file at the path. The file is mapped into
+   * the memory, the string is a read-only view of it.
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value readFile(Arguments arguments);
+
+  /**
+   * @brief Get the iterator of the lines of the file at the path
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value readLines(Arguments arguments);
+
+  /**
+   * @brief Write the string to the file at the path
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value writeFile(Arguments arguments);
+
+  /**
+   * @brief Write each argument on its own line to the buffered output
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value puts(Arguments arguments);
+
+  /**
+   * @brief Write the arguments to the buffered output, without the line
+   * breaks
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value print(Arguments arguments);
+
+  /**
+   * @brief Parse the JSON text, the objects are hashes
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value jsonParse(Arguments arguments);
+
+  /**
+   * @brief Get the JSON text of the value
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value jsonStringify(Arguments arguments);
+
+  /**
+   * @brief Get the bytes of the value in the binary format
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value serialize(Arguments arguments);
+
+  /**
+   * @brief Read the value back from the bytes of `serialize`
+   *
+   * @param arguments the arguments
+   * @return Value
+   */
+  static Value deserialize(Arguments arguments);
+
+  /**
+   * @brief get the builtin by its name
+   *
+   * @param name the name
+   * @return Ref<Builtin> nullptr if there is none
+   */
+  static Ref<Builtin> lookup(const std::string &name);
+
+  static inline const std::vector<std::string> &getBuiltinNames() { return builtinNames; }
+  static inline const Value &getBuiltinByIndex(int i) { return values[i]; }
 };
 
 #endif  // _OBJECT_BUILTINS_HPP_
@@ -1,11 +1,17 @@
 #include "ast.hpp"
+#include "heap.hpp"
 #include "object.hpp"
 
 #include <memory>
+#include <utility>
 
-Environment::Environment(std::shared_ptr<Environment> o) : outer(o) {}
+Environment::Environment() { Heap::current().track(this, HeapSpace::Environments); }
 
-std::shared_ptr<Object> Environment::get(const std::string &name) {
+Environment::Environment(Ref<Environment> o) : outer(std::move(o)) {
+  Heap::current().track(this, HeapSpace::Environments);
+}
+
+Ref<Object> Environment::get(const std::string &name) {
   if (store.count(name)) {
     auto object = store[name];
     return store[name];
@@ -15,4 +21,16 @@ std::shared_ptr<Object> Environment::get(const std::string &name) {
   return nullptr;
 }
 
-void Environment::set(const std::string &name, std::shared_ptr<Object> val) { store[name] = val; }
+void Environment::set(const std::string &name, Ref<Object> val) { store[name] = val; }
+
+void Environment::trace(Tracer &tracer) {
+  tracer.visit(outer);
+  for (auto &&[name, value] : store) {
+    tracer.visit(value);
+  }
+}
+
+void Environment::clearReferences() {
+  outer.reset();
+  store.clear();
+}
@@ -0,0 +1,162 @@
+#include "hashTable.hpp"
+
+#include "object.hpp"
+
+#include <cstring>
+#include <utility>
+
+static constexpr uint64_t LowBits = 0x0101010101010101ull;
+static constexpr uint64_t HighBits = 0x8080808080808080ull;
+
+/**
+ * @brief mix the bits of an integer key, the low bits pick the group and
+ * the control byte
+ *
+ */
+static inline std::size_t mix(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return static_cast<std::size_t>(x);
+}
+
+static inline int8_t controlOf(std::size_t hash) { return static_cast<int8_t>(hash & 0x7f); }
+
+/**
+ * @brief the bytes of the group equal to the control byte have their high
+ * bit set. A byte right above a match may be a false positive, the keys
+ * are compared anyway, and an empty byte never matches.
+ *
+ */
+static inline uint64_t match(uint64_t group, int8_t control) {
+  uint64_t x = group ^ (LowBits * static_cast<uint8_t>(control));
+  return (x - LowBits) & ~x & HighBits;
+}
+
+// The control bytes are loaded as one word, byte i of the group is the
+// byte i of the word on the little-endian machines.
+static inline uint64_t load(const int8_t *group) {
+  uint64_t word{};
+  std::memcpy(&word, group, sizeof(word));
+  return word;
+}
+
+static inline std::size_t firstByte(uint64_t mask) { return __builtin_ctzll(mask) / 8; }
+
+bool HashTable::hashable(const Object *key) {
+  return key != nullptr && (key->is<Integer>() || key->is<Boolean>() || key->is<String>());
+}
+
+std::size_t HashTable::hashOf(const Object *key) {
+  if (key->is<Integer>()) {
+    return mix(static_cast<uint64_t>(key->as<Integer>()->value));
+  }
+  if (key->is<Boolean>()) {
+    return mix(key->as<Boolean>()->value ? 1 : 0) ^ 0x5bd1e995;
+  }
+  return key->as<String>()->hash();
+}
+
+bool HashTable::equals(const Object *a, const Object *b) {
+  if (a == b) {
+    return true;
+  }
+  if (a->kind != b->kind) {
+    return false;
+  }
+  if (a->is<Integer>()) {
+    return a->as<Integer>()->value == b->as<Integer>()->value;
+  }
+  if (a->is<Boolean>()) {
+    return a->as<Boolean>()->value == b->as<Boolean>()->value;
+  }
+  return a->as<String>()->equals(b->as<String>());
+}
+
+std::size_t HashTable::probe(const Object *key, std::size_t hash) const {
+  std::size_t groups = control.size() / GroupSize;
+  std::size_t group = (hash >> 7) & (groups - 1);
+  int8_t h2 = controlOf(hash);
+
+  // The triangular probing visits every group, and there is always an
+  // empty slot.
+  for (std::size_t step = 1;; step++) {
+    std::size_t base = group * GroupSize;
+    uint64_t word = load(&control[base]);
+
+    for (uint64_t matches = match(word, h2); matches != 0; matches &= matches - 1) {
+      std::size_t slot = base + firstByte(matches);
+      const Pair &pair = pairs[slots[slot]];
+      if (pair.hash == hash && equals(pair.key.get(), key)) {
+        return slot;
+      }
+    }
+
+    uint64_t empties = word & HighBits;
+    if (empties != 0) {
+      return base + firstByte(empties);
+    }
+
+    group = (group + step) & (groups - 1);
+  }
+}
+
+void HashTable::rehash(std::size_t capacity) {
+  control.assign(capacity, Empty);
+  slots.assign(capacity, 0);
+
+  for (std::size_t i = 0; i < pairs.size(); i++) {
+    std::size_t slot = probe(pairs[i].key.get(), pairs[i].hash);
+    control[slot] = controlOf(pairs[i].hash);
+    slots[slot] = static_cast<uint32_t>(i);
+  }
+}
+
+const Ref<Object> *HashTable::find(const Object *key) const {
+  if (pairs.empty()) {
+    return nullptr;
+  }
+
+  std::size_t slot = probe(key, hashOf(key));
+  if (control[slot] == Empty) {
+    return nullptr;
+  }
+  return &pairs[slots[slot]].value;
+}
+
+void HashTable::set(Ref<Object> key, Ref<Object> value) {
+  // Keep the load under 7/8
+  if ((pairs.size() + 1) * 8 > control.size() * 7) {
+    rehash(control.empty() ? GroupSize : control.size() * 2);
+  }
+
+  std::size_t hash = hashOf(key.get());
+  std::size_t slot = probe(key.get(), hash);
+  if (control[slot] != Empty) {
+    pairs[slots[slot]].value = std::move(value);
+    return;
+  }
+
+  control[slot] = controlOf(hash);
+  slots[slot] = static_cast<uint32_t>(pairs.size());
+  pairs.push_back(Pair{std::move(key), std::move(value), hash});
+}
+
+void HashTable::reserve(std::size_t count) {
+  std::size_t capacity = GroupSize;
+  while (count * 8 > capacity * 7) {
+    capacity *= 2;
+  }
+  pairs.reserve(count);
+  if (capacity > control.size()) {
+    rehash(capacity);
+  }
+}
+
+void HashTable::clear() {
+  pairs.clear();
+  control.clear();
+  slots.clear();
+}
@@ -0,0 +1,99 @@
+#ifndef _OBJECT_HASH_TABLE_HPP_
+#define _OBJECT_HASH_TABLE_HPP_
+
+#include "ref.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Object;
+
+/**
+ * @brief HashTable is the table behind `Hash`, an open-addressing table
+ * in the style of the SwissTable.
+ *
+ * The pairs are stored densely in the order of insertion, and the table
+ * itself is two arrays: one control byte per slot holding 7 bits of the
+ * hash or `Empty`, and the index of the pair in the slot. A lookup loads
+ * a group of 8 control bytes as one word and compares them all at once,
+ * so it only touches a pair whose control byte matches, which is almost
+ * always the right one. The hash of each key is cached in its pair, the
+ * table is rebuilt from them when it grows.
+ *
+ * The keys are integers, booleans and strings, see `hashable`.
+ *
+ */
+class HashTable {
+public:
+  struct Pair {
+    Ref<Object> key;
+    Ref<Object> value;
+    std::size_t hash;
+  };
+
+  static constexpr std::size_t GroupSize = 8;
+  static constexpr int8_t Empty = -128;
+
+private:
+  std::vector<Pair> pairs{};
+  std::vector<int8_t> control{};
+  std::vector<uint32_t> slots{};
+
+  /**
+   * @brief the slot of the key, or the empty slot where it goes
+   *
+   */
+  std::size_t probe(const Object *key, std::size_t hash) const;
+
+  /**
+   * @brief rebuild the table with the capacity
+   *
+   */
+  void rehash(std::size_t capacity);
+
+public:
+  /**
+   * @brief whether the object could be a key
+   *
+   */
+  static bool hashable(const Object *key);
+
+  /**
+   * @brief the hash of a key, call `hashable` first
+   *
+   */
+  static std::size_t hashOf(const Object *key);
+
+  /**
+   * @brief whether the keys are equal, call `hashable` first
+   *
+   */
+  static bool equals(const Object *a, const Object *b);
+
+  inline std::size_t size() const { return pairs.size(); }
+  inline bool empty() const { return pairs.empty(); }
+
+  /**
+   * @brief the pairs in the order of insertion
+   *
+   */
+  inline const std::vector<Pair> &entries() const { return pairs; }
+
+  /**
+   * @brief get the value of the key, nullptr if there is none
+   *
+   */
+  const Ref<Object> *find(const Object *key) const;
+
+  /**
+   * @brief set the value of the key, the key must be hashable
+   *
+   */
+  void set(Ref<Object> key, Ref<Object> value);
+
+  void reserve(std::size_t count);
+  void clear();
+};
+
+#endif  // _OBJECT_HASH_TABLE_HPP_
@@ -0,0 +1,234 @@
+#include "heap.hpp"
+
+#include "ref.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Subtract the references between the collected objects, what is
+ * left in `gcRefs` are the references from outside.
+ *
+ */
+class Heap::InternalReferences : public Tracer {
+public:
+  bool minor;
+
+  InternalReferences(bool m) : minor{m} {}
+
+  void visit(RefCounted *object) override;
+};
+
+/**
+ * @brief Mark the collected objects reachable from the visited ones.
+ *
+ */
+class Heap::Marker : public Tracer {
+public:
+  bool minor;
+  std::vector<RefCounted *> &worklist;
+
+  Marker(bool m, std::vector<RefCounted *> &w) : minor{m}, worklist{w} {}
+
+  void visit(RefCounted *object) override;
+};
+
+/**
+ * @brief Whether the object takes part in the collection, a minor
+ * collection leaves the old objects alone.
+ *
+ */
+static inline bool collected(RefCounted *object, bool minor) {
+  return object != nullptr && object->isTracked() && !(minor && object->isOld());
+}
+
+RefCounted::~RefCounted() {
+  if (isTracked()) {
+    Heap::current().untrack(this);
+  }
+}
+
+void RefCounted::setImmortal() {
+  // A frozen object could be shared by other threads, it is never
+  // freed, so the collector should not look at it anymore.
+  if (isTracked()) {
+    Heap::current().untrack(this);
+  }
+  immortal = true;
+}
+
+Heap::~Heap() {
+  // The objects which outlive the thread, such as the static ones,
+  // should not untrack themselves from a dead heap.
+  for (auto *generation : {&young, &old}) {
+    for (auto &&space : *generation) {
+      for (auto &&object : space) {
+        object->space = RefCounted::Untracked;
+      }
+    }
+  }
+}
+
+Heap &Heap::current() {
+  static thread_local Heap heap{};
+  return heap;
+}
+
+void Heap::track(RefCounted *object, HeapSpace space) {
+  auto &objects = young[static_cast<std::size_t>(space)];
+
+  object->space = static_cast<uint8_t>(space);
+  object->old = false;
+  object->heapIndex = static_cast<uint32_t>(objects.size());
+  objects.push_back(object);
+
+  if (++youngSize >= youngLimit && enabled) {
+    pending = true;
+  }
+}
+
+void Heap::untrack(RefCounted *object) {
+  auto &objects = object->old ? old[object->space] : young[object->space];
+
+  // Swap the last one into the slot
+  RefCounted *last = objects.back();
+  last->heapIndex = object->heapIndex;
+  objects[object->heapIndex] = last;
+  objects.pop_back();
+
+  (object->old ? oldSize : youngSize)--;
+  object->space = RefCounted::Untracked;
+}
+
+void Heap::promote() {
+  for (std::size_t i = 0; i < HeapSpaces; i++) {
+    for (auto &&object : young[i]) {
+      object->old = true;
+      object->heapIndex = static_cast<uint32_t>(old[i].size());
+      old[i].push_back(object);
+    }
+    young[i].clear();
+  }
+
+  stats.promoted += youngSize;
+  oldSize += youngSize;
+  youngSize = 0;
+}
+
+std::size_t Heap::collect() {
+  auto freed = collect(false);
+  threshold = std::max(minThreshold, static_cast<std::size_t>(oldSize * growthFactor));
+  pending = false;
+  return freed;
+}
+
+std::size_t Heap::collectYoung() {
+  auto freed = collect(true);
+  // The promoted objects may push the old generation over the threshold
+  pending = enabled && oldSize >= threshold;
+  return freed;
+}
+
+std::size_t Heap::collect(bool minor) {
+  if (collecting) {
+    return 0;
+  }
+  collecting = true;
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<Spaces *> generations{&young};
+  if (!minor) {
+    generations.push_back(&old);
+  }
+
+  for (auto *generation : generations) {
+    for (auto &&space : *generation) {
+      for (auto &&object : space) {
+        object->gcRefs = object->refCount;
+      }
+    }
+  }
+
+  InternalReferences internal{minor};
+  for (auto *generation : generations) {
+    for (auto &&space : *generation) {
+      for (auto &&object : space) {
+        object->trace(internal);
+      }
+    }
+  }
+
+  // Mark from the objects referenced from outside
+  std::vector<RefCounted *> worklist{};
+  Marker marker{minor, worklist};
+  for (auto *generation : generations) {
+    for (auto &&space : *generation) {
+      for (auto &&object : space) {
+        if (object->gcRefs > 0 && !object->marked) {
+          object->marked = true;
+          worklist.push_back(object);
+        }
+      }
+    }
+  }
+  while (!worklist.empty()) {
+    RefCounted *object = worklist.back();
+    worklist.pop_back();
+    object->trace(marker);
+  }
+
+  // Sweep, the unmarked objects are only referenced by each other.
+  std::vector<RefCounted *> garbage{};
+  for (auto *generation : generations) {
+    for (auto &&space : *generation) {
+      for (auto &&object : space) {
+        if (object->marked) {
+          object->marked = false;
+        } else {
+          garbage.push_back(object);
+        }
+      }
+    }
+  }
+
+  // Hold the garbage while the cycles are broken, so nothing is freed
+  // in the middle, then drop the last references.
+  for (auto &&object : garbage) {
+    object->refCount++;
+  }
+  for (auto &&object : garbage) {
+    object->clearReferences();
+  }
+  for (auto &&object : garbage) {
+    object->release();
+  }
+
+  promote();
+
+  auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  stats.collections++;
+  stats.minorCollections += minor ? 1 : 0;
+  stats.freed += garbage.size();
+  stats.live = size();
+  stats.lastPause = pause;
+  stats.maxPause = std::max(stats.maxPause, pause);
+  stats.totalPause += pause;
+
+  collecting = false;
+  return garbage.size();
+}
+
+void Heap::InternalReferences::visit(RefCounted *object) {
+  if (collected(object, minor)) {
+    object->gcRefs--;
+  }
+}
+
+void Heap::Marker::visit(RefCounted *object) {
+  if (collected(object, minor) && !object->marked) {
+    object->marked = true;
+    worklist.push_back(object);
+  }
+}
@@ -0,0 +1,190 @@
+#ifndef _OBJECT_HEAP_HPP_
+#define _OBJECT_HEAP_HPP_
+
+#include "ref.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The segregated spaces of the heap, one per kind of the tracked
+ * objects. Only the objects which could reference others are tracked,
+ * the leaves such as integers and strings can never be part of a cycle.
+ *
+ */
+enum class HeapSpace : uint8_t {
+  Arrays,
+  Closures,
+  Functions,
+  Environments,
+  Vectors,
+  Hashes,
+  Iterators,
+};
+
+static constexpr std::size_t HeapSpaces = 7;
+
+/**
+ * @brief The statistics of the collector. The pause is the time spent
+ * in one collection, minor or full.
+ *
+ */
+struct HeapStats {
+  uint64_t collections{};
+  uint64_t minorCollections{};
+  uint64_t freed{};
+  uint64_t promoted{};
+  std::size_t live{};
+  std::chrono::nanoseconds lastPause{};
+  std::chrono::nanoseconds maxPause{};
+  std::chrono::nanoseconds totalPause{};
+};
+
+/**
+ * @brief Heap is the tracing mark-and-sweep collector of the runtime
+ * objects. The reference count frees the acyclic garbage at once, the
+ * collector only exists to reclaim the cycles such as a function and the
+ * environment it is defined in.
+ *
+ * The roots are found precisely from the reference counts: a count
+ * which is not explained by the references between the tracked objects
+ * comes from outside the heap, namely the VM stack, the frames, the
+ * globals, the constants, the environments held by the evaluator and
+ * the native locals. So a collection is safe at any point where the
+ * counts are consistent, it never has to scan the native stack.
+ *
+ * The heap is generational. The tracked objects are young until they
+ * survive a collection, most of them die young, so a minor collection
+ * only looks at the young ones and promotes the survivors. A reference
+ * from an old object to a young one is counted but not subtracted, so
+ * the young object is a root of the minor collection without any write
+ * barrier. The old generation is only collected by a full collection.
+ *
+ * Each thread has its own heap, an object belongs to the heap of the
+ * thread which allocates it until it is frozen.
+ *
+ */
+class Heap {
+private:
+  class InternalReferences;
+  class Marker;
+
+  using Spaces = std::array<std::vector<RefCounted *>, HeapSpaces>;
+
+  Spaces young{};
+  Spaces old{};
+  std::size_t youngSize{};
+  std::size_t oldSize{};
+  std::size_t threshold{DefaultThreshold};
+
+  // Set when the heap grows over the threshold, the interpreters
+  // collect at their next safe point.
+  bool pending{false};
+  bool collecting{false};
+
+  /**
+   * @brief collect the young generation, or both of them
+   *
+   */
+  std::size_t collect(bool minor);
+
+  /**
+   * @brief move the survivors to the old generation
+   *
+   */
+  void promote();
+
+public:
+  static constexpr std::size_t DefaultYoungLimit = 1024;
+  static constexpr std::size_t DefaultThreshold = 4096;
+  static constexpr double DefaultGrowthFactor = 2.0;
+
+  // A minor collection is triggered when the young generation grows to
+  // `youngLimit` objects.
+  std::size_t youngLimit{DefaultYoungLimit};
+
+  // A full collection is triggered when the old generation grows to
+  // `max(minThreshold, live * growthFactor)` objects.
+  std::size_t minThreshold{DefaultThreshold};
+  double growthFactor{DefaultGrowthFactor};
+
+  // Whether the collection is triggered automatically
+  bool enabled{true};
+
+  HeapStats stats{};
+
+  Heap() = default;
+  Heap(const Heap &) = delete;
+  Heap &operator=(const Heap &) = delete;
+  ~Heap();
+
+  /**
+   * @brief get the heap of the current thread
+   *
+   */
+  static Heap &current();
+
+  /**
+   * @brief start to track the object, called by its constructor
+   *
+   */
+  void track(RefCounted *object, HeapSpace space);
+
+  /**
+   * @brief stop tracking the object, called when it is freed or frozen
+   *
+   */
+  void untrack(RefCounted *object);
+
+  /**
+   * @brief collect if the heap has grown over the limits. It is called
+   * by the interpreters at the points where every object they use is
+   * referenced.
+   *
+   */
+  inline void poll() {
+    if (pending) {
+      oldSize >= threshold ? collect() : collectYoung();
+    }
+  }
+
+  /**
+   * @brief reclaim the unreachable cycles of both generations now
+   *
+   * @return std::size_t the number of the tracked objects freed
+   */
+  std::size_t collect();
+
+  /**
+   * @brief reclaim the unreachable cycles among the young objects now
+   *
+   * @return std::size_t the number of the tracked objects freed
+   */
+  std::size_t collectYoung();
+
+  /**
+   * @brief the number of the tracked objects
+   *
+   */
+  inline std::size_t size() const { return youngSize + oldSize; }
+
+  /**
+   * @brief the number of the young objects
+   *
+   */
+  inline std::size_t sizeYoung() const { return youngSize; }
+
+  /**
+   * @brief the number of the tracked objects in the space
+   *
+   */
+  inline std::size_t size(HeapSpace space) const {
+    auto index = static_cast<std::size_t>(space);
+    return young[index].size() + old[index].size();
+  }
+};
+
+#endif  // _OBJECT_HEAP_HPP_
@@ -0,0 +1,52 @@
+#include "intVector.hpp"
+
+#include <utility>
+
+void IntVector::push_back(int64_t value) {
+  if (buffer == nullptr) {
+    buffer = makeRef<IntBuffer>();
+  } else if (start + count != buffer->values.size() || buffer->isImmortal()) {
+    // Another view has appended to the buffer, or it is shared by the
+    // threads, copy the integers of this view.
+    auto copy = makeRef<IntBuffer>();
+    copy->values.reserve(count + 1);
+    copy->values.assign(begin(), end());
+    buffer = std::move(copy);
+    start = 0;
+  }
+
+  buffer->values.push_back(value);
+  count++;
+}
+
+void IntVector::reserve(std::size_t capacity) {
+  if (buffer == nullptr) {
+    buffer = makeRef<IntBuffer>();
+  }
+  if (start + count == buffer->values.size() && !buffer->isImmortal()) {
+    buffer->values.reserve(start + capacity);
+  }
+}
+
+int64_t *IntVector::resize(std::size_t count_) {
+  buffer = makeRef<IntBuffer>();
+  buffer->values.resize(count_);
+  start = 0;
+  count = count_;
+  return buffer->values.data();
+}
+
+IntVector IntVector::rest() const {
+  IntVector result{*this};
+  if (result.count > 0) {
+    result.start++;
+    result.count--;
+  }
+  return result;
+}
+
+void IntVector::freeze() {
+  if (buffer != nullptr) {
+    buffer->freeze();
+  }
+}
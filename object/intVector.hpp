@@ -0,0 +1,82 @@
+#ifndef _OBJECT_INT_VECTOR_HPP_
+#define _OBJECT_INT_VECTOR_HPP_
+
+#include "ref.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The contiguous integers shared by the `IntVector` views. It
+ * references no object, so the heap never tracks it.
+ *
+ */
+class IntBuffer : public RefCounted {
+public:
+  std::vector<int64_t> values;
+
+  /**
+   * @brief make the buffer immortal, it is never appended in place again
+   *
+   */
+  inline void freeze() { setImmortal(); }
+};
+
+/**
+ * @brief IntVector is the unboxed storage of an `Array` of integers, a
+ * view of `count` integers from `start` in a shared buffer. Like
+ * `PersistentVector`, copying it is O(1): `push_back` appends to the
+ * buffer in place when the view ends at the end of the buffer, and
+ * copies the view otherwise, so the other views never change.
+ *
+ */
+class IntVector {
+private:
+  Ref<IntBuffer> buffer{};
+  std::size_t start{0};
+  std::size_t count{0};
+
+public:
+  inline std::size_t size() const { return count; }
+  inline bool empty() const { return count == 0; }
+
+  /**
+   * @brief the integers of the view, they are contiguous
+   *
+   */
+  inline const int64_t *data() const { return buffer == nullptr ? nullptr : buffer->values.data() + start; }
+  inline const int64_t *begin() const { return data(); }
+  inline const int64_t *end() const { return data() + count; }
+
+  inline int64_t operator[](std::size_t i) const { return buffer->values[start + i]; }
+
+  /**
+   * @brief append the integer, the copies of this vector are unchanged
+   *
+   */
+  void push_back(int64_t value);
+
+  /**
+   * @brief reserve the room of the buffer which is not shared
+   *
+   */
+  void reserve(std::size_t capacity);
+
+  /**
+   * @brief replace the view with `count` zeros in a new buffer
+   *
+   * @return int64_t* the integers to fill
+   */
+  int64_t *resize(std::size_t count);
+
+  /**
+   * @brief get the view without the first integer
+   *
+   */
+  IntVector rest() const;
+
+  void freeze();
+};
+
+#endif  // _OBJECT_INT_VECTOR_HPP_
@@ -0,0 +1,43 @@
+#include "interner.hpp"
+
+#include "object.hpp"
+
+#include <utility>
+
+Interner::~Interner() {
+  // The strings which outlive the thread, such as the static ones, are
+  // no longer interned.
+  for (auto &&[text, string] : strings) {
+    string->interner = nullptr;
+  }
+}
+
+Interner &Interner::current() {
+  static thread_local Interner interner{};
+  return interner;
+}
+
+Ref<String> Interner::intern(std::string_view text) {
+  auto it = strings.find(text);
+  if (it != strings.end()) {
+    return Ref<String>{it->second};
+  }
+  return intern(std::string{text});
+}
+
+Ref<String> Interner::intern(std::string &&text) {
+  auto it = strings.find(text);
+  if (it != strings.end()) {
+    return Ref<String>{it->second};
+  }
+
+  auto string = makeRef<String>(std::move(text));
+  string->interner = this;
+  strings.emplace(string->flat, string.get());
+  return string;
+}
+
+void Interner::remove(String *string) {
+  strings.erase(string->flat);
+  string->interner = nullptr;
+}
@@ -0,0 +1,65 @@
+#ifndef _OBJECT_INTERNER_HPP_
+#define _OBJECT_INTERNER_HPP_
+
+#include "ref.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class String;
+
+/**
+ * @brief Interner keeps one `String` per distinct text for the literals
+ * and the short computed strings, so the equal strings are usually the
+ * same object and are compared by the pointer.
+ *
+ * The table does not own the strings, a string removes itself when it
+ * is freed. The key is a view into the text of the string, an interned
+ * string is never a rope so its text never changes.
+ *
+ * Each thread has its own interner, a string leaves it when it is
+ * frozen since it could be freed by any thread after that.
+ *
+ */
+class Interner {
+private:
+  std::unordered_map<std::string_view, String *> strings{};
+
+public:
+  // The computed strings longer than it are rarely equal to another
+  static constexpr std::size_t MaxLength = 32;
+
+  Interner() = default;
+  Interner(const Interner &) = delete;
+  Interner &operator=(const Interner &) = delete;
+  ~Interner();
+
+  /**
+   * @brief get the interner of the current thread
+   *
+   */
+  static Interner &current();
+
+  /**
+   * @brief get the string with the text, it is created if there is none
+   *
+   */
+  Ref<String> intern(std::string_view text);
+  Ref<String> intern(std::string &&text);
+
+  /**
+   * @brief forget the string, called when it is freed or frozen
+   *
+   */
+  void remove(String *string);
+
+  /**
+   * @brief the number of the interned strings
+   *
+   */
+  inline std::size_t size() const { return strings.size(); }
+};
+
+#endif  // _OBJECT_INTERNER_HPP_
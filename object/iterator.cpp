@@ -0,0 +1,189 @@
+#include "iterator.hpp"
+
+#include "interner.hpp"
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * @brief call the function of an adapter on the arguments
+ *
+ * @return bool false if it fails, `out` is the `Error` then
+ */
+static bool callBack(Caller *caller, const Value &fn, const Value *values, std::size_t count, Value &out) {
+  if (caller == nullptr) {
+    out = makeRef<Error>("the iterator could not call back here");
+    return false;
+  }
+
+  out = caller->call(fn, values, count);
+  return !out.is<Error>();
+}
+
+Ref<Iterator> Iterator::of(const Value &value) {
+  if (value.is<Iterator>()) {
+    return value.share<Iterator>();
+  }
+  if (value.is<Array>()) {
+    return makeRef<ArrayIterator>(value.share<Array>());
+  }
+  return nullptr;
+}
+
+std::string Iterator::inspect() { return "iterator"; }
+
+bool RangeIterator::next(Caller *, Value &out) {
+  if ((step > 0 && current >= end) || (step < 0 && current <= end)) {
+    out = nullptr;
+    return false;
+  }
+
+  out = Value::fromInteger(current);
+  current += step;
+  return true;
+}
+
+bool ArrayIterator::next(Caller *, Value &out) {
+  if (array == nullptr || index >= array->size()) {
+    out = nullptr;
+    return false;
+  }
+
+  out = array->valueAt(index++);
+  return true;
+}
+
+void ArrayIterator::trace(Tracer &tracer) { tracer.visit(array); }
+
+void ArrayIterator::clearReferences() { array.reset(); }
+
+CharsIterator::CharsIterator(Ref<String> s) : string{std::move(s)} {
+  // Flatten the rope once, not per character
+  string->value();
+}
+
+bool CharsIterator::next(Caller *, Value &out) {
+  std::string_view text = string->value();
+  if (index >= text.size()) {
+    out = nullptr;
+    return false;
+  }
+
+  // The characters are interned, pulling them does not allocate
+  out = Interner::current().intern(text.substr(index++, 1));
+  return true;
+}
+
+LinesIterator::LinesIterator(Ref<String> s) : string{std::move(s)} { string->value(); }
+
+bool LinesIterator::next(Caller *, Value &out) {
+  std::string_view text = string->value();
+  if (offset >= text.size()) {
+    out = nullptr;
+    return false;
+  }
+
+  // The last line may not end with a line break
+  std::size_t end = text.find('\n', offset);
+  end = end == std::string_view::npos ? text.size() : end;
+  std::string_view line = text.substr(offset, end - offset);
+  offset = end + 1;
+
+  if (!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+  if (line.size() <= Interner::MaxLength) {
+    out = Interner::current().intern(line);
+  } else {
+    out = makeRef<String>(std::string{line});
+  }
+  return true;
+}
+
+bool MapIterator::next(Caller *caller, Value &out) {
+  Value element{};
+  if (!source->next(caller, element)) {
+    out = std::move(element);
+    return false;
+  }
+
+  return callBack(caller, fn, &element, 1, out);
+}
+
+void MapIterator::trace(Tracer &tracer) {
+  tracer.visit(source);
+  tracer.visit(fn.getObject());
+}
+
+void MapIterator::clearReferences() {
+  source.reset();
+  fn = nullptr;
+}
+
+bool FilterIterator::next(Caller *caller, Value &out) {
+  Value element{};
+  while (source->next(caller, element)) {
+    Value keep{};
+    if (!callBack(caller, fn, &element, 1, keep)) {
+      out = std::move(keep);
+      return false;
+    }
+    if (keep.isTruthy()) {
+      out = std::move(element);
+      return true;
+    }
+  }
+
+  out = std::move(element);
+  return false;
+}
+
+void FilterIterator::trace(Tracer &tracer) {
+  tracer.visit(source);
+  tracer.visit(fn.getObject());
+}
+
+void FilterIterator::clearReferences() {
+  source.reset();
+  fn = nullptr;
+}
+
+bool TakeIterator::next(Caller *caller, Value &out) {
+  if (remaining <= 0) {
+    out = nullptr;
+    return false;
+  }
+
+  remaining--;
+  return source->next(caller, out);
+}
+
+void TakeIterator::trace(Tracer &tracer) { tracer.visit(source); }
+
+void TakeIterator::clearReferences() { source.reset(); }
+
+bool ZipIterator::next(Caller *caller, Value &out) {
+  Value pair[2]{};
+  if (!left->next(caller, pair[0])) {
+    out = std::move(pair[0]);
+    return false;
+  }
+  if (!right->next(caller, pair[1])) {
+    out = std::move(pair[1]);
+    return false;
+  }
+
+  out = Array::from(pair, 2);
+  return true;
+}
+
+void ZipIterator::trace(Tracer &tracer) {
+  tracer.visit(left);
+  tracer.visit(right);
+}
+
+void ZipIterator::clearReferences() {
+  left.reset();
+  right.reset();
+}
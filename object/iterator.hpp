@@ -0,0 +1,179 @@
+#ifndef _OBJECT_ITERATOR_HPP_
+#define _OBJECT_ITERATOR_HPP_
+
+#include "object.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Iterator is a lazy sequence, the elements are produced one at a
+ * time when they are pulled. The producers such as `range` and `lines`
+ * generate them, the adapters such as `map` and `take` pull them from
+ * another iterator, and the terminal builtins such as `collect`, `sum`
+ * and `count` drive the pipeline, so it runs in constant memory.
+ *
+ * An iterator is consumed by pulling, it could be iterated only once.
+ *
+ */
+class Iterator : public Object {
+public:
+  static constexpr ObjectKind Kind = ObjectKind::Iterator;
+
+  Iterator() : Object{Kind} {}
+
+  /**
+   * @brief pull the next element
+   *
+   * @param caller calls the functions of the adapters such as `map`
+   * @param out the element, or the `Error` when it fails
+   * @return bool false when it is exhausted or it fails, an exhausted
+   * iterator leaves `out` null
+   */
+  virtual bool next(Caller *caller, Value &out) = 0;
+
+  /**
+   * @brief get the iterator over an array, or the iterator itself
+   *
+   * @return Ref<Iterator> nullptr if the value could not be iterated
+   */
+  static Ref<Iterator> of(const Value &value);
+
+  std::string inspect() override;
+};
+
+/**
+ * @brief the integers from `current` up to but not including `end`
+ *
+ */
+class RangeIterator : public Iterator {
+private:
+  int64_t current;
+  int64_t end;
+  int64_t step;
+
+public:
+  RangeIterator(int64_t start, int64_t end_, int64_t step_) : current{start}, end{end_}, step{step_} {}
+
+  bool next(Caller *caller, Value &out) override;
+};
+
+/**
+ * @brief the elements of an array
+ *
+ */
+class ArrayIterator : public Iterator {
+private:
+  Ref<Array> array;
+  std::size_t index{0};
+
+public:
+  ArrayIterator(Ref<Array> a) : array{std::move(a)} {}
+
+  bool next(Caller *caller, Value &out) override;
+  void trace(Tracer &tracer) override;
+  void clearReferences() override;
+};
+
+/**
+ * @brief the characters of a string, as the strings of length one
+ *
+ */
+class CharsIterator : public Iterator {
+private:
+  Ref<String> string;
+  std::size_t index{0};
+
+public:
+  CharsIterator(Ref<String> s);
+
+  bool next(Caller *caller, Value &out) override;
+};
+
+/**
+ * @brief the lines of a string without the line breaks. Over a mapped
+ * file, the pages are read from the disk as the lines are pulled.
+ *
+ */
+class LinesIterator : public Iterator {
+private:
+  Ref<String> string;
+  std::size_t offset{0};
+
+public:
+  LinesIterator(Ref<String> s);
+
+  bool next(Caller *caller, Value &out) override;
+};
+
+/**
+ * @brief the results of the function on the elements of the source
+ *
+ */
+class MapIterator : public Iterator {
+private:
+  Ref<Iterator> source;
+  Value fn;
+
+public:
+  MapIterator(Ref<Iterator> s, Value f) : source{std::move(s)}, fn{std::move(f)} {}
+
+  bool next(Caller *caller, Value &out) override;
+  void trace(Tracer &tracer) override;
+  void clearReferences() override;
+};
+
+/**
+ * @brief the elements of the source for which the function is truthy
+ *
+ */
+class FilterIterator : public Iterator {
+private:
+  Ref<Iterator> source;
+  Value fn;
+
+public:
+  FilterIterator(Ref<Iterator> s, Value f) : source{std::move(s)}, fn{std::move(f)} {}
+
+  bool next(Caller *caller, Value &out) override;
+  void trace(Tracer &tracer) override;
+  void clearReferences() override;
+};
+
+/**
+ * @brief the first `remaining` elements of the source
+ *
+ */
+class TakeIterator : public Iterator {
+private:
+  Ref<Iterator> source;
+  int64_t remaining;
+
+public:
+  TakeIterator(Ref<Iterator> s, int64_t n) : source{std::move(s)}, remaining{n} {}
+
+  bool next(Caller *caller, Value &out) override;
+  void trace(Tracer &tracer) override;
+  void clearReferences() override;
+};
+
+/**
+ * @brief the pairs `[a, b]` of the elements of two sources, it stops at
+ * the shorter one
+ *
+ */
+class ZipIterator : public Iterator {
+private:
+  Ref<Iterator> left;
+  Ref<Iterator> right;
+
+public:
+  ZipIterator(Ref<Iterator> l, Ref<Iterator> r) : left{std::move(l)}, right{std::move(r)} {}
+
+  bool next(Caller *caller, Value &out) override;
+  void trace(Tracer &tracer) override;
+  void clearReferences() override;
+};
+
+#endif  // _OBJECT_ITERATOR_HPP_
@@ -0,0 +1,811 @@
+#include "json.hpp"
+
+#include "interner.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static constexpr std::size_t BlockSize = 64;
+
+/**
+ * @brief the bit masks of a block, bit i is byte i
+ *
+ */
+struct Masks {
+  uint64_t backslash;
+  uint64_t quote;
+  uint64_t op;
+  uint64_t space;
+};
+
+#if defined(__SSE2__)
+static inline uint64_t movemask(__m128i bytes, int chunk) {
+  return static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(bytes))) << (chunk * 16);
+}
+
+static Masks classify(const char *block) {
+  Masks masks{};
+  for (int chunk = 0; chunk < 4; chunk++) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + chunk * 16));
+    // '[' and ']' are '{' and '}' without the bit 0x20
+    __m128i folded = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+    __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+                                           _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+                              _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(':')),
+                                           _mm_cmpeq_epi8(bytes, _mm_set1_epi8(','))));
+    __m128i space = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+                                              _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'))),
+                                 _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')),
+                                              _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r'))));
+
+    masks.backslash |= movemask(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\')), chunk);
+    masks.quote |= movemask(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')), chunk);
+    masks.op |= movemask(op, chunk);
+    masks.space |= movemask(space, chunk);
+  }
+  return masks;
+}
+#else
+static Masks classify(const char *block) {
+  Masks masks{};
+  for (std::size_t i = 0; i < BlockSize; i++) {
+    char c = block[i];
+    uint64_t bit = uint64_t{1} << i;
+    masks.backslash |= c == '\\' ? bit : 0;
+    masks.quote |= c == '"' ? bit : 0;
+    masks.op |= (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') ? bit : 0;
+    masks.space |= (c == ' ' || c == '\t' || c == '\n' || c == '\r') ? bit : 0;
+  }
+  return masks;
+}
+#endif
+
+/**
+ * @brief bit i is the xor of the bits up to i, so the bits from an
+ * opening quote up to but not including its closing quote are set
+ *
+ */
+static inline uint64_t prefixXor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+/**
+ * @brief the characters escaped by a backslash, an odd run of backslashes
+ * escapes the character after it. `carry` is whether the first character
+ * of the next block is escaped.
+ *
+ */
+static inline uint64_t escapedOf(uint64_t backslash, uint64_t &carry) {
+  constexpr uint64_t evenBits = 0x5555555555555555ULL;
+
+  backslash &= ~carry;
+  uint64_t followsEscape = backslash << 1 | carry;
+
+  // The runs starting on an odd bit are turned into the runs starting on
+  // an even bit by the addition
+  uint64_t oddStarts = backslash & ~evenBits & ~followsEscape;
+  uint64_t evenStarts = oddStarts + backslash;
+  carry = evenStarts < oddStarts ? 1 : 0;
+
+  return (evenBits ^ (evenStarts << 1)) & followsEscape;
+}
+
+bool Json::index(std::string_view text, std::vector<uint32_t> &structurals) {
+  structurals.clear();
+  structurals.reserve(text.size() / 8 + 16);
+
+  uint64_t escapedCarry = 0, inStringCarry = 0, scalarCarry = 0;
+  char tail[BlockSize];
+
+  for (std::size_t offset = 0; offset < text.size(); offset += BlockSize) {
+    const char *block = text.data() + offset;
+    if (text.size() - offset < BlockSize) {
+      // The last block is padded with the spaces
+      std::memset(tail, ' ', BlockSize);
+      std::memcpy(tail, block, text.size() - offset);
+      block = tail;
+    }
+
+    Masks masks = classify(block);
+    uint64_t quotes = masks.quote & ~escapedOf(masks.backslash, escapedCarry);
+    uint64_t inString = prefixXor(quotes) ^ inStringCarry;
+    inStringCarry = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+
+    // The first character of each number or literal
+    uint64_t scalar = ~(masks.op | masks.space | masks.quote);
+    uint64_t scalarStarts = scalar & ~(scalar << 1 | scalarCarry);
+    scalarCarry = scalar >> 63;
+
+    uint64_t bits = ((masks.op | scalarStarts) & ~inString) | (quotes & inString);
+    while (bits != 0) {
+      structurals.push_back(static_cast<uint32_t>(offset + __builtin_ctzll(bits)));
+      bits &= bits - 1;
+    }
+  }
+
+  return inStringCarry == 0;
+}
+
+/**
+ * @brief the first position from `i` which ends the fast path of a
+ * string: a quote, a backslash or a control character
+ *
+ */
+static std::size_t scanString(const char *data, std::size_t i, std::size_t size) {
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\'), control = _mm_set1_epi8(0x1f);
+  for (; i + 16 <= size; i += 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    __m128i stop = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, quote), _mm_cmpeq_epi8(bytes, backslash)),
+                                _mm_cmpeq_epi8(_mm_min_epu8(bytes, control), bytes));
+    int mask = _mm_movemask_epi8(stop);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; i < size; i++) {
+    unsigned char c = data[i];
+    if (c == '"' || c == '\\' || c < 0x20) {
+      return i;
+    }
+  }
+  return size;
+}
+
+/**
+ * @brief the offset of the first byte which does not begin a valid UTF-8
+ * sequence: a stray continuation byte, a truncated or overlong sequence,
+ * a surrogate or a code point beyond U+10FFFF
+ *
+ * @return std::size_t the offset, the size if the text is valid
+ */
+static std::size_t invalidUtf8(std::string_view text) {
+  const auto *data = reinterpret_cast<const unsigned char *>(text.data());
+  std::size_t size = text.size(), i = 0;
+  while (i < size) {
+#if defined(__SSE2__)
+    // Most text is ASCII, it is skipped 16 bytes at a time
+    while (i + 16 <= size && _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i))) == 0) {
+      i += 16;
+    }
+    if (i == size) {
+      break;
+    }
+#endif
+    unsigned char c = data[i];
+    if (c < 0x80) {
+      i++;
+      continue;
+    }
+
+    std::size_t length{};
+    uint32_t code{}, min{};
+    if ((c & 0xe0) == 0xc0) {
+      length = 2, code = c & 0x1f, min = 0x80;
+    } else if ((c & 0xf0) == 0xe0) {
+      length = 3, code = c & 0x0f, min = 0x800;
+    } else if ((c & 0xf8) == 0xf0) {
+      length = 4, code = c & 0x07, min = 0x10000;
+    } else {
+      return i;
+    }
+    if (length > size - i) {
+      return i;
+    }
+    for (std::size_t k = 1; k < length; k++) {
+      if ((data[i + k] & 0xc0) != 0x80) {
+        return i;
+      }
+      code = code << 6 | (data[i + k] & 0x3f);
+    }
+    if (code < min || code > 0x10ffff || (code >= 0xd800 && code < 0xe000)) {
+      return i;
+    }
+    i += length;
+  }
+  return size;
+}
+
+static Ref<String> makeString(std::string_view text) {
+  if (text.size() <= Interner::MaxLength) {
+    return Interner::current().intern(text);
+  }
+  return makeRef<String>(std::string{text});
+}
+
+static void appendUtf8(std::string &out, uint32_t code) {
+  if (code < 0x80) {
+    out += static_cast<char>(code);
+  } else if (code < 0x800) {
+    out += static_cast<char>(0xc0 | (code >> 6));
+    out += static_cast<char>(0x80 | (code & 0x3f));
+  } else if (code < 0x10000) {
+    out += static_cast<char>(0xe0 | (code >> 12));
+    out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (code & 0x3f));
+  } else {
+    out += static_cast<char>(0xf0 | (code >> 18));
+    out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+    out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (code & 0x3f));
+  }
+}
+
+/**
+ * @brief JsonParser is the second stage, it walks the structural index
+ *
+ */
+class JsonParser {
+private:
+  std::string_view text;
+  const std::vector<uint32_t> &structurals;
+  std::size_t next{0};
+
+  // The elements of the open arrays and the keys and the values of the
+  // open objects, so a container does not allocate its own vector
+  std::vector<Value> stack{};
+
+  std::string reason{};
+  std::size_t errorOffset{0};
+
+  bool fail(std::size_t offset, const char *why) {
+    errorOffset = offset;
+    reason = why;
+    return false;
+  }
+
+  /**
+   * @brief whether a scalar may end at the offset
+   *
+   */
+  bool endsScalar(std::size_t offset) const {
+    if (offset >= text.size()) {
+      return true;
+    }
+    unsigned char c = text[offset];
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ',' || c == ':' || (c | 0x20) == '{' ||
+           (c | 0x20) == '}' || c == '"';
+  }
+
+  bool pull(std::size_t &offset) {
+    if (next >= structurals.size()) {
+      return fail(text.size(), "unexpected end");
+    }
+    offset = structurals[next++];
+    return true;
+  }
+
+  bool peek(char c) const { return next < structurals.size() && text[structurals[next]] == c; }
+
+  bool array(Value &out, int depth);
+  bool object(Value &out, int depth);
+  bool string(std::size_t offset, Value &out);
+  bool number(std::size_t offset, Value &out);
+  bool literal(std::size_t offset, std::string_view word, Value literal, Value &out);
+  bool hex(std::size_t offset, uint32_t &code);
+
+public:
+  JsonParser(std::string_view t, const std::vector<uint32_t> &s) : text{t}, structurals{s} {
+    // There are at most as many values as the structurals, the pages of
+    // the stack which are never reached are never touched
+    stack.reserve(structurals.size());
+  }
+
+  bool value(Value &out, int depth);
+
+  inline bool done() const { return next == structurals.size(); }
+  inline std::size_t nextOffset() const { return structurals[next]; }
+
+  inline Value error() const {
+    return makeRef<Error>("invalid JSON at offset " + std::to_string(errorOffset) + ": " + reason);
+  }
+};
+
+bool JsonParser::value(Value &out, int depth) {
+  std::size_t offset{};
+  if (!pull(offset)) {
+    return false;
+  }
+
+  switch (text[offset]) {
+    case '[':
+      return depth < Json::MaxDepth ? array(out, depth + 1) : fail(offset, "too deeply nested");
+    case '{':
+      return depth < Json::MaxDepth ? object(out, depth + 1) : fail(offset, "too deeply nested");
+    case '"':
+      return string(offset, out);
+    case 't':
+      return literal(offset, "true", Value::fromBoolean(true), out);
+    case 'f':
+      return literal(offset, "false", Value::fromBoolean(false), out);
+    case 'n':
+      return literal(offset, "null", nullptr, out);
+    default:
+      return number(offset, out);
+  }
+}
+
+bool JsonParser::array(Value &out, int depth) {
+  std::size_t base = stack.size();
+  std::size_t offset{};
+
+  if (peek(']')) {
+    next++;
+    out = makeRef<Array>();
+    return true;
+  }
+
+  while (true) {
+    // A nested container may grow the stack
+    Value element{};
+    if (!value(element, depth)) {
+      return false;
+    }
+    stack.push_back(std::move(element));
+
+    if (!pull(offset)) {
+      return false;
+    }
+    if (text[offset] == ']') {
+      break;
+    }
+    if (text[offset] != ',') {
+      return fail(offset, "expected ',' or ']'");
+    }
+  }
+
+  out = Array::from(stack.data() + base, stack.size() - base);
+  stack.resize(base);
+  return true;
+}
+
+bool JsonParser::object(Value &out, int depth) {
+  auto hash = makeRef<Hash>();
+  std::size_t base = stack.size();
+  std::size_t offset{};
+
+  if (peek('}')) {
+    next++;
+    out = std::move(hash);
+    return true;
+  }
+
+  while (true) {
+    if (!pull(offset)) {
+      return false;
+    }
+    if (text[offset] != '"') {
+      return fail(offset, "expected a string key");
+    }
+    Value key{}, element{};
+    if (!string(offset, key)) {
+      return false;
+    }
+
+    if (!pull(offset)) {
+      return false;
+    }
+    if (text[offset] != ':') {
+      return fail(offset, "expected ':'");
+    }
+    if (!value(element, depth)) {
+      return false;
+    }
+    stack.push_back(std::move(key));
+    stack.push_back(std::move(element));
+
+    if (!pull(offset)) {
+      return false;
+    }
+    if (text[offset] == '}') {
+      break;
+    }
+    if (text[offset] != ',') {
+      return fail(offset, "expected ',' or '}'");
+    }
+  }
+
+  // The table is sized once for all the pairs
+  hash->pairs.reserve((stack.size() - base) / 2);
+  for (std::size_t i = base; i < stack.size(); i += 2) {
+    hash->pairs.set(stack[i].toObject(), stack[i + 1].toObject());
+  }
+  stack.resize(base);
+  out = std::move(hash);
+  return true;
+}
+
+bool JsonParser::hex(std::size_t offset, uint32_t &code) {
+  if (offset + 4 > text.size()) {
+    return fail(offset, "invalid unicode escape");
+  }
+  auto result = std::from_chars(text.data() + offset, text.data() + offset + 4, code, 16);
+  if (result.ptr != text.data() + offset + 4) {
+    return fail(offset, "invalid unicode escape");
+  }
+  return true;
+}
+
+bool JsonParser::string(std::size_t offset, Value &out) {
+  std::size_t start = offset + 1;
+  std::size_t i = scanString(text.data(), start, text.size());
+
+  std::size_t invalid = invalidUtf8(text.substr(start, i - start));
+  if (invalid != i - start) {
+    return fail(start + invalid, "invalid UTF-8 in string");
+  }
+
+  // Most strings have no escape, they are copied at once
+  if (i < text.size() && text[i] == '"') {
+    out = makeString(text.substr(start, i - start));
+    return true;
+  }
+
+  std::string decoded{text.substr(start, i - start)};
+  while (i < text.size()) {
+    unsigned char c = text[i];
+    if (c == '"') {
+      out = makeString(decoded);
+      return true;
+    }
+    if (c < 0x20) {
+      return fail(i, "control character in string");
+    }
+    if (c != '\\') {
+      std::size_t end = scanString(text.data(), i, text.size());
+      invalid = invalidUtf8(text.substr(i, end - i));
+      if (invalid != end - i) {
+        return fail(i + invalid, "invalid UTF-8 in string");
+      }
+      decoded.append(text.data() + i, end - i);
+      i = end;
+      continue;
+    }
+
+    if (i + 1 >= text.size()) {
+      break;
+    }
+    char escape = text[i + 1];
+    i += 2;
+    switch (escape) {
+      case '"':
+      case '\\':
+      case '/':
+        decoded += escape;
+        break;
+      case 'b':
+        decoded += '\b';
+        break;
+      case 'f':
+        decoded += '\f';
+        break;
+      case 'n':
+        decoded += '\n';
+        break;
+      case 'r':
+        decoded += '\r';
+        break;
+      case 't':
+        decoded += '\t';
+        break;
+      case 'u': {
+        uint32_t code{};
+        if (!hex(i, code)) {
+          return false;
+        }
+        i += 4;
+        // A character beyond the basic plane is a pair of surrogates
+        if (code >= 0xd800 && code < 0xdc00) {
+          uint32_t low{};
+          if (text.substr(i, 2) != "\\u" || !hex(i + 2, low) || low < 0xdc00 || low >= 0xe000) {
+            return fail(i, "invalid unicode escape");
+          }
+          i += 6;
+          code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+        } else if (code >= 0xdc00 && code < 0xe000) {
+          return fail(i - 6, "invalid unicode escape");
+        }
+        appendUtf8(decoded, code);
+        break;
+      }
+      default:
+        return fail(i - 2, "invalid escape");
+    }
+  }
+
+  return fail(offset, "unterminated string");
+}
+
+bool JsonParser::number(std::size_t offset, Value &out) {
+  const char *begin = text.data() + offset, *end = text.data() + text.size();
+  const char *p = begin;
+  bool integer = true;
+
+  // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+  auto digits = [&]() {
+    const char *start = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+      p++;
+    }
+    return p > start;
+  };
+  bool negative = p < end && *p == '-';
+  p += negative;
+  if (p < end && *p == '0') {
+    p++;
+  } else if (!digits()) {
+    return fail(offset, "unexpected character");
+  }
+
+  // The integers of up to 18 digits could not overflow, they are summed
+  // while they are checked
+  const char *integerEnd = p;
+  if (integerEnd - begin - negative <= 18 && (p == end || (*p != '.' && (*p | 0x20) != 'e'))) {
+    if (!endsScalar(p - text.data())) {
+      return fail(p - text.data(), "invalid number");
+    }
+    int64_t value = 0;
+    for (const char *d = begin + negative; d < integerEnd; d++) {
+      value = value * 10 + (*d - '0');
+    }
+    out = Value::fromInteger(negative ? -value : value);
+    return true;
+  }
+  if (p < end && *p == '.') {
+    p++;
+    integer = false;
+    if (!digits()) {
+      return fail(offset, "invalid number");
+    }
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    p++;
+    integer = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+      p++;
+    }
+    if (!digits()) {
+      return fail(offset, "invalid number");
+    }
+  }
+  if (!endsScalar(p - text.data())) {
+    return fail(p - text.data(), "invalid number");
+  }
+
+  if (integer) {
+    int64_t value{};
+    auto result = std::from_chars(begin, p, value);
+    if (result.ec == std::errc{}) {
+      out = Value::fromInteger(value);
+      return true;
+    }
+  }
+
+  // The integers which do not fit are floats too
+  double value{};
+  auto result = std::from_chars(begin, p, value);
+  if (result.ec == std::errc::result_out_of_range) {
+    // A tiny number is rounded to zero or a subnormal, a huge one has no
+    // float, it could not be written back either
+    value = std::strtod(std::string{begin, p}.c_str(), nullptr);
+    if (std::isinf(value)) {
+      return fail(offset, "number out of range");
+    }
+  }
+  out = Value::fromFloat(value);
+  return true;
+}
+
+bool JsonParser::literal(std::size_t offset, std::string_view word, Value literal, Value &out) {
+  if (text.substr(offset, word.size()) != word || !endsScalar(offset + word.size())) {
+    return fail(offset, "unexpected character");
+  }
+  out = std::move(literal);
+  return true;
+}
+
+Value Json::parse(std::string_view text) {
+  if (text.size() > std::numeric_limits<uint32_t>::max()) {
+    return makeRef<Error>("invalid JSON: the text is larger than 4 GiB");
+  }
+
+  std::vector<uint32_t> structurals{};
+  if (!index(text, structurals)) {
+    // The opening quote of the string is the last structural character
+    std::size_t offset = structurals.empty() ? 0 : structurals.back();
+    return makeRef<Error>("invalid JSON at offset " + std::to_string(offset) + ": unterminated string");
+  }
+
+  JsonParser parser{text, structurals};
+  Value value{};
+  if (!parser.value(value, 0)) {
+    return parser.error();
+  }
+  if (!parser.done()) {
+    return makeRef<Error>("invalid JSON at offset " + std::to_string(parser.nextOffset()) +
+                          ": unexpected content after the value");
+  }
+  return value;
+}
+
+/**
+ * @brief JsonWriter writes the JSON text of a value into one buffer
+ *
+ */
+class JsonWriter {
+private:
+  std::string out{};
+  std::string reason{};
+
+  bool fail(const std::string &why) {
+    reason = why;
+    return false;
+  }
+
+  template <typename T>
+  void number(T value) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+  }
+
+  bool string(std::string_view text);
+  bool array(Array *array, int depth);
+  bool hash(Hash *hash, int depth);
+
+public:
+  JsonWriter() { out.reserve(256); }
+
+  bool write(const Value &value, int depth);
+
+  inline std::string &text() { return out; }
+  inline Value error() const { return makeRef<Error>("could not stringify: " + reason); }
+};
+
+bool JsonWriter::write(const Value &value, int depth) {
+  if (value.isNull()) {
+    out += "null";
+  } else if (value.isInteger()) {
+    number(value.getInteger());
+  } else if (value.isFloat()) {
+    if (!std::isfinite(value.getFloat())) {
+      return fail("JSON has no " + Float::format(value.getFloat()));
+    }
+    out += Float::format(value.getFloat());
+  } else if (value.isBoolean()) {
+    out += value.getBoolean() ? "true" : "false";
+  } else if (value.is<String>()) {
+    return string(value.as<String>()->value());
+  } else if (value.is<Array>() || value.is<Hash>()) {
+    // A cycle is nested forever
+    if (depth >= Json::MaxDepth) {
+      return fail("too deeply nested or cyclic");
+    }
+    return value.is<Array>() ? array(value.as<Array>(), depth + 1) : hash(value.as<Hash>(), depth + 1);
+  } else {
+    return fail(value.type());
+  }
+  return true;
+}
+
+bool JsonWriter::string(std::string_view text) {
+  static const char *hexDigits = "0123456789abcdef";
+
+  // The bytes which are not UTF-8, such as the ones of a binary file,
+  // have no escape in JSON
+  if (invalidUtf8(text) != text.size()) {
+    return fail("invalid UTF-8 in string");
+  }
+
+  out += '"';
+  std::size_t i = 0;
+  while (i < text.size()) {
+    // Copy the run which needs no escape at once
+    std::size_t end = scanString(text.data(), i, text.size());
+    out.append(text.data() + i, end - i);
+    if (end == text.size()) {
+      break;
+    }
+
+    unsigned char c = text[end];
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        out += "\\u00";
+        out += hexDigits[c >> 4];
+        out += hexDigits[c & 0xf];
+    }
+    i = end + 1;
+  }
+  out += '"';
+  return true;
+}
+
+bool JsonWriter::array(Array *array, int depth) {
+  out += '[';
+  if (array->unboxed) {
+    for (std::size_t i = 0; i < array->size(); i++) {
+      if (i > 0) {
+        out += ',';
+      }
+      number(array->integers[i]);
+    }
+  } else {
+    for (std::size_t i = 0; i < array->size(); i++) {
+      if (i > 0) {
+        out += ',';
+      }
+      if (!write(array->valueAt(i), depth)) {
+        return false;
+      }
+    }
+  }
+  out += ']';
+  return true;
+}
+
+bool JsonWriter::hash(Hash *hash, int depth) {
+  out += '{';
+  bool first = true;
+  for (auto &&pair : hash->pairs.entries()) {
+    if (!first) {
+      out += ',';
+    }
+    first = false;
+
+    // The keys are strings in JSON
+    bool written = pair.key->is<String>() ? string(pair.key->as<String>()->value()) : string(pair.key->inspect());
+    if (!written) {
+      return false;
+    }
+    out += ':';
+    if (!write(Value{pair.value}, depth)) {
+      return false;
+    }
+  }
+  out += '}';
+  return true;
+}
+
+Value Json::stringify(const Value &value) {
+  JsonWriter writer{};
+  if (!writer.write(value, 0)) {
+    return writer.error();
+  }
+
+  std::string &text = writer.text();
+  if (text.size() <= Interner::MaxLength) {
+    return Interner::current().intern(std::move(text));
+  }
+  return makeRef<String>(std::move(text));
+}
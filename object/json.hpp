@@ -0,0 +1,55 @@
+#ifndef _OBJECT_JSON_HPP_
+#define _OBJECT_JSON_HPP_
+
+#include "object.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Json converts between the JSON text and the values: the objects
+ * are hashes, the arrays are arrays, the numbers are integers, or floats
+ * when they have a fraction, an exponent or do not fit in 64 bits, and
+ * `null` is null.
+ *
+ * The text is parsed in the two stages of simdjson. The first stage scans
+ * the text in blocks of 64 bytes, classifies the bytes with the vector
+ * comparisons into the bit masks of the quotes, the backslashes, the
+ * operators and the spaces, and turns them with the bitwise arithmetic
+ * into the structural index: the offsets of the operators, the strings
+ * and the scalars which are not inside a string. The second stage walks
+ * the index, it never looks at the spaces or scans for the end of a
+ * token.
+ *
+ */
+class Json {
+public:
+  // The arrays and the objects nested deeper are rejected
+  static constexpr int MaxDepth = 1024;
+
+  /**
+   * @brief parse the text
+   *
+   * @return Value the value, or the `Error` with the offset
+   */
+  static Value parse(std::string_view text);
+
+  /**
+   * @brief get the JSON text of the value, in one pass into one buffer
+   *
+   * @return Value the string, or the `Error` if the value could not be
+   * written such as a function, NaN or a cycle
+   */
+  static Value stringify(const Value &value);
+
+  /**
+   * @brief the first stage, get the offsets of the structural characters
+   *
+   * @return bool false if a string is not closed
+   */
+  static bool index(std::string_view text, std::vector<uint32_t> &structurals);
+};
+
+#endif  // _OBJECT_JSON_HPP_
@@ -0,0 +1,60 @@
+#include "kernels.hpp"
+
+#include <cstdint>
+
+// The clones need the `ifunc` support of the loader, which is there on
+// the x86-64 Linux.
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+#define KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+#define KERNEL
+#endif
+
+// The unsigned arithmetic wraps around without the undefined behavior
+static inline int64_t wrap(uint64_t x) { return static_cast<int64_t>(x); }
+
+KERNEL int64_t Kernels::sum(const int64_t *values, std::size_t count) {
+  uint64_t total = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    total += static_cast<uint64_t>(values[i]);
+  }
+  return wrap(total);
+}
+
+KERNEL int64_t Kernels::min(const int64_t *values, std::size_t count) {
+  int64_t result = values[0];
+  for (std::size_t i = 1; i < count; i++) {
+    result = values[i] < result ? values[i] : result;
+  }
+  return result;
+}
+
+KERNEL int64_t Kernels::max(const int64_t *values, std::size_t count) {
+  int64_t result = values[0];
+  for (std::size_t i = 1; i < count; i++) {
+    result = values[i] > result ? values[i] : result;
+  }
+  return result;
+}
+
+KERNEL int64_t Kernels::dot(const int64_t *a, const int64_t *b, std::size_t count) {
+  uint64_t total = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    total += static_cast<uint64_t>(a[i]) * static_cast<uint64_t>(b[i]);
+  }
+  return wrap(total);
+}
+
+KERNEL void Kernels::add(const int64_t *__restrict a, const int64_t *__restrict b, int64_t *__restrict out,
+                         std::size_t count) {
+  for (std::size_t i = 0; i < count; i++) {
+    out[i] = wrap(static_cast<uint64_t>(a[i]) + static_cast<uint64_t>(b[i]));
+  }
+}
+
+KERNEL void Kernels::mul(const int64_t *__restrict a, const int64_t *__restrict b, int64_t *__restrict out,
+                         std::size_t count) {
+  for (std::size_t i = 0; i < count; i++) {
+    out[i] = wrap(static_cast<uint64_t>(a[i]) * static_cast<uint64_t>(b[i]));
+  }
+}
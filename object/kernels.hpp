@@ -0,0 +1,37 @@
+#ifndef _OBJECT_KERNELS_HPP_
+#define _OBJECT_KERNELS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Kernels are the loops over the unboxed integers behind the
+ * numeric builtins. They are plain loops over the contiguous memory which
+ * the compiler vectorizes, on x86-64 an AVX2 clone is also built and
+ * picked at load time when the CPU supports it.
+ *
+ * The integers wrap around on overflow like the other integer operations.
+ *
+ */
+class Kernels {
+public:
+  static int64_t sum(const int64_t *values, std::size_t count);
+
+  /**
+   * @brief the smallest and the largest integer, `count` must not be 0
+   *
+   */
+  static int64_t min(const int64_t *values, std::size_t count);
+  static int64_t max(const int64_t *values, std::size_t count);
+
+  static int64_t dot(const int64_t *a, const int64_t *b, std::size_t count);
+
+  /**
+   * @brief the elementwise operations, `out` may not overlap the inputs
+   *
+   */
+  static void add(const int64_t *a, const int64_t *b, int64_t *out, std::size_t count);
+  static void mul(const int64_t *a, const int64_t *b, int64_t *out, std::size_t count);
+};
+
+#endif  // _OBJECT_KERNELS_HPP_
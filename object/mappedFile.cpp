@@ -0,0 +1,52 @@
+#include "mappedFile.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile() {
+  if (length != 0) {
+    munmap(const_cast<char *>(data), length);
+  }
+}
+
+Ref<MappedFile> MappedFile::open(const std::string &path, std::string &error) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = std::strerror(errno);
+    return nullptr;
+  }
+
+  struct stat st {};
+  if (fstat(fd, &st) != 0) {
+    error = std::strerror(errno);
+    close(fd);
+    return nullptr;
+  }
+  if (!S_ISREG(st.st_mode)) {
+    error = "not a regular file";
+    close(fd);
+    return nullptr;
+  }
+
+  // An empty file could not be mapped
+  std::size_t length = static_cast<std::size_t>(st.st_size);
+  if (length == 0) {
+    close(fd);
+    return Ref<MappedFile>{new MappedFile{"", 0}};
+  }
+
+  void *data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    error = std::strerror(errno);
+    return nullptr;
+  }
+
+  // The files are mostly read from the front to the back
+  madvise(data, length, MADV_SEQUENTIAL);
+  return Ref<MappedFile>{new MappedFile{static_cast<const char *>(data), length}};
+}
@@ -0,0 +1,45 @@
+#ifndef _OBJECT_MAPPED_FILE_HPP_
+#define _OBJECT_MAPPED_FILE_HPP_
+
+#include "ref.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief MappedFile is a file mapped read-only into the memory, the pages
+ * are read from the disk when they are touched. It is the text of the
+ * strings `readFile` returns, so reading a file does not copy it. It is
+ * shared by the strings which view a part of it, such as the strings
+ * `deserialize` reads from it.
+ *
+ */
+class MappedFile : public RefCounted {
+private:
+  const char *data{nullptr};
+  std::size_t length{0};
+
+  MappedFile(const char *d, std::size_t l) : data{d}, length{l} {}
+
+public:
+  ~MappedFile() override;
+
+  /**
+   * @brief map the file at the path
+   *
+   * @param error the reason when it fails
+   * @return Ref<MappedFile> nullptr if it fails
+   */
+  static Ref<MappedFile> open(const std::string &path, std::string &error);
+
+  inline std::string_view text() const { return {data, length}; }
+
+  /**
+   * @brief make the mapping immortal, it is never unmapped
+   *
+   */
+  inline void freeze() { setImmortal(); }
+};
+
+#endif  // _OBJECT_MAPPED_FILE_HPP_
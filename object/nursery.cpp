@@ -0,0 +1,187 @@
+#include "nursery.hpp"
+
+#include "ref.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// The word before each object keeps it aligned to `Nursery::Alignment`
+static constexpr std::size_t HeaderSize = Nursery::Alignment;
+static_assert(Nursery::Granularity % HeaderSize == 0 && alignof(Nursery *) <= HeaderSize);
+
+static inline std::size_t alignUp(std::size_t size) {
+  return (size + Nursery::Granularity - 1) & ~(Nursery::Granularity - 1);
+}
+
+static inline char *end(void *slab) { return static_cast<char *>(slab) + Nursery::ChunkSize; }
+
+void *RefCounted::operator new(std::size_t size) { return Nursery::current().allocate(size); }
+
+void RefCounted::operator delete(void *p) { Nursery::free(p); }
+
+Nursery::~Nursery() {
+  // The objects which outlive the thread keep their slabs, the last
+  // one freed releases the chunk.
+  for (auto &&slab : chunks) {
+    if (slab->live == 0) {
+      std::free(slab);
+    } else {
+      slab->owner = nullptr;
+    }
+  }
+}
+
+Nursery &Nursery::current() {
+  static thread_local Nursery nursery{};
+  return nursery;
+}
+
+void *Nursery::allocate(std::size_t size) {
+  if (!enabled || size > MaxObjectSize) {
+    stats.fallbacks++;
+    char *block = static_cast<char *>(std::malloc(HeaderSize + size));
+    if (block == nullptr) {
+      throw std::bad_alloc{};
+    }
+    *reinterpret_cast<Slab **>(block) = nullptr;
+    return block + HeaderSize;
+  }
+
+  std::size_t sizeClass = sizeClassOf(size);
+  std::size_t slotSize = sizeClass * Granularity;
+
+  Slab *slab = active[sizeClass];
+  if (slab == nullptr || (slab->free == nullptr && slab->cursor + slotSize > end(slab))) {
+    slab = refill(sizeClass);
+  }
+
+  char *block{};
+  if (slab->free != nullptr) {
+    block = reinterpret_cast<char *>(slab->free);
+    slab->free = slab->free->next;
+  } else {
+    block = slab->cursor;
+    slab->cursor += slotSize;
+  }
+
+  *reinterpret_cast<Slab **>(block) = slab;
+  slab->live++;
+  stats.allocations++;
+  classes[sizeClass].allocations++;
+
+  return block + HeaderSize;
+}
+
+void Nursery::free(void *p) {
+  if (p == nullptr) {
+    return;
+  }
+
+  char *block = static_cast<char *>(p) - HeaderSize;
+  Slab *slab = *reinterpret_cast<Slab **>(block);
+  if (slab == nullptr) {
+    std::free(block);
+    return;
+  }
+
+  Slot *slot = reinterpret_cast<Slot *>(block);
+  if (slab->owner != nullptr) {
+    slab->owner->release(slab, slot);
+  } else if (--slab->live == 0) {
+    std::free(slab);
+  }
+}
+
+Nursery::Slab *Nursery::refill(std::size_t sizeClass) {
+  Slab *slab = partial[sizeClass];
+  if (slab != nullptr) {
+    unlink(slab);
+  } else if (!spare.empty()) {
+    slab = spare.back();
+    spare.pop_back();
+  } else {
+    slab = static_cast<Slab *>(std::malloc(ChunkSize));
+    if (slab == nullptr) {
+      throw std::bad_alloc{};
+    }
+    slab->owner = this;
+    slab->live = 0;
+    chunks.push_back(slab);
+    stats.chunks = chunks.size();
+  }
+
+  if (slab->live == 0) {
+    // A fresh slab, bump from the start
+    slab->free = nullptr;
+    slab->cursor = reinterpret_cast<char *>(slab) + alignUp(sizeof(Slab));
+    slab->sizeClass = static_cast<uint16_t>(sizeClass);
+    slab->partial = false;
+    classes[sizeClass].slabs++;
+  }
+
+  active[sizeClass] = slab;
+  return slab;
+}
+
+void Nursery::release(Slab *slab, Slot *slot) {
+  SizeClassStats &sizeClass = classes[slab->sizeClass];
+  sizeClass.frees++;
+
+  if (--slab->live == 0) {
+    if (slab == active[slab->sizeClass]) {
+      // Everything allocated in the current slab is dead, start over
+      stats.rewinds++;
+      slab->free = nullptr;
+      slab->cursor = reinterpret_cast<char *>(slab) + alignUp(sizeof(Slab));
+      return;
+    }
+
+    if (slab->partial) {
+      unlink(slab);
+    }
+    sizeClass.slabs--;
+
+    if (spare.size() < MaxSpareChunks) {
+      spare.push_back(slab);
+      return;
+    }
+
+    chunks.erase(std::find(chunks.begin(), chunks.end(), slab));
+    stats.chunks = chunks.size();
+    std::free(slab);
+    return;
+  }
+
+  slot->next = slab->free;
+  slab->free = slot;
+
+  // A full slab has room again
+  if (!slab->partial && slab != active[slab->sizeClass]) {
+    link(slab);
+  }
+}
+
+void Nursery::link(Slab *slab) {
+  Slab *&head = partial[slab->sizeClass];
+  slab->prev = nullptr;
+  slab->next = head;
+  if (head != nullptr) {
+    head->prev = slab;
+  }
+  head = slab;
+  slab->partial = true;
+}
+
+void Nursery::unlink(Slab *slab) {
+  if (slab->prev != nullptr) {
+    slab->prev->next = slab->next;
+  } else {
+    partial[slab->sizeClass] = slab->next;
+  }
+  if (slab->next != nullptr) {
+    slab->next->prev = slab->prev;
+  }
+  slab->partial = false;
+}
@@ -0,0 +1,150 @@
+#ifndef _OBJECT_NURSERY_HPP_
+#define _OBJECT_NURSERY_HPP_
+
+#include "ref.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The counters of one size class. The difference between the
+ * allocations and the frees is the live slots, the sum of them is the
+ * churn.
+ *
+ */
+struct SizeClassStats {
+  uint64_t allocations{};
+  uint64_t frees{};
+  std::size_t slabs{};
+};
+
+/**
+ * @brief The counters of the nursery
+ *
+ */
+struct NurseryStats {
+  uint64_t allocations{};
+  uint64_t fallbacks{};
+  uint64_t rewinds{};
+  std::size_t chunks{};
+};
+
+/**
+ * @brief Nursery is the allocator of the runtime objects. Most objects
+ * die right after they are created, such as the temporary strings and
+ * the arrays built by `push`, so allocating one is a pointer bump or a
+ * pop from a free list.
+ *
+ * The memory is carved into the chunks, and each chunk is a slab of one
+ * size class. A slot freed goes back to the free list of its slab, and
+ * the slab is allocated from by popping the free list first, then by
+ * bumping the pointer. A slab is returned to the spare chunks when every
+ * slot in it is freed, so the memory is reused by any size class and the
+ * fragmentation is bounded by the slabs which still hold live objects.
+ *
+ * The objects never move, the native code holds them by the raw pointer.
+ * Each object is preceded by a word pointing to its slab. The big objects
+ * and the objects allocated while the nursery is disabled come from
+ * `malloc`, their word is nullptr.
+ *
+ * The slots are multiples of `Granularity` bytes, but the word before the
+ * object leaves it aligned to `Alignment`, half of
+ * `alignof(std::max_align_t)`. The runtime objects only hold integers,
+ * doubles and pointers, and `makeRef` rejects an over-aligned one at
+ * compile time instead of padding every object.
+ *
+ */
+class Nursery {
+private:
+  struct Slot {
+    Slot *next;
+  };
+
+  struct Slab {
+    Nursery *owner;
+    Slab *prev;
+    Slab *next;
+    Slot *free;
+    char *cursor;
+    uint32_t live;
+    uint16_t sizeClass;
+    bool partial;
+  };
+
+public:
+  static constexpr std::size_t ChunkSize = 64 * 1024;
+  static constexpr std::size_t Granularity = 16;
+  static constexpr std::size_t Alignment = RefCounted::MaxAlignment;
+  static constexpr std::size_t MaxObjectSize = 512;
+  // The word before the object may take one more class
+  static constexpr std::size_t SizeClasses = MaxObjectSize / Granularity + 2;
+  static constexpr std::size_t MaxSpareChunks = 16;
+
+private:
+  // The slab allocated from and the other slabs with free slots, per
+  // size class
+  std::array<Slab *, SizeClasses> active{};
+  std::array<Slab *, SizeClasses> partial{};
+
+  // Every chunk owned, and the empty ones which are kept for reuse
+  std::vector<Slab *> chunks{};
+  std::vector<Slab *> spare{};
+
+  /**
+   * @brief find a slab with room for the size class
+   *
+   */
+  Slab *refill(std::size_t sizeClass);
+
+  /**
+   * @brief called when a slot of the slab is freed
+   *
+   */
+  void release(Slab *slab, Slot *slot);
+
+  void link(Slab *slab);
+  void unlink(Slab *slab);
+
+public:
+  // Whether the objects are allocated from the nursery, `malloc` is
+  // used otherwise. It could be switched at any time.
+  bool enabled{true};
+
+  NurseryStats stats{};
+  std::array<SizeClassStats, SizeClasses> classes{};
+
+  Nursery() = default;
+  Nursery(const Nursery &) = delete;
+  Nursery &operator=(const Nursery &) = delete;
+  ~Nursery();
+
+  /**
+   * @brief get the nursery of the current thread
+   *
+   */
+  static Nursery &current();
+
+  /**
+   * @brief the size class of an object, including the word before it
+   *
+   */
+  static inline std::size_t sizeClassOf(std::size_t size) {
+    return (size + sizeof(void *) + Granularity - 1) / Granularity;
+  }
+
+  /**
+   * @brief allocate the memory of an object
+   *
+   */
+  void *allocate(std::size_t size);
+
+  /**
+   * @brief free the memory returned by `allocate` on any nursery
+   *
+   */
+  static void free(void *p);
+};
+
+#endif  // _OBJECT_NURSERY_HPP_
@@ -1,12 +1,18 @@
 #include "object.hpp"
 
+#include "heap.hpp"
+
+#include <charconv>
+#include <cmath>
 #include <cstdint>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <vector>
 
 constexpr std::string_view INTEGER_OBJ = "INTEGER";
+constexpr std::string_view FLOAT_OBJ = "FLOAT";
 constexpr std::string_view BOOLEAN_OBJ = "BOOLEAN";
 constexpr std::string_view RETURN_VALUE_OBJ = "RETURN_VALUE";
 constexpr std::string_view FUNCTION_OBJ = "FUNCTION";
@@ -14,37 +20,364 @@ constexpr std::string_view ERROR_OBJ = "ERROR";
 constexpr std::string_view STRING_OBJ = "STRING";
 constexpr std::string_view BUILTIN_OBJ = "BUILTIN";
 constexpr std::string_view ARRAY_OBJ = "ARRAY";
+constexpr std::string_view HASH_OBJ = "HASH";
 constexpr std::string_view COMPILED_FUNCTION_OBJ = "COMPILED_FUNCTION";
 constexpr std::string_view CLOSURE_OBJ = "CLOSURE";
+constexpr std::string_view ITERATOR_OBJ = "ITERATOR";
+
+ObjectType Object::type() const { return typeName(kind); }
+
+ObjectType Object::typeName(ObjectKind kind) {
+  switch (kind) {
+    case ObjectKind::Integer:
+      return std::string(INTEGER_OBJ);
+    case ObjectKind::Float:
+      return std::string(FLOAT_OBJ);
+    case ObjectKind::Boolean:
+      return std::string(BOOLEAN_OBJ);
+    case ObjectKind::ReturnValue:
+      return std::string(RETURN_VALUE_OBJ);
+    case ObjectKind::Function:
+      return std::string(FUNCTION_OBJ);
+    case ObjectKind::CompiledFunction:
+      return std::string(COMPILED_FUNCTION_OBJ);
+    case ObjectKind::Closure:
+      return std::string(CLOSURE_OBJ);
+    case ObjectKind::Error:
+      return std::string(ERROR_OBJ);
+    case ObjectKind::String:
+      return std::string(STRING_OBJ);
+    case ObjectKind::Builtin:
+      return std::string(BUILTIN_OBJ);
+    case ObjectKind::Array:
+      return std::string(ARRAY_OBJ);
+    case ObjectKind::Hash:
+      return std::string(HASH_OBJ);
+    case ObjectKind::Iterator:
+      return std::string(ITERATOR_OBJ);
+  }
+  return "";
+}
+
+Value::Value(Ref<Object> o) {
+  if (o == nullptr) {
+    return;
+  }
+
+  if (o->is<Integer>()) {
+    tag = Tag::Integer;
+    integer = o->as<Integer>()->value;
+  } else if (o->is<Float>()) {
+    tag = Tag::Float;
+    floating = o->as<Float>()->value;
+  } else if (o->is<Boolean>()) {
+    tag = Tag::Boolean;
+    boolean = o->as<Boolean>()->value;
+  } else {
+    tag = Tag::Object;
+    object = o.get();
+    object->retain();
+  }
+}
+
+Ref<Object> Value::toObject() const {
+  switch (tag) {
+    case Tag::Integer:
+      return Integer::of(integer);
+    case Tag::Float:
+      return makeRef<Float>(floating);
+    case Tag::Boolean:
+      return Boolean::of(boolean);
+    case Tag::Object:
+      return Ref<Object>{object};
+    default:
+      return nullptr;
+  }
+}
+
+ObjectType Value::type() const {
+  switch (tag) {
+    case Tag::Integer:
+      return std::string(INTEGER_OBJ);
+    case Tag::Float:
+      return std::string(FLOAT_OBJ);
+    case Tag::Boolean:
+      return std::string(BOOLEAN_OBJ);
+    case Tag::Object:
+      return object->type();
+    default:
+      return "NULL";
+  }
+}
+
+void Value::inspect(Writer &writer) const {
+  char buffer[32];
+  switch (tag) {
+    case Tag::Integer: {
+      auto result = std::to_chars(buffer, buffer + sizeof(buffer), integer);
+      writer.write(std::string_view{buffer, static_cast<std::size_t>(result.ptr - buffer)});
+      break;
+    }
+    case Tag::Object:
+      object->inspect(writer);
+      break;
+    default:
+      writer.write(inspect());
+  }
+}
+
+std::string Value::inspect() const {
+  switch (tag) {
+    case Tag::Integer:
+      return std::to_string(integer);
+    case Tag::Float:
+      return Float::format(floating);
+    case Tag::Boolean:
+      return boolean ? "true" : "false";
+    case Tag::Object:
+      return object->inspect();
+    default:
+      return "null";
+  }
+}
+
+/**
+ * @brief Make an object which is never destroyed, even at exit. So
+ * it is safe to use from static initialization and destruction.
+ *
+ */
+template <typename T, typename V>
+static Ref<T> makeImmortal(V v) {
+  Ref<T> object = makeRef<T>(v);
+  object->freeze();
+  return object;
+}
+
+static thread_local ObjectCounters objectCounters{};
+
+Object::Object(ObjectKind k) : kind{k} {
+  objectCounters.allocated[static_cast<std::size_t>(k)]++;
 
-Integer::Integer(int64_t v) : value{v} {}
+  // Only the objects which reference others could be part of a cycle
+  switch (k) {
+    case ObjectKind::Array:
+      Heap::current().track(this, HeapSpace::Arrays);
+      break;
+    case ObjectKind::Closure:
+      Heap::current().track(this, HeapSpace::Closures);
+      break;
+    case ObjectKind::Function:
+      Heap::current().track(this, HeapSpace::Functions);
+      break;
+    case ObjectKind::Hash:
+      Heap::current().track(this, HeapSpace::Hashes);
+      break;
+    case ObjectKind::Iterator:
+      Heap::current().track(this, HeapSpace::Iterators);
+      break;
+    default:
+      break;
+  }
+}
+
+Object::~Object() { objectCounters.freed[static_cast<std::size_t>(kind)]++; }
+
+ObjectCounters &Object::counters() { return objectCounters; }
+
+void Object::freeze() { setImmortal(); }
+
+void Object::inspect(Writer &writer) { writer.write(inspect()); }
+
+Integer::Integer(int64_t v) : Object{Kind}, value{v} {}
 std::string Integer::inspect() { return std::to_string(value); }
-ObjectType Integer::type() { return std::string(INTEGER_OBJ); }
+void Integer::inspect(Writer &writer) { Value::fromInteger(value).inspect(writer); }
+
+Ref<Integer> Integer::of(int64_t v) {
+  static const std::vector<Ref<Integer>> smallIntegers = [] {
+    std::vector<Ref<Integer>> integers{};
+    integers.reserve(SmallMax - SmallMin + 1);
+    for (int64_t i = SmallMin; i <= SmallMax; i++) {
+      integers.push_back(makeImmortal<Integer>(i));
+    }
+    return integers;
+  }();
+
+  if (v >= SmallMin && v <= SmallMax) {
+    return smallIntegers[v - SmallMin];
+  }
+  return makeRef<Integer>(v);
+}
+
+Float::Float(double v) : Object{Kind}, value{v} {}
+std::string Float::inspect() { return format(value); }
+
+std::string Float::format(double v) {
+  if (std::isnan(v)) {
+    return "NaN";
+  } else if (std::isinf(v)) {
+    return v > 0 ? "+Inf" : "-Inf";
+  }
+
+  // The shortest form which reads back as the same double
+  char buffer[32];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), v);
+  std::string formatted{buffer, result.ptr};
+  if (formatted.find_first_of(".e") == std::string::npos) {
+    formatted += ".0";
+  }
+  return formatted;
+}
 
-Boolean::Boolean(bool v) : value{v} {}
+Boolean::Boolean(bool v) : Object{Kind}, value{v} {}
+const Ref<Boolean> &Boolean::of(bool v) {
+  static const Ref<Boolean> True = makeImmortal<Boolean>(true);
+  static const Ref<Boolean> False = makeImmortal<Boolean>(false);
+  return v ? True : False;
+}
 std::string Boolean::inspect() { return value ? "true" : "false"; }
-ObjectType Boolean::type() { return std::string(BOOLEAN_OBJ); }
 
 std::string ReturnValue::inspect() { return value->inspect(); }
-ObjectType ReturnValue::type() { return std::string(RETURN_VALUE_OBJ); }
+void ReturnValue::inspect(Writer &writer) { value->inspect(writer); }
 
-Error::Error(const std::string &m) : message{m} {}
+Error::Error(const std::string &m) : Object{Kind}, message{m} {}
 std::string Error::inspect() { return "ERROR: " + message; }
-ObjectType Error::type() { return std::string(ERROR_OBJ); }
 
-String::String(const std::string &s) : value{s} {}
-std::string String::inspect() { return value; }
-ObjectType String::type() { return std::string(STRING_OBJ); }
+BudgetError::BudgetError(const std::string &r) : Error{"budget exhausted: " + r}, resource{r} {}
+
+String::String(const std::string &s) : Object{Kind}, flat{s}, length{s.size()} {}
+String::String(std::string &&s) : Object{Kind}, flat{std::move(s)}, length{flat.size()} {}
+
+Ref<String> String::view(Ref<MappedFile> file, std::string_view text) {
+  auto string = makeRef<String>();
+  string->length = text.size();
+  string->viewed = text.data();
+  string->file = std::move(file);
+  return string;
+}
+
+String::~String() {
+  if (interner != nullptr) {
+    interner->remove(this);
+  }
+  if (left != nullptr) {
+    releaseHalves();
+  }
+}
+
+Ref<String> String::concat(String *a, String *b) {
+  if (a->length == 0) {
+    return Ref<String>{b};
+  }
+  if (b->length == 0) {
+    return Ref<String>{a};
+  }
+
+  std::size_t length = a->length + b->length;
+  if (length < MinRopeLength) {
+    // Neither of them could be a rope
+    std::string text{a->value()};
+    text += b->value();
+    if (length <= Interner::MaxLength) {
+      return Interner::current().intern(std::move(text));
+    }
+    return makeRef<String>(std::move(text));
+  }
+
+  auto rope = makeRef<String>();
+  rope->left = Ref<String>{a};
+  rope->right = Ref<String>{b};
+  rope->length = length;
+  return rope;
+}
+
+void String::flatten() const {
+  std::string text{};
+  text.reserve(length);
+
+  // The halves are visited from left to right
+  std::vector<const String *> pending{this};
+  while (!pending.empty()) {
+    const String *s = pending.back();
+    pending.pop_back();
+
+    if (s->left == nullptr) {
+      text += s->value();
+    } else {
+      pending.push_back(s->right.get());
+      pending.push_back(s->left.get());
+    }
+  }
+
+  flat = std::move(text);
+  releaseHalves();
+}
+
+void String::releaseHalves() const {
+  std::vector<Ref<String>> pending{};
+  pending.push_back(std::move(left));
+  pending.push_back(std::move(right));
+
+  while (!pending.empty()) {
+    Ref<String> s = std::move(pending.back());
+    pending.pop_back();
+
+    // Take the halves of the rope which is about to be freed, so its
+    // destructor does not recurse.
+    if (s->left != nullptr && s->getRefCount() == 1 && !s->isImmortal()) {
+      pending.push_back(std::move(s->left));
+      pending.push_back(std::move(s->right));
+    }
+  }
+}
+
+bool String::equals(const String *other) const {
+  if (this == other) {
+    return true;
+  }
+  if (interner != nullptr && interner == other->interner) {
+    return false;
+  }
+  if (length != other->length) {
+    return false;
+  }
+  if (hashed && other->hashed && hashValue != other->hashValue) {
+    return false;
+  }
+  return value() == other->value();
+}
+
+void String::freeze() {
+  // A frozen string could be read by other threads, it should never
+  // be flattened or hashed lazily, and it could be freed by any of
+  // them, so it leaves the interner.
+  hash();
+  if (interner != nullptr) {
+    interner->remove(this);
+  }
+  if (file != nullptr) {
+    file->freeze();
+  }
+  Object::freeze();
+}
+
+std::string String::inspect() { return std::string{value()}; }
+void String::inspect(Writer &writer) { writer.write(value()); }
 
 Function::Function(std::vector<std::unique_ptr<Identifier>> &&p,
                    std::unique_ptr<BlockStatement> &&b,
-                   std::shared_ptr<Environment> e) {
+                   Ref<Environment> e)
+    : Object{Kind} {
   parameters = std::move(p);
   body = std::move(b);
 
   // set the current environment
-  env = e;
+  env = std::move(e);
 }
+
+void Function::trace(Tracer &tracer) { tracer.visit(env); }
+
+void Function::clearReferences() { env.reset(); }
+
 std::string Function::inspect() {
   std::string info{};
   info += "fn(";
@@ -64,9 +397,9 @@ std::string Function::inspect() {
 
   return info;
 }
-ObjectType Function::type() { return std::string(FUNCTION_OBJ); }
 
-CompiledFunction::CompiledFunction(Instructions &&i, int numLocals_) : numLocals{numLocals_} {
+CompiledFunction::CompiledFunction(Instructions &&i, int numLocals_, int numParameters_)
+    : Object{Kind}, numLocals{numLocals_}, numParameters{numParameters_} {
   instructions = std::move(i);
 }
 
@@ -80,9 +413,29 @@ std::string CompiledFunction::inspect() {
 
   return info;
 }
-ObjectType CompiledFunction::type() { return std::string(COMPILED_FUNCTION_OBJ); }
 
-ObjectType Closure::type() { return std::string(CLOSURE_OBJ); }
+void Closure::freeze() {
+  if (isImmortal()) {
+    return;
+  }
+  Object::freeze();
+  fn->freeze();
+  for (auto &&value : free) {
+    if (value.isObject()) {
+      value.getObject()->freeze();
+    }
+  }
+}
+
+void Closure::trace(Tracer &tracer) {
+  // The compiled function is a constant, it references nothing.
+  for (auto &&value : free) {
+    tracer.visit(value.getObject());
+  }
+}
+
+void Closure::clearReferences() { free.clear(); }
+
 std::string Closure::inspect() {
   const void *address = static_cast<const void *>(this);
 
@@ -94,23 +447,192 @@ std::string Closure::inspect() {
   return info;
 }
 
-Builtin::Builtin(BuiltinFunction f) : fn{f} {}
+Builtin::Builtin(const char *n, BuiltinFunction f, int minArity_, int maxArity_)
+    : Object{Kind}, name{n}, fn{f}, minArity{minArity_}, maxArity{maxArity_} {}
+
+Value Builtin::arityError(int count) const {
+  std::string want = std::to_string(minArity);
+  if (maxArity == Variadic) {
+    want += " or more";
+  } else if (maxArity != minArity) {
+    want += " to " + std::to_string(maxArity);
+  }
+  return makeRef<Error>("wrong number of arguments. got=" + std::to_string(count) + ", want=" + want);
+}
 std::string Builtin::inspect() { return "builtin function"; }
-ObjectType Builtin::type() { return std::string(BUILTIN_OBJ); }
+
+Ref<Array> Array::from(const Ref<Object> *values, std::size_t count) {
+  auto array = makeRef<Array>();
+  bool integers = count > 0;
+  for (std::size_t i = 0; i < count && integers; i++) {
+    integers = values[i] != nullptr && values[i]->is<Integer>();
+  }
+
+  if (integers) {
+    array->unboxed = true;
+    array->integers.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+      array->integers.push_back(values[i]->as<Integer>()->value);
+    }
+  } else {
+    array->elements.assign(values, values + count);
+  }
+  return array;
+}
+
+Ref<Array> Array::from(const Value *values, std::size_t count) {
+  auto array = makeRef<Array>();
+  bool integers = count > 0;
+  for (std::size_t i = 0; i < count && integers; i++) {
+    integers = values[i].isInteger();
+  }
+
+  if (integers) {
+    array->unboxed = true;
+    array->integers.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+      array->integers.push_back(values[i].getInteger());
+    }
+  } else {
+    for (std::size_t i = 0; i < count; i++) {
+      array->elements.push_back(values[i].toObject());
+    }
+  }
+  return array;
+}
+
+Ref<Array> Array::from(IntVector &&integers) {
+  auto array = makeRef<Array>();
+  array->unboxed = true;
+  array->integers = std::move(integers);
+  return array;
+}
+
+Ref<Array> Array::rest() const {
+  auto result = makeRef<Array>();
+  result->unboxed = unboxed;
+  if (unboxed) {
+    result->integers = integers.rest();
+  } else {
+    result->elements = elements.rest();
+  }
+  return result;
+}
+
+Ref<Array> Array::pushed(const Value &value) const {
+  auto result = makeRef<Array>();
+
+  if (value.isInteger() && (unboxed || empty())) {
+    result->unboxed = true;
+    result->integers = integers;
+    result->integers.push_back(value.getInteger());
+    return result;
+  }
+
+  if (unboxed) {
+    // Box the integers once, the new array is boxed from now on
+    for (auto &&integer : integers) {
+      result->elements.push_back(Integer::of(integer));
+    }
+  } else {
+    result->elements = elements;
+  }
+  result->elements.push_back(value.toObject());
+  return result;
+}
+
+void Array::freeze() {
+  // The array could contain itself
+  if (isImmortal()) {
+    return;
+  }
+  Object::freeze();
+  elements.freeze();
+  integers.freeze();
+}
+
+void Array::trace(Tracer &tracer) { elements.trace(tracer); }
+
+void Array::clearReferences() { elements.clear(); }
 
 std::string Array::inspect() {
-  if (elements.empty()) {
-    return "[]";
+  Writer writer{};
+  inspect(writer);
+  return std::move(writer.str());
+}
+
+void Array::inspect(Writer &writer) {
+  if (!writer.enter()) {
+    writer.write("[...]");
+    return;
   }
 
-  std::string info = "[";
+  writer.write('[');
+  for (std::size_t i = 0; i < size() && !writer.full(); i++) {
+    if (i > 0) {
+      writer.write(", ");
+    }
+    if (unboxed) {
+      Value::fromInteger(integers[i]).inspect(writer);
+    } else if (elements[i] == nullptr) {
+      writer.write("null");
+    } else {
+      elements[i]->inspect(writer);
+    }
+  }
+  writer.write(']');
+  writer.leave();
+}
 
-  int i = 0;
-  for (; i < elements.size() - 1; ++i) {
-    info += elements[i]->inspect() + ", ";
+void Hash::freeze() {
+  // The hash could contain itself
+  if (isImmortal()) {
+    return;
+  }
+  Object::freeze();
+  for (auto &&pair : pairs.entries()) {
+    pair.key->freeze();
+    if (pair.value != nullptr) {
+      pair.value->freeze();
+    }
   }
+}
 
-  info += elements[i]->inspect() + "]";
-  return info;
+void Hash::trace(Tracer &tracer) {
+  for (auto &&pair : pairs.entries()) {
+    tracer.visit(pair.key);
+    tracer.visit(pair.value);
+  }
+}
+
+void Hash::clearReferences() { pairs.clear(); }
+
+std::string Hash::inspect() {
+  Writer writer{};
+  inspect(writer);
+  return std::move(writer.str());
+}
+
+void Hash::inspect(Writer &writer) {
+  if (!writer.enter()) {
+    writer.write("{...}");
+    return;
+  }
+
+  writer.write('{');
+  bool first = true;
+  for (auto &&pair : pairs.entries()) {
+    if (writer.full()) {
+      break;
+    }
+    if (!first) {
+      writer.write(", ");
+    }
+    first = false;
+    pair.key->inspect(writer);
+    writer.write(": ");
+    Value{pair.value}.inspect(writer);
+  }
+  writer.write('}');
+  writer.leave();
 }
-ObjectType Array::type() { return std::string(ARRAY_OBJ); }
@@ -5,43 +5,396 @@ class Environment;
 class Object;
 
 #include "ast.hpp"
-
+#include "hashTable.hpp"
+#include "intVector.hpp"
+#include "interner.hpp"
+#include "mappedFile.hpp"
+#include "persistentVector.hpp"
+#include "ref.hpp"
+#include "writer.hpp"
+
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 using ObjectType = std::string;
 
-using BuiltinFunction = std::function<std::shared_ptr<Object>(std::vector<std::shared_ptr<Object>> &)>;
-
 using Instructions = std::vector<std::byte>;
 
+/**
+ * @brief The tag of the concrete object class. It is set once by the
+ * constructor, so the type checks on the hot paths are a byte compare
+ * instead of building the type name or `dynamic_cast`.
+ *
+ */
+enum class ObjectKind : uint8_t {
+  Integer,
+  Boolean,
+  ReturnValue,
+  Function,
+  CompiledFunction,
+  Closure,
+  Error,
+  String,
+  Builtin,
+  Array,
+  Hash,
+  Float,
+  Iterator,
+};
+
+static constexpr std::size_t ObjectKinds = 13;
+
+/**
+ * @brief The number of the objects allocated and freed per kind on the
+ * current thread, the difference is the live objects.
+ *
+ */
+struct ObjectCounters {
+  std::array<uint64_t, ObjectKinds> allocated{};
+  std::array<uint64_t, ObjectKinds> freed{};
+};
+
 /**
  * @brief Base class to represent the object
  *
  */
-class Object {
+class Object : public RefCounted {
 public:
-  virtual ObjectType type() = 0;
+  const ObjectKind kind;
+
+  /**
+   * @brief the containers are tracked by the heap of the thread
+   *
+   */
+  Object(ObjectKind k);
+
+  /**
+   * @brief get the counters of the current thread
+   *
+   */
+  static ObjectCounters &counters();
+
+  /**
+   * @brief get the type name, it is only used by the error messages
+   * and `inspect`. Use `is<T>()` to check the type.
+   *
+   */
+  ObjectType type() const;
+
+  /**
+   * @brief get the type name of the kind
+   *
+   */
+  static ObjectType typeName(ObjectKind kind);
+
+  /**
+   * @brief whether the object is a `T`. The subclasses of a concrete
+   * class such as `BudgetError` share the kind of their base.
+   *
+   */
+  template <typename T>
+  inline bool is() const {
+    return kind == T::Kind;
+  }
+
+  /**
+   * @brief cast to `T` without checking, call `is<T>()` first
+   *
+   */
+  template <typename T>
+  inline T *as() {
+    return static_cast<T *>(this);
+  }
+
+  template <typename T>
+  inline const T *as() const {
+    return static_cast<const T *>(this);
+  }
+
+  /**
+   * @brief Make the object and everything it references immortal. The
+   * reference count of a frozen object is never touched again, so it
+   * could be shared by the VMs on different threads as long as nobody
+   * mutates it. A frozen object is never freed.
+   *
+   */
+  virtual void freeze();
+
   virtual std::string inspect() = 0;
-  virtual ~Object() = default;
+
+  /**
+   * @brief write the text of `inspect` to the writer, the containers
+   * write their elements one by one instead of building a string
+   *
+   */
+  virtual void inspect(Writer &writer);
+
+  virtual ~Object();
+};
+
+/**
+ * @brief Value is what the VM passes around. Integers, floats, booleans
+ * and null are stored inline, so arithmetic neither allocates nor touches
+ * any reference count. Only the other types such as strings, arrays,
+ * closures and builtins point to the heap objects.
+ *
+ * An `Integer`, a `Float` or a `Boolean` object is always unboxed when the
+ * value is built from the object, so the inline form is the only form of
+ * them.
+ * The object pointer shares the storage with the inline payloads, the
+ * value is 16 bytes.
+ *
+ */
+class Value {
+public:
+  enum class Tag : uint8_t {
+    Null,
+    Integer,
+    Float,
+    Boolean,
+    Object,
+  };
+
+private:
+  Tag tag{Tag::Null};
+  union {
+    int64_t integer{0};
+    double floating;
+    bool boolean;
+    Object *object;
+  };
+
+  inline void retain() {
+    if (tag == Tag::Object) {
+      object->retain();
+    }
+  }
+
+  inline void release() {
+    if (tag == Tag::Object) {
+      object->release();
+    }
+  }
+
+public:
+  Value() = default;
+  Value(std::nullptr_t) {}
+  Value(Ref<Object> o);
+  template <typename T>
+  Value(Ref<T> o) : Value{Ref<Object>{std::move(o)}} {}
+
+  Value(const Value &v) : tag{v.tag}, integer{v.integer} { retain(); }
+  Value(Value &&v) noexcept : tag{v.tag}, integer{v.integer} { v.tag = Tag::Null; }
+  ~Value() { release(); }
+
+  Value &operator=(Value v) noexcept {
+    std::swap(tag, v.tag);
+    std::swap(integer, v.integer);
+    return *this;
+  }
+
+  static inline Value fromInteger(int64_t v) {
+    Value value{};
+    value.tag = Tag::Integer;
+    value.integer = v;
+    return value;
+  }
+
+  static inline Value fromFloat(double v) {
+    Value value{};
+    value.tag = Tag::Float;
+    value.floating = v;
+    return value;
+  }
+
+  static inline Value fromBoolean(bool v) {
+    Value value{};
+    value.tag = Tag::Boolean;
+    value.boolean = v;
+    return value;
+  }
+
+  inline Tag getTag() const { return tag; }
+  inline bool isNull() const { return tag == Tag::Null; }
+  inline bool isInteger() const { return tag == Tag::Integer; }
+  inline bool isFloat() const { return tag == Tag::Float; }
+  inline bool isNumber() const { return tag == Tag::Integer || tag == Tag::Float; }
+  inline bool isBoolean() const { return tag == Tag::Boolean; }
+  inline bool isObject() const { return tag == Tag::Object; }
+
+  inline int64_t getInteger() const { return integer; }
+  inline double getFloat() const { return floating; }
+
+  /**
+   * @brief the integer or the float promoted to double, call `isNumber()` first
+   *
+   */
+  inline double getNumber() const { return tag == Tag::Float ? floating : static_cast<double>(integer); }
+  inline bool getBoolean() const { return boolean; }
+  inline Object *getObject() const { return tag == Tag::Object ? object : nullptr; }
+
+  /**
+   * @brief null and false are falsy, everything else is truthy
+   *
+   */
+  inline bool isTruthy() const { return tag == Tag::Boolean ? boolean : tag != Tag::Null; }
+
+  /**
+   * @brief whether the value points to a `T` object
+   *
+   */
+  template <typename T>
+  inline bool is() const {
+    return tag == Tag::Object && object->is<T>();
+  }
+
+  /**
+   * @brief cast the object to `T` without checking, call `is<T>()` first
+   *
+   */
+  template <typename T>
+  inline T *as() const {
+    return static_cast<T *>(object);
+  }
+
+  /**
+   * @brief share the ownership of the object as `T`, call `is<T>()` first
+   *
+   */
+  template <typename T>
+  inline Ref<T> share() const {
+    return Ref<T>{static_cast<T *>(object)};
+  }
+
+  /**
+   * @brief box the value into the object, for the code which still
+   * works with objects such as the arrays and the evaluator.
+   *
+   * @return Ref<Object> nullptr for null
+   */
+  Ref<Object> toObject() const;
+
+  /**
+   * @brief the type name, used by the error messages
+   *
+   */
+  ObjectType type() const;
+
+  std::string inspect() const;
+  void inspect(Writer &writer) const;
+};
+
+/**
+ * @brief Caller calls a function on behalf of a builtin such as `map`,
+ * the VM and the evaluator pass themselves to the builtins they call.
+ *
+ */
+class Caller {
+public:
+  /**
+   * @brief call the function with the values as its arguments
+   *
+   * @return Value the result, an `Error` if the call failed
+   */
+  virtual Value call(const Value &fn, const Value *values, std::size_t count) = 0;
+
+  /**
+   * @brief burn the budget of the caller for one element of a native
+   * loop, so a sandboxed run could stop a builtin such as `count`
+   *
+   * @param error the `BudgetError` when it is exhausted
+   * @return bool false if the budget is exhausted
+   */
+  virtual bool tick([[maybe_unused]] Value &error) { return true; }
+
+protected:
+  ~Caller() = default;
 };
 
+/**
+ * @brief Arguments is the view of the arguments of a builtin, they stay
+ * where the caller put them, such as the VM stack, so a call does not
+ * copy them.
+ *
+ */
+class Arguments {
+private:
+  const Value *values;
+  std::size_t count;
+
+public:
+  // Who called the builtin, nullptr if it could not call back
+  Caller *caller;
+
+  Arguments(const Value *v, std::size_t c, Caller *caller_ = nullptr) : values{v}, count{c}, caller{caller_} {}
+
+  inline std::size_t size() const { return count; }
+  inline bool empty() const { return count == 0; }
+  inline const Value &operator[](std::size_t i) const { return values[i]; }
+  inline const Value *begin() const { return values; }
+  inline const Value *end() const { return values + count; }
+};
+
+using BuiltinFunction = Value (*)(Arguments arguments);
+
 /**
  * @brief Integer class represents int64_t
  *
  */
 class Integer : public Object {
 public:
+  static constexpr ObjectKind Kind = ObjectKind::Integer;
+
+  // The range of the small integers which are preallocated
+  static constexpr int64_t SmallMin = -128;
+  static constexpr int64_t SmallMax = 1023;
+
   int64_t value;
 
-  Integer() = default;
+  Integer() : Object{Kind} {}
   Integer(int64_t v);
 
-  ObjectType type() override;
+  /**
+   * @brief get the integer object. The small integers are shared
+   * process-wide immortal objects, others are newly allocated.
+   *
+   * @param v the value
+   * @return Ref<Integer>
+   */
+  static Ref<Integer> of(int64_t v);
+
+  std::string inspect() override;
+  void inspect(Writer &writer) override;
+};
+
+/**
+ * @brief Float class represents double
+ *
+ */
+class Float : public Object {
+public:
+  static constexpr ObjectKind Kind = ObjectKind::Float;
+
+  double value;
+
+  Float() : Object{Kind} {}
+  Float(double v);
+
+  /**
+   * @brief format the float, it always has a dot or an exponent so it
+   * reads back as a float, such as `2.0` or `1e+100`
+   *
+   */
+  static std::string format(double v);
+
   std::string inspect() override;
 };
 
@@ -51,12 +404,22 @@ public:
  */
 class Boolean : public Object {
 public:
+  static constexpr ObjectKind Kind = ObjectKind::Boolean;
+
   bool value;
 
-  Boolean() = default;
+  Boolean() : Object{Kind} {}
   Boolean(bool v);
 
-  ObjectType type() override;
+  /**
+   * @brief get the process-wide immortal `true` or `false`. There
+   * is no need to allocate another boolean object.
+   *
+   * @param v the value
+   * @return const Ref<Boolean>&
+   */
+  static const Ref<Boolean> &of(bool v);
+
   std::string inspect() override;
 };
 
@@ -66,12 +429,52 @@ public:
  */
 class ReturnValue : public Object {
 public:
-  std::shared_ptr<Object> value;
+  static constexpr ObjectKind Kind = ObjectKind::ReturnValue;
+
+  Ref<Object> value;
 
-  ReturnValue() = default;
+  ReturnValue() : Object{Kind} {}
 
-  ObjectType type() override;
   std::string inspect() override;
+  void inspect(Writer &writer) override;
+};
+
+/**
+ * @brief Environment is used to indicate the current frame
+ * environment. It is a scope and all the values associated
+ * with this scope is recorded in it. When we meet a new
+ * scope such as functions, we should spawn a new scope,
+ * which means that we should create a new environment class.
+ *
+ */
+class Environment : public RefCounted {
+private:
+  Ref<Environment> outer;
+
+public:
+  std::unordered_map<std::string, Ref<Object>> store{};
+  Environment();
+  Environment(Ref<Environment> o);
+  Environment(const Environment &) = delete;
+
+  /**
+   * @brief get the binding value
+   *
+   * @param name the identifier name
+   * @return Ref<Object>
+   */
+  Ref<Object> get(const std::string &name);
+
+  /**
+   * @brief bind the identifier
+   *
+   * @param name the identifier name
+   * @param val the new object value
+   */
+  void set(const std::string &name, Ref<Object> val);
+
+  void trace(Tracer &tracer) override;
+  void clearReferences() override;
 };
 
 /**
@@ -80,16 +483,17 @@ public:
  */
 class Function : public Object {
 public:
+  static constexpr ObjectKind Kind = ObjectKind::Function;
+
   std::vector<std::unique_ptr<Identifier>> parameters;
   std::unique_ptr<BlockStatement> body;
-  std::weak_ptr<Environment> env;
+  Ref<Environment> env;
 
-  Function() = default;
-  Function(std::vector<std::unique_ptr<Identifier>> &&p,
-           std::unique_ptr<BlockStatement> &&b,
-           std::shared_ptr<Environment> e);
+  Function() : Object{Kind} {}
+  Function(std::vector<std::unique_ptr<Identifier>> &&p, std::unique_ptr<BlockStatement> &&b, Ref<Environment> e);
 
-  ObjectType type() override;
+  void trace(Tracer &tracer) override;
+  void clearReferences() override;
   std::string inspect() override;
 };
 
@@ -99,28 +503,34 @@ public:
  */
 class CompiledFunction : public Object {
 public:
+  static constexpr ObjectKind Kind = ObjectKind::CompiledFunction;
+
   Instructions instructions;
   int numLocals;
+  int numParameters{};
 
-  CompiledFunction() = default;
-  CompiledFunction(Instructions &&i, int numLocals_);
+  CompiledFunction() : Object{Kind} {}
+  CompiledFunction(Instructions &&i, int numLocals_, int numParameters_ = 0);
 
-  ObjectType type() override;
   std::string inspect() override;
 };
 
 class Closure : public Object {
 public:
-  std::shared_ptr<CompiledFunction> fn;
-  std::vector<std::shared_ptr<Object>> free{};
+  static constexpr ObjectKind Kind = ObjectKind::Closure;
+
+  Ref<CompiledFunction> fn;
+  std::vector<Value> free{};
 
-  Closure() = default;
-  Closure(std::shared_ptr<CompiledFunction> &fn_) : fn{fn_} {}
-  Closure(std::shared_ptr<CompiledFunction> &fn_, std::vector<std::shared_ptr<Object>> &&free_) : fn{fn_} {
+  Closure() : Object{Kind} {}
+  Closure(Ref<CompiledFunction> &fn_) : Object{Kind}, fn{fn_} {}
+  Closure(Ref<CompiledFunction> &fn_, std::vector<Value> &&free_) : Object{Kind}, fn{fn_} {
     free = std::move(free_);
   }
 
-  ObjectType type() override;
+  void freeze() override;
+  void trace(Tracer &tracer) override;
+  void clearReferences() override;
   std::string inspect() override;
 };
 
@@ -130,88 +540,276 @@ public:
  */
 class Error : public Object {
 public:
+  static constexpr ObjectKind Kind = ObjectKind::Error;
+
   std::string message;
 
-  Error() = default;
+  Error() : Object{Kind} {}
   Error(const std::string &m);
 
-  ObjectType type() override;
   std::string inspect() override;
 };
 
+/**
+ * @brief BudgetError is raised when a sandboxed run exhausts one of
+ * its budgets. It is still an `Error`, the caller could tell it apart
+ * from the errors of the script with `dynamic_cast`.
+ *
+ */
+class BudgetError : public Error {
+public:
+  std::string resource;
+
+  BudgetError(const std::string &r);
+};
+
 /**
  * @brief Represents the string "foobar".
  *
+ * A long concatenation is a rope: it only references the two halves, and
+ * the text is built when it is needed, such as printing it. So appending
+ * a piece to a string again and again is linear instead of quadratic.
+ * The halves are released once the rope is flattened.
+ *
+ * The literals and the short results are interned, see `Interner`, and
+ * the hash is computed once, so comparing two strings is usually a
+ * pointer comparison.
+ *
  */
 class String : public Object {
+private:
+  friend class Interner;
+
+  mutable std::string flat{};
+
+  // The file behind the text of a view, see `String::view`
+  Ref<MappedFile> file{};
+  const char *viewed{nullptr};
+
+  // The halves of the concatenation which is not flattened yet
+  mutable Ref<String> left{};
+  mutable Ref<String> right{};
+
+  std::size_t length{0};
+
+  mutable std::size_t hashValue{0};
+  mutable bool hashed{false};
+
+  // The interner which holds the string, if any
+  Interner *interner{nullptr};
+
+  /**
+   * @brief build the text of the rope, without recursion
+   *
+   */
+  void flatten() const;
+
+  /**
+   * @brief release the halves, without recursion for a deep rope
+   *
+   */
+  void releaseHalves() const;
+
 public:
-  std::string value;
+  static constexpr ObjectKind Kind = ObjectKind::String;
 
-  String() = default;
+  // The shorter concatenations are copied at once
+  static constexpr std::size_t MinRopeLength = 64;
+
+  String() : Object{Kind} {}
   String(const std::string &);
+  String(std::string &&);
+  ~String() override;
+
+  /**
+   * @brief concatenate the strings
+   *
+   */
+  static Ref<String> concat(String *a, String *b);
 
-  ObjectType type() override;
+  /**
+   * @brief get the string whose text is a part of the mapped file, it is
+   * not copied
+   *
+   */
+  static Ref<String> view(Ref<MappedFile> file, std::string_view text);
+
+  /**
+   * @brief get the file the text is a part of, nullptr if it is not a view
+   *
+   */
+  inline const Ref<MappedFile> &mapping() const { return file; }
+
+  /**
+   * @brief get the text, the rope is flattened
+   *
+   */
+  inline std::string_view value() const {
+    if (left != nullptr) {
+      flatten();
+    }
+    return file != nullptr ? std::string_view{viewed, length} : std::string_view{flat};
+  }
+
+  inline std::size_t size() const { return length; }
+  inline bool isRope() const { return left != nullptr; }
+  inline bool isInterned() const { return interner != nullptr; }
+
+  /**
+   * @brief get the hash of the text, it is cached
+   *
+   */
+  inline std::size_t hash() const {
+    if (!hashed) {
+      hashValue = std::hash<std::string_view>{}(value());
+      hashed = true;
+    }
+    return hashValue;
+  }
+
+  /**
+   * @brief whether the texts are equal. The same object is equal, the
+   * strings interned by the same interner are distinct, and the texts
+   * are only compared when the lengths and the cached hashes agree.
+   *
+   */
+  bool equals(const String *other) const;
+
+  void freeze() override;
   std::string inspect() override;
+  void inspect(Writer &writer) override;
 };
 
+/**
+ * @brief Builtin is a native function, the arity is checked before the
+ * function is called so the function itself does not check it.
+ *
+ */
 class Builtin : public Object {
 public:
+  static constexpr ObjectKind Kind = ObjectKind::Builtin;
+
+  // The `maxArity` of a builtin taking any number of arguments
+  static constexpr int Variadic = -1;
+
+  const char *name;
   BuiltinFunction fn;
+  int minArity;
+  int maxArity;
 
-  Builtin(BuiltinFunction f);
+  Builtin(const char *n, BuiltinFunction f, int minArity_, int maxArity_);
+
+  /**
+   * @brief call the function, or get the error of the wrong arity
+   *
+   */
+  inline Value call(Arguments arguments) const {
+    int count = static_cast<int>(arguments.size());
+    if (count < minArity || (maxArity != Variadic && count > maxArity)) {
+      return arityError(count);
+    }
+    return fn(arguments);
+  }
 
-  ObjectType type() override;
   std::string inspect() override;
+
+private:
+  Value arityError(int count) const;
 };
 
 /**
- * @brief Array
+ * @brief Array, the elements are a persistent vector so `push` and
+ * `rest` share them with the original array.
+ *
+ * An array of integers is unboxed: the integers are stored contiguously
+ * in `integers` instead of `elements`, and they are boxed when they are
+ * read as objects. The arrays built by the literals, `push` and the
+ * numeric builtins pick it automatically, and an unboxed array is boxed
+ * once anything else is pushed to it.
  *
  */
 class Array : public Object {
 public:
-  std::vector<std::shared_ptr<Object>> elements;
+  static constexpr ObjectKind Kind = ObjectKind::Array;
 
-  Array() = default;
+  // The elements of a boxed array
+  PersistentVector elements;
 
-  ObjectType type() override;
-  std::string inspect() override;
-};
+  // The elements of an unboxed array
+  IntVector integers;
+  bool unboxed{false};
 
-/**
- * @brief Environment is used to indicate the current frame
- * environment. It is a scope and all the values associated
- * with this scope is recorded in it. When we meet a new
- * scope such as functions, we should spawn a new scope,
- * which means that we should create a new environment class.
- *
- */
-class Environment {
-private:
-  std::shared_ptr<Environment> outer;
+  Array() : Object{Kind} {}
 
-public:
-  std::unordered_map<std::string, std::shared_ptr<Object>> store{};
-  Environment() = default;
-  Environment(std::shared_ptr<Environment> o);
-  Environment(const Environment &) = delete;
-  Environment(Environment &&) = default;
+  /**
+   * @brief build the array, it is unboxed if every element is an integer
+   *
+   */
+  static Ref<Array> from(const Ref<Object> *values, std::size_t count);
+  static Ref<Array> from(const Value *values, std::size_t count);
 
   /**
-   * @brief get the binding value
+   * @brief build the unboxed array
    *
-   * @param name the identifier name
-   * @return std::shared_ptr<Object>
    */
-  std::shared_ptr<Object> get(const std::string &name);
+  static Ref<Array> from(IntVector &&integers);
+
+  inline std::size_t size() const { return unboxed ? integers.size() : elements.size(); }
+  inline bool empty() const { return size() == 0; }
 
   /**
-   * @brief bind the identifier
+   * @brief get the element as an object, an integer is boxed
    *
-   * @param name the identifier name
-   * @param val the new object value
    */
-  void set(const std::string &name, std::shared_ptr<Object> val);
+  inline Ref<Object> get(std::size_t i) const {
+    return unboxed ? Ref<Object>{Integer::of(integers[i])} : elements[i];
+  }
+
+  /**
+   * @brief get the element as a value, an integer is never boxed
+   *
+   */
+  inline Value valueAt(std::size_t i) const {
+    return unboxed ? Value::fromInteger(integers[i]) : Value{elements[i]};
+  }
+
+  /**
+   * @brief get the array without the first element, it shares the elements
+   *
+   */
+  Ref<Array> rest() const;
+
+  /**
+   * @brief get the array with the value appended, it shares the elements
+   *
+   */
+  Ref<Array> pushed(const Value &value) const;
+
+  void freeze() override;
+  void trace(Tracer &tracer) override;
+  void clearReferences() override;
+  std::string inspect() override;
+  void inspect(Writer &writer) override;
+};
+
+/**
+ * @brief Hash maps the integers, the booleans and the strings to any
+ * object.
+ *
+ */
+class Hash : public Object {
+public:
+  static constexpr ObjectKind Kind = ObjectKind::Hash;
+
+  HashTable pairs;
+
+  Hash() : Object{Kind} {}
+
+  void freeze() override;
+  void trace(Tracer &tracer) override;
+  void clearReferences() override;
+  std::string inspect() override;
+  void inspect(Writer &writer) override;
 };
 
 #endif  // _OBJECT_OBJECT_HPP_
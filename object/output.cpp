@@ -0,0 +1,30 @@
+#include "output.hpp"
+
+Output &Output::current() {
+  static thread_local Output output{};
+  return output;
+}
+
+void Output::write(std::string_view text) {
+  // A long text is written as it is instead of through the buffer
+  if (text.size() >= BlockSize) {
+    flush();
+    std::fwrite(text.data(), 1, text.size(), file);
+    std::fflush(file);
+    return;
+  }
+
+  buffer.append(text);
+  if (buffer.size() >= BlockSize) {
+    flush();
+  }
+}
+
+void Output::flush() {
+  if (buffer.empty()) {
+    return;
+  }
+  std::fwrite(buffer.data(), 1, buffer.size(), file);
+  std::fflush(file);
+  buffer.clear();
+}
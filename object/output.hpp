@@ -0,0 +1,57 @@
+#ifndef _OBJECT_OUTPUT_HPP_
+#define _OBJECT_OUTPUT_HPP_
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Output buffers what `puts` and `print` write, and writes it to
+ * the file in blocks of `BlockSize` instead of one system call per line.
+ *
+ * Each thread has its own output, it is flushed when it is full, when the
+ * thread exits, and by the REPL after each input.
+ *
+ */
+class Output {
+private:
+  std::string buffer{};
+  std::FILE *file;
+
+public:
+  static constexpr std::size_t BlockSize = 64 * 1024;
+
+  explicit Output(std::FILE *f = stdout) : file{f} { buffer.reserve(BlockSize); }
+  Output(const Output &) = delete;
+  Output &operator=(const Output &) = delete;
+  ~Output() { flush(); }
+
+  /**
+   * @brief get the output of the current thread to the standard output
+   *
+   */
+  static Output &current();
+
+  void write(std::string_view text);
+
+  /**
+   * @brief write the buffered text to the file
+   *
+   */
+  void flush();
+
+  /**
+   * @brief the text which is not written yet
+   *
+   */
+  inline std::string_view pending() const { return buffer; }
+
+  /**
+   * @brief drop the text which is not written yet, for the tests
+   *
+   */
+  inline void discard() { buffer.clear(); }
+};
+
+#endif  // _OBJECT_OUTPUT_HPP_
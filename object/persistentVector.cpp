@@ -0,0 +1,140 @@
+#include "persistentVector.hpp"
+
+#include "heap.hpp"
+#include "object.hpp"
+
+#include <utility>
+
+VectorNode::VectorNode() { Heap::current().track(this, HeapSpace::Vectors); }
+
+VectorLeaf::VectorLeaf() = default;
+VectorLeaf::~VectorLeaf() = default;
+
+void VectorLeaf::freeze() {
+  if (isImmortal()) {
+    return;
+  }
+  setImmortal();
+  for (std::size_t i = 0; i < filled; i++) {
+    if (values[i] != nullptr) {
+      values[i]->freeze();
+    }
+  }
+}
+
+void VectorLeaf::trace(Tracer &tracer) {
+  for (std::size_t i = 0; i < filled; i++) {
+    tracer.visit(values[i]);
+  }
+}
+
+void VectorLeaf::clearReferences() {
+  for (auto &&value : values) {
+    value.reset();
+  }
+}
+
+VectorBranch::VectorBranch() = default;
+VectorBranch::~VectorBranch() = default;
+
+void VectorBranch::freeze() {
+  if (isImmortal()) {
+    return;
+  }
+  setImmortal();
+  for (auto &&child : children) {
+    if (child != nullptr) {
+      child->freeze();
+    }
+  }
+}
+
+void VectorBranch::trace(Tracer &tracer) {
+  for (auto &&child : children) {
+    tracer.visit(child);
+  }
+}
+
+void VectorBranch::clearReferences() {
+  for (auto &&child : children) {
+    child.reset();
+  }
+}
+
+void PersistentVector::push_back(Ref<Object> value) {
+  std::size_t tailSize = count - tailOffset();
+
+  if (tail != nullptr && tailSize < VectorNode::Width) {
+    if (tail->filled != tailSize || tail->isImmortal()) {
+      // Another vector has appended to the tail, or it is shared by
+      // the threads, copy the part of it which is ours.
+      auto leaf = makeRef<VectorLeaf>();
+      for (std::size_t i = 0; i < tailSize; i++) {
+        leaf->values[i] = tail->values[i];
+      }
+      leaf->filled = static_cast<uint32_t>(tailSize);
+      tail = std::move(leaf);
+    }
+    tail->values[tailSize] = std::move(value);
+    tail->filled++;
+    count++;
+    return;
+  }
+
+  if (tail != nullptr) {
+    // The tail is full, move it into the trie
+    if ((count >> VectorNode::Bits) > (std::size_t{1} << shift)) {
+      auto branch = makeRef<VectorBranch>();
+      branch->children[0] = std::move(root);
+      shift += VectorNode::Bits;
+      root = pushTail(shift, branch.get(), std::move(tail));
+    } else {
+      root = pushTail(shift, static_cast<VectorBranch *>(root.get()), std::move(tail));
+    }
+  }
+
+  tail = makeRef<VectorLeaf>();
+  tail->values[0] = std::move(value);
+  tail->filled = 1;
+  count++;
+}
+
+Ref<VectorBranch> PersistentVector::pushTail(std::size_t level, VectorBranch *parent, Ref<VectorLeaf> leaf) {
+  auto branch = makeRef<VectorBranch>();
+  if (parent != nullptr) {
+    branch->children = parent->children;
+  }
+
+  std::size_t index = ((count - 1) >> level) & VectorNode::Mask;
+  if (level == VectorNode::Bits) {
+    branch->children[index] = std::move(leaf);
+  } else {
+    auto *child = static_cast<VectorBranch *>(branch->children[index].get());
+    branch->children[index] = pushTail(level - VectorNode::Bits, child, std::move(leaf));
+  }
+  return branch;
+}
+
+PersistentVector PersistentVector::rest() const {
+  PersistentVector result{*this};
+  if (!result.empty()) {
+    result.start++;
+  }
+  return result;
+}
+
+void PersistentVector::clear() { *this = PersistentVector{}; }
+
+void PersistentVector::freeze() {
+  if (root != nullptr) {
+    root->freeze();
+  }
+  if (tail != nullptr) {
+    tail->freeze();
+  }
+}
+
+void PersistentVector::trace(Tracer &tracer) const {
+  tracer.visit(root);
+  tracer.visit(tail);
+}
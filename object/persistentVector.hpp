@@ -0,0 +1,190 @@
+#ifndef _OBJECT_PERSISTENT_VECTOR_HPP_
+#define _OBJECT_PERSISTENT_VECTOR_HPP_
+
+#include "ref.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+class Object;
+
+/**
+ * @brief The node of the trie of `PersistentVector`. The nodes are
+ * shared by the vectors, so they are tracked by the heap like the other
+ * containers, an element is referenced once by the leaf holding it no
+ * matter how many vectors share the leaf.
+ *
+ */
+class VectorNode : public RefCounted {
+public:
+  static constexpr std::size_t Bits = 5;
+  static constexpr std::size_t Width = 1 << Bits;
+  static constexpr std::size_t Mask = Width - 1;
+
+  VectorNode();
+
+  /**
+   * @brief make the node and everything under it immortal
+   *
+   */
+  virtual void freeze() = 0;
+};
+
+/**
+ * @brief The leaf holding the elements.
+ *
+ */
+class VectorLeaf : public VectorNode {
+public:
+  std::array<Ref<Object>, Width> values;
+
+  // The slots written so far, every vector sharing the leaf sees a
+  // prefix of them. The vector which ends at `filled` may append in
+  // place, the others copy the leaf first.
+  uint32_t filled{0};
+
+  VectorLeaf();
+  ~VectorLeaf() override;
+
+  void freeze() override;
+  void trace(Tracer &tracer) override;
+  void clearReferences() override;
+};
+
+/**
+ * @brief The inner node, it is never changed once built.
+ *
+ */
+class VectorBranch : public VectorNode {
+public:
+  std::array<Ref<VectorNode>, Width> children;
+
+  VectorBranch();
+  ~VectorBranch() override;
+
+  void freeze() override;
+  void trace(Tracer &tracer) override;
+  void clearReferences() override;
+};
+
+/**
+ * @brief PersistentVector is the immutable list behind `Array`, a 32-way
+ * trie with a tail buffer. Copying it is O(1) and the copies share the
+ * nodes, so appending to a copy never touches the original.
+ *
+ * + `push_back` writes into the tail in place when no other vector has
+ *   appended to it, a full tail is moved into the trie.
+ * + `rest` is a view which skips the first element.
+ * + indexing walks the trie, O(log32 n).
+ *
+ */
+class PersistentVector {
+private:
+  Ref<VectorNode> root{};
+  Ref<VectorLeaf> tail{};
+
+  // The elements in the trie and the tail, including the ones skipped
+  std::size_t count{0};
+  // The first element of the view
+  std::size_t start{0};
+  // The level of the root
+  std::size_t shift{VectorNode::Bits};
+
+  inline std::size_t tailOffset() const {
+    return count < VectorNode::Width ? 0 : ((count - 1) >> VectorNode::Bits) << VectorNode::Bits;
+  }
+
+  /**
+   * @brief the leaf holding the element at the absolute index
+   *
+   */
+  inline VectorLeaf *leafFor(std::size_t i) const {
+    if (i >= tailOffset()) {
+      return tail.get();
+    }
+
+    VectorNode *node = root.get();
+    for (std::size_t level = shift; level > 0; level -= VectorNode::Bits) {
+      node = static_cast<VectorBranch *>(node)->children[(i >> level) & VectorNode::Mask].get();
+    }
+    return static_cast<VectorLeaf *>(node);
+  }
+
+  /**
+   * @brief copy the path to the last leaf of the trie and put the tail there
+   *
+   */
+  Ref<VectorBranch> pushTail(std::size_t level, VectorBranch *parent, Ref<VectorLeaf> leaf);
+
+public:
+  class Iterator {
+  private:
+    const PersistentVector *vector;
+    std::size_t index;
+
+  public:
+    Iterator(const PersistentVector *v, std::size_t i) : vector{v}, index{i} {}
+
+    inline const Ref<Object> &operator*() const { return (*vector)[index]; }
+    inline Iterator &operator++() {
+      index++;
+      return *this;
+    }
+    inline bool operator!=(const Iterator &other) const { return index != other.index; }
+  };
+
+  inline std::size_t size() const { return count - start; }
+  inline bool empty() const { return count == start; }
+
+  inline const Ref<Object> &operator[](std::size_t i) const {
+    std::size_t index = start + i;
+    return leafFor(index)->values[index & VectorNode::Mask];
+  }
+
+  inline const Ref<Object> &front() const { return (*this)[0]; }
+  inline const Ref<Object> &back() const { return (*this)[size() - 1]; }
+
+  inline Iterator begin() const { return Iterator{this, 0}; }
+  inline Iterator end() const { return Iterator{this, size()}; }
+
+  /**
+   * @brief append the element, the copies of this vector are unchanged
+   *
+   */
+  void push_back(Ref<Object> value);
+
+  /**
+   * @brief append the elements of the range
+   *
+   */
+  template <typename It>
+  void assign(It first, It last) {
+    clear();
+    for (; first != last; ++first) {
+      push_back(*first);
+    }
+  }
+
+  /**
+   * @brief get the view without the first element
+   *
+   */
+  PersistentVector rest() const;
+
+  void clear();
+
+  /**
+   * @brief make the nodes and the elements immortal
+   *
+   */
+  void freeze();
+
+  /**
+   * @brief visit the nodes referenced by the vector
+   *
+   */
+  void trace(Tracer &tracer) const;
+};
+
+#endif  // _OBJECT_PERSISTENT_VECTOR_HPP_
@@ -0,0 +1,232 @@
+#ifndef _OBJECT_REF_HPP_
+#define _OBJECT_REF_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+class Heap;
+class Tracer;
+
+/**
+ * @brief RefCounted is the header of the runtime objects which holds the
+ * intrusive reference count. A VM or an evaluator only runs on one thread,
+ * so the count is a plain integer instead of an atomic one.
+ *
+ * An immortal object is never counted nor destroyed. The shared objects
+ * such as the small integers, the booleans and the builtins are immortal,
+ * and an object is made immortal by freezing it before it is handed to
+ * another thread.
+ *
+ * The reference count alone never frees a cycle, so the objects which
+ * could reference others are also tracked by the `Heap`, the tracing
+ * collector reclaims the cycles among them.
+ *
+ */
+class RefCounted {
+public:
+  static constexpr uint8_t Untracked = 0xff;
+
+private:
+  uint32_t refCount{0};
+
+  // The slot in the space of the heap, valid when the object is tracked
+  uint32_t heapIndex{0};
+
+  // The references from outside the heap, only valid during a collection
+  uint32_t gcRefs{0};
+
+  bool immortal{false};
+  bool marked{false};
+  uint8_t space{Untracked};
+
+  // Whether the object has survived a collection
+  bool old{false};
+
+  template <typename T>
+  friend class Ref;
+  friend class Value;
+  friend class Heap;
+
+  inline void retain() {
+    if (!immortal) {
+      refCount++;
+    }
+  }
+
+  inline void release() {
+    if (!immortal && --refCount == 0) {
+      delete this;
+    }
+  }
+
+public:
+  RefCounted() = default;
+  RefCounted(const RefCounted &) = delete;
+  RefCounted &operator=(const RefCounted &) = delete;
+  virtual ~RefCounted();
+
+  /**
+   * @brief the objects are allocated from the `Nursery` of the thread,
+   * they are only aligned to `MaxAlignment`
+   *
+   */
+  static void *operator new(std::size_t size);
+  static void operator delete(void *p);
+
+  // The word before each object in the nursery leaves it aligned to 8
+  // bytes, half of `alignof(std::max_align_t)`
+  static constexpr std::size_t MaxAlignment = sizeof(void *);
+
+  inline bool isImmortal() const { return immortal; }
+  inline bool isTracked() const { return space != Untracked; }
+  inline bool isOld() const { return old; }
+  inline uint32_t getRefCount() const { return refCount; }
+
+  /**
+   * @brief visit every object referenced by this one, the tracked
+   * objects must override it.
+   *
+   */
+  virtual void trace(Tracer &) {}
+
+  /**
+   * @brief drop every reference held by this one, the collector calls
+   * it to break a garbage cycle before freeing it.
+   *
+   */
+  virtual void clearReferences() {}
+
+protected:
+  /**
+   * @brief never count nor free the object again, it leaves the heap
+   *
+   */
+  void setImmortal();
+};
+
+/**
+ * @brief Ref is the smart pointer of the runtime objects. It is a single
+ * pointer, and copying it is a non-atomic increment.
+ *
+ */
+template <typename T>
+class Ref {
+private:
+  T *ptr{nullptr};
+
+  template <typename U>
+  friend class Ref;
+
+  inline void retain() {
+    if (ptr != nullptr) {
+      static_cast<RefCounted *>(ptr)->retain();
+    }
+  }
+
+  inline void release() {
+    if (ptr != nullptr) {
+      static_cast<RefCounted *>(ptr)->release();
+    }
+  }
+
+public:
+  Ref() = default;
+  Ref(std::nullptr_t) {}
+  explicit Ref(T *p) : ptr{p} { retain(); }
+  Ref(const Ref &r) : ptr{r.ptr} { retain(); }
+  Ref(Ref &&r) noexcept : ptr{r.ptr} { r.ptr = nullptr; }
+
+  template <typename U, typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+  Ref(const Ref<U> &r) : ptr{r.ptr} {
+    retain();
+  }
+
+  template <typename U, typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+  Ref(Ref<U> &&r) noexcept : ptr{r.ptr} {
+    r.ptr = nullptr;
+  }
+
+  ~Ref() { release(); }
+
+  Ref &operator=(Ref r) noexcept {
+    std::swap(ptr, r.ptr);
+    return *this;
+  }
+
+  inline T *get() const { return ptr; }
+  inline T *operator->() const { return ptr; }
+  inline T &operator*() const { return *ptr; }
+  inline explicit operator bool() const { return ptr != nullptr; }
+
+  inline void reset() { Ref{}.swap(*this); }
+  inline void swap(Ref &r) noexcept { std::swap(ptr, r.ptr); }
+
+  /**
+   * @brief cast to the derived class without checking
+   *
+   */
+  template <typename U>
+  inline Ref<U> cast() const {
+    return Ref<U>{static_cast<U *>(ptr)};
+  }
+};
+
+template <typename T, typename U>
+inline bool operator==(const Ref<T> &a, const Ref<U> &b) {
+  return a.get() == b.get();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const Ref<T> &a, const Ref<U> &b) {
+  return a.get() != b.get();
+}
+
+template <typename T>
+inline bool operator==(const Ref<T> &a, std::nullptr_t) {
+  return a.get() == nullptr;
+}
+
+template <typename T>
+inline bool operator!=(const Ref<T> &a, std::nullptr_t) {
+  return a.get() != nullptr;
+}
+
+template <typename T>
+inline bool operator==(std::nullptr_t, const Ref<T> &a) {
+  return a.get() == nullptr;
+}
+
+template <typename T>
+inline bool operator!=(std::nullptr_t, const Ref<T> &a) {
+  return a.get() != nullptr;
+}
+
+/**
+ * @brief Tracer is called by `RefCounted::trace` for each reference.
+ *
+ */
+class Tracer {
+public:
+  virtual void visit(RefCounted *object) = 0;
+
+  template <typename T>
+  inline void visit(const Ref<T> &ref) {
+    visit(static_cast<RefCounted *>(ref.get()));
+  }
+
+  virtual ~Tracer() = default;
+};
+
+/**
+ * @brief allocate the object and return the first reference
+ *
+ */
+template <typename T, typename... Args>
+inline Ref<T> makeRef(Args &&...args) {
+  static_assert(alignof(T) <= RefCounted::MaxAlignment, "the runtime objects could not be over-aligned");
+  return Ref<T>{new T(std::forward<Args>(args)...)};
+}
+
+#endif  // _OBJECT_REF_HPP_
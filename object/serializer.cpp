@@ -0,0 +1,501 @@
+#include "serializer.hpp"
+
+#include "builtins.hpp"
+#include "interner.hpp"
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief the tags of the values, the numbers are a part of the format,
+ * append the new ones and bump the version when one changes.
+ *
+ */
+enum class SerialTag : uint8_t {
+  Null = 0,
+  Integer = 1,
+  Float = 2,
+  True = 3,
+  False = 4,
+  Reference = 5,
+  String = 6,
+  Array = 7,
+  Integers = 8,
+  Hash = 9,
+  // 10 and 11 were the compiled functions and the closures
+  Builtin = 12,
+};
+
+static constexpr char Magic[] = {'M', 'K', 'Y'};
+static constexpr std::size_t HeaderSize = sizeof(Magic) + 1;
+
+// The integers of an unboxed array are copied at once on these machines
+static constexpr bool LittleEndian = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+static inline uint64_t zigzag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/**
+ * @brief Encoder writes the bytes of a value into one buffer
+ *
+ */
+class Encoder {
+private:
+  std::string out{};
+  std::string reason{};
+
+  // The numbers of the objects written so far
+  std::unordered_map<const Object *, uint64_t> ids{};
+
+  bool fail(const std::string &why) {
+    reason = why;
+    return false;
+  }
+
+  inline void tag(SerialTag t) { out += static_cast<char>(t); }
+
+  void varint(uint64_t value) {
+    while (value >= 0x80) {
+      out += static_cast<char>((value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+    out += static_cast<char>(value);
+  }
+
+  void fixed(uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+      out += static_cast<char>(value >> (8 * i));
+    }
+  }
+
+  void text(std::string_view text) {
+    varint(text.size());
+    out.append(text);
+  }
+
+  /**
+   * @brief write the number of the object if it is written already,
+   * number it otherwise
+   *
+   */
+  bool written(const Object *object) {
+    auto [it, inserted] = ids.try_emplace(object, ids.size());
+    if (inserted) {
+      return false;
+    }
+    tag(SerialTag::Reference);
+    varint(it->second);
+    return true;
+  }
+
+  void integers(const Array *array);
+  bool container(Object *object, int depth);
+
+public:
+  Encoder() {
+    out.reserve(256);
+    out.append(Magic, sizeof(Magic));
+    out += static_cast<char>(Serializer::Version);
+  }
+
+  bool write(const Value &value, int depth);
+
+  inline std::string &bytes() { return out; }
+  inline Value error() const { return makeRef<Error>("could not serialize: " + reason); }
+};
+
+bool Encoder::write(const Value &value, int depth) {
+  if (value.isNull()) {
+    tag(SerialTag::Null);
+  } else if (value.isInteger()) {
+    tag(SerialTag::Integer);
+    varint(zigzag(value.getInteger()));
+  } else if (value.isFloat()) {
+    double number = value.getFloat();
+    uint64_t bits{};
+    std::memcpy(&bits, &number, sizeof(bits));
+    tag(SerialTag::Float);
+    fixed(bits);
+  } else if (value.isBoolean()) {
+    tag(value.getBoolean() ? SerialTag::True : SerialTag::False);
+  } else if (value.is<Builtin>()) {
+    // The builtins are the same in every program
+    tag(SerialTag::Builtin);
+    text(value.as<Builtin>()->name);
+  } else if (value.is<String>()) {
+    if (!written(value.getObject())) {
+      tag(SerialTag::String);
+      text(value.as<String>()->value());
+    }
+  } else if (value.is<Array>() || value.is<Hash>()) {
+    if (!written(value.getObject())) {
+      return container(value.getObject(), depth);
+    }
+  } else {
+    return fail(value.type());
+  }
+  return true;
+}
+
+void Encoder::integers(const Array *array) {
+  std::size_t count = array->size();
+  tag(SerialTag::Integers);
+  varint(count);
+  if (LittleEndian && count > 0) {
+    std::size_t offset = out.size();
+    out.resize(offset + count * sizeof(int64_t));
+    std::memcpy(out.data() + offset, array->integers.data(), count * sizeof(int64_t));
+    return;
+  }
+  for (auto &&integer : array->integers) {
+    fixed(static_cast<uint64_t>(integer));
+  }
+}
+
+bool Encoder::container(Object *object, int depth) {
+  if (depth >= Serializer::MaxDepth) {
+    return fail("too deeply nested");
+  }
+
+  if (object->is<Array>()) {
+    auto array = object->as<Array>();
+    if (array->unboxed) {
+      integers(array);
+      return true;
+    }
+
+    tag(SerialTag::Array);
+    varint(array->size());
+    for (std::size_t i = 0; i < array->size(); i++) {
+      if (!write(array->valueAt(i), depth + 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  auto hash = object->as<Hash>();
+  tag(SerialTag::Hash);
+  varint(hash->pairs.size());
+  for (auto &&pair : hash->pairs.entries()) {
+    if (!write(Value{pair.key}, depth + 1) || !write(Value{pair.value}, depth + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Decoder reads a value from the bytes, it checks every length
+ * against the bytes left, so the bytes could come from anywhere.
+ *
+ */
+class Decoder {
+private:
+  std::string_view input;
+  std::size_t offset{HeaderSize};
+
+  // The file the bytes view, the long strings view it too
+  Ref<MappedFile> file;
+
+  // The objects by their numbers, null while the container is read, the
+  // values are immutable so they could not contain themselves
+  std::vector<Value> objects{};
+
+  std::string reason{};
+
+  bool fail(const std::string &why) {
+    reason = why;
+    return false;
+  }
+
+  bool byte(uint8_t &out) {
+    if (offset >= input.size()) {
+      return fail("unexpected end");
+    }
+    out = static_cast<uint8_t>(input[offset++]);
+    return true;
+  }
+
+  bool varint(uint64_t &out) {
+    out = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t b{};
+      if (!byte(b)) {
+        return false;
+      }
+      out |= static_cast<uint64_t>(b & 0x7f) << shift;
+      if ((b & 0x80) == 0) {
+        return true;
+      }
+    }
+    return fail("invalid varint");
+  }
+
+  bool fixed(uint64_t &out) {
+    if (input.size() - offset < 8) {
+      return fail("unexpected end");
+    }
+    out = 0;
+    for (int i = 0; i < 8; i++) {
+      out |= static_cast<uint64_t>(static_cast<uint8_t>(input[offset + i])) << (8 * i);
+    }
+    offset += 8;
+    return true;
+  }
+
+  /**
+   * @brief read a count of the items taking at least `unit` bytes each
+   *
+   */
+  bool count(std::size_t &out, std::size_t unit) {
+    uint64_t n{};
+    if (!varint(n)) {
+      return false;
+    }
+    if (n > (input.size() - offset) / unit) {
+      return fail("unexpected end");
+    }
+    out = static_cast<std::size_t>(n);
+    return true;
+  }
+
+  bool text(std::string_view &out) {
+    std::size_t length{};
+    if (!count(length, 1)) {
+      return false;
+    }
+    out = input.substr(offset, length);
+    offset += length;
+    return true;
+  }
+
+  bool header();
+  bool value(Value &out, int depth);
+  bool string(Value &out);
+  bool integers(Value &out);
+  bool array(Value &out, int depth);
+  bool hash(Value &out, int depth);
+
+public:
+  Decoder(std::string_view i, Ref<MappedFile> f) : input{i}, file{std::move(f)} {}
+
+  /**
+   * @brief read the header and the value, the bytes must end after it
+   *
+   * @return Value the value, or the `Error` with the offset
+   */
+  Value read();
+};
+
+Value Decoder::read() {
+  Value result{};
+  if (header() && value(result, 0)) {
+    if (offset == input.size()) {
+      return result;
+    }
+    fail("unexpected bytes after the value");
+  }
+  return makeRef<Error>("invalid serialized value at offset " + std::to_string(offset) + ": " + reason);
+}
+
+bool Decoder::header() {
+  if (input.size() < HeaderSize || input.substr(0, sizeof(Magic)) != std::string_view{Magic, sizeof(Magic)}) {
+    offset = 0;
+    return fail("not a serialized value");
+  }
+  auto version = static_cast<uint8_t>(input[sizeof(Magic)]);
+  if (version != Serializer::Version) {
+    offset = sizeof(Magic);
+    return fail("unsupported version " + std::to_string(version));
+  }
+  return true;
+}
+
+bool Decoder::value(Value &out, int depth) {
+  uint8_t t{};
+  if (!byte(t)) {
+    return false;
+  }
+
+  switch (static_cast<SerialTag>(t)) {
+    case SerialTag::Null:
+      out = nullptr;
+      return true;
+    case SerialTag::Integer: {
+      uint64_t n{};
+      if (!varint(n)) {
+        return false;
+      }
+      out = Value::fromInteger(unzigzag(n));
+      return true;
+    }
+    case SerialTag::Float: {
+      uint64_t bits{};
+      if (!fixed(bits)) {
+        return false;
+      }
+      double number{};
+      std::memcpy(&number, &bits, sizeof(number));
+      out = Value::fromFloat(number);
+      return true;
+    }
+    case SerialTag::True:
+    case SerialTag::False:
+      out = Value::fromBoolean(static_cast<SerialTag>(t) == SerialTag::True);
+      return true;
+    case SerialTag::Reference: {
+      uint64_t id{};
+      if (!varint(id)) {
+        return false;
+      }
+      if (id >= objects.size()) {
+        return fail("unknown reference " + std::to_string(id));
+      }
+      if (objects[id].isNull()) {
+        return fail("cyclic reference " + std::to_string(id));
+      }
+      out = objects[id];
+      return true;
+    }
+    case SerialTag::Builtin: {
+      std::string_view name{};
+      if (!text(name)) {
+        return false;
+      }
+      auto builtin = Builtins::lookup(std::string{name});
+      if (builtin == nullptr) {
+        return fail("unknown builtin " + std::string{name});
+      }
+      out = std::move(builtin);
+      return true;
+    }
+    case SerialTag::String:
+      return string(out);
+    case SerialTag::Integers:
+      return integers(out);
+    case SerialTag::Array:
+    case SerialTag::Hash:
+      if (depth >= Serializer::MaxDepth) {
+        return fail("too deeply nested");
+      }
+      return static_cast<SerialTag>(t) == SerialTag::Array ? array(out, depth + 1) : hash(out, depth + 1);
+  }
+
+  offset--;
+  return fail("unknown tag " + std::to_string(t));
+}
+
+bool Decoder::string(Value &out) {
+  std::string_view s{};
+  if (!text(s)) {
+    return false;
+  }
+
+  if (s.size() <= Interner::MaxLength) {
+    out = Interner::current().intern(s);
+  } else if (file != nullptr) {
+    out = String::view(file, s);
+  } else {
+    out = makeRef<String>(std::string{s});
+  }
+  objects.push_back(out);
+  return true;
+}
+
+bool Decoder::integers(Value &out) {
+  std::size_t n{};
+  if (!count(n, sizeof(int64_t))) {
+    return false;
+  }
+
+  IntVector integers{};
+  int64_t *data = integers.resize(n);
+  if (LittleEndian && n > 0) {
+    std::memcpy(data, input.data() + offset, n * sizeof(int64_t));
+    offset += n * sizeof(int64_t);
+  } else {
+    for (std::size_t i = 0; i < n; i++) {
+      uint64_t integer{};
+      fixed(integer);
+      data[i] = static_cast<int64_t>(integer);
+    }
+  }
+
+  out = Array::from(std::move(integers));
+  objects.push_back(out);
+  return true;
+}
+
+bool Decoder::array(Value &out, int depth) {
+  // The array is numbered before its elements, as it is written
+  std::size_t id = objects.size();
+  objects.emplace_back();
+
+  std::size_t n{};
+  if (!count(n, 1)) {
+    return false;
+  }
+  auto array = makeRef<Array>();
+  for (std::size_t i = 0; i < n; i++) {
+    Value element{};
+    if (!value(element, depth)) {
+      return false;
+    }
+    array->elements.push_back(element.toObject());
+  }
+
+  objects[id] = array;
+  out = std::move(array);
+  return true;
+}
+
+bool Decoder::hash(Value &out, int depth) {
+  std::size_t id = objects.size();
+  objects.emplace_back();
+
+  std::size_t n{};
+  if (!count(n, 2)) {
+    return false;
+  }
+  auto hash = makeRef<Hash>();
+  hash->pairs.reserve(n);
+  for (std::size_t i = 0; i < n; i++) {
+    Value key{}, element{};
+    if (!value(key, depth)) {
+      return false;
+    }
+    auto boxed = key.toObject();
+    if (!HashTable::hashable(boxed.get())) {
+      return fail("unusable as hash key: " + key.type());
+    }
+    if (!value(element, depth)) {
+      return false;
+    }
+    hash->pairs.set(std::move(boxed), element.toObject());
+  }
+
+  objects[id] = hash;
+  out = std::move(hash);
+  return true;
+}
+
+Value Serializer::serialize(const Value &value) {
+  Encoder encoder{};
+  if (!encoder.write(value, 0)) {
+    return encoder.error();
+  }
+  return makeRef<String>(std::move(encoder.bytes()));
+}
+
+Value Serializer::deserialize(const String *bytes) { return Decoder{bytes->value(), bytes->mapping()}.read(); }
+
+Value Serializer::deserialize(std::string_view bytes) { return Decoder{bytes, nullptr}.read(); }
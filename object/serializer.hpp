@@ -0,0 +1,53 @@
+#ifndef _OBJECT_SERIALIZER_HPP_
+#define _OBJECT_SERIALIZER_HPP_
+
+#include "object.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Serializer converts between the values and a compact binary
+ * format, to cache them in a file or to pass them to another process.
+ *
+ * The bytes begin with the magic `MKY` and the version. Each value is a
+ * tag, the integers and the lengths are varints, the floats are 8 bytes,
+ * and an array of integers only is its count followed by the integers as
+ * 8 bytes each, so it is read back with one copy. The strings, the
+ * arrays and the hashes are numbered in the order they are written, an
+ * object which is written again is only its number, so the sharing is kept.
+ * The values are immutable, a container referring to itself is rejected.
+ *
+ * The builtins are written by name. The other functions refer to the
+ * constants and the globals of the program they come from, so they could
+ * not be serialized, nor could the iterators and the errors.
+ *
+ */
+class Serializer {
+public:
+  static constexpr uint8_t Version = 1;
+
+  // The containers nested deeper are rejected, in both directions
+  static constexpr int MaxDepth = 1024;
+
+  /**
+   * @brief get the bytes of the value
+   *
+   * @return Value the string of the bytes, or the `Error` if the value
+   * could not be serialized
+   */
+  static Value serialize(const Value &value);
+
+  /**
+   * @brief read the value back. The long strings of the bytes viewing a
+   * mapped file, such as the result of `readFile`, view the same file
+   * instead of being copied.
+   *
+   * @return Value the value, or the `Error` with the offset
+   */
+  static Value deserialize(const String *bytes);
+  static Value deserialize(std::string_view bytes);
+};
+
+#endif  // _OBJECT_SERIALIZER_HPP_
@@ -0,0 +1,72 @@
+#include "sort.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+void Sort::integers(int64_t *values, std::size_t count) { std::sort(values, values + count); }
+
+void Sort::numbers(Value *values, std::size_t count) {
+  // 1 and 1.0 are equal but tell apart, keep their order
+  std::stable_sort(values, values + count, [](const Value &a, const Value &b) {
+    double x = a.getNumber(), y = b.getNumber();
+    return x < y || (std::isnan(y) && !std::isnan(x));
+  });
+}
+
+void Sort::strings(Value *values, std::size_t count) {
+  // Flatten the ropes once, not per comparison
+  for (std::size_t i = 0; i < count; i++) {
+    values[i].as<String>()->value();
+  }
+  std::sort(values, values + count,
+            [](const Value &a, const Value &b) { return a.as<String>()->value() < b.as<String>()->value(); });
+}
+
+/**
+ * @brief whether `a` goes before `b`, `error` is set when the comparator
+ * fails
+ *
+ */
+static bool before(const Value &a, const Value &b, Caller *caller, const Value &cmp, Value &error) {
+  Value pair[2] = {a, b};
+  Value result = caller->call(cmp, pair, 2);
+  if (result.is<Error>()) {
+    error = std::move(result);
+    return false;
+  }
+  return result.isInteger() ? result.getInteger() < 0 : result.isTruthy();
+}
+
+Value Sort::by(Value *values, std::size_t count, Caller *caller, const Value &cmp) {
+  std::vector<Value> buffer(count);
+  Value *from = values, *to = buffer.data();
+  Value error{};
+
+  // Merge the runs of `width` bottom up, an element of the right run only
+  // goes first when it is strictly before, so the sort is stable
+  for (std::size_t width = 1; width < count; width *= 2) {
+    for (std::size_t lo = 0; lo < count; lo += 2 * width) {
+      std::size_t mid = std::min(lo + width, count), hi = std::min(lo + 2 * width, count);
+      std::size_t i = lo, j = mid, k = lo;
+      while (i < mid && j < hi) {
+        if (before(from[j], from[i], caller, cmp, error)) {
+          to[k++] = std::move(from[j++]);
+        } else if (!error.isNull()) {
+          return error;
+        } else {
+          to[k++] = std::move(from[i++]);
+        }
+      }
+      std::move(from + i, from + mid, to + k);
+      std::move(from + j, from + hi, to + k + (mid - i));
+    }
+    std::swap(from, to);
+  }
+
+  if (from != values) {
+    std::move(from, from + count, values);
+  }
+  return nullptr;
+}
@@ -0,0 +1,45 @@
+#ifndef _OBJECT_SORT_HPP_
+#define _OBJECT_SORT_HPP_
+
+#include "object.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Sort holds the sorts behind the `sort` builtin.
+ *
+ * The arrays of integers, of numbers and of strings are sorted natively
+ * by their keys with the introsort of the standard library. An array
+ * sorted by a Monkey comparator is merge sorted instead: it is stable,
+ * it needs fewer comparisons, each of which calls back into the VM or the
+ * evaluator, and it stays in bounds whatever the comparator returns.
+ *
+ */
+class Sort {
+public:
+  static void integers(int64_t *values, std::size_t count);
+
+  /**
+   * @brief sort the integers and the floats by their value, NaN goes last
+   *
+   */
+  static void numbers(Value *values, std::size_t count);
+
+  /**
+   * @brief sort the strings by their bytes
+   *
+   */
+  static void strings(Value *values, std::size_t count);
+
+  /**
+   * @brief merge sort by the comparator, `cmp(a, b)` is true or negative
+   * when `a` goes before `b`
+   *
+   * @return Value the `Error` of the comparator, or null. The values are
+   * left unspecified when it fails.
+   */
+  static Value by(Value *values, std::size_t count, Caller *caller, const Value &cmp);
+};
+
+#endif  // _OBJECT_SORT_HPP_
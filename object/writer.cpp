@@ -0,0 +1,46 @@
+#include "writer.hpp"
+
+#include "output.hpp"
+
+void Writer::writeSlow(std::string_view text) {
+  if (truncated) {
+    return;
+  }
+
+  bool sink = stream != nullptr || output != nullptr;
+  if (text.size() > maxLength - length) {
+    text = text.substr(0, maxLength - length);
+    buffer.append(text);
+    buffer.append("...");
+    truncated = true;
+  } else if (sink && text.size() >= BlockSize) {
+    // A long text, such as a big string, is not copied into the buffer
+    flush();
+    length += text.size();
+    send(text);
+    return;
+  } else {
+    buffer.append(text);
+  }
+  length += text.size();
+
+  if (sink && buffer.size() >= BlockSize) {
+    flush();
+  }
+}
+
+void Writer::send(std::string_view text) {
+  if (stream != nullptr) {
+    stream->write(text.data(), static_cast<std::streamsize>(text.size()));
+  } else {
+    output->write(text);
+  }
+}
+
+void Writer::flush() {
+  if ((stream == nullptr && output == nullptr) || buffer.empty()) {
+    return;
+  }
+  send(buffer);
+  buffer.clear();
+}
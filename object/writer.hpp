@@ -0,0 +1,110 @@
+#ifndef _OBJECT_WRITER_HPP_
+#define _OBJECT_WRITER_HPP_
+
+#include <cstddef>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+class Output;
+
+/**
+ * @brief Writer is where `inspect` writes the text of an object. The
+ * containers append their elements to one buffer instead of building
+ * and copying the string of each element, so printing is linear in the
+ * size of the text.
+ *
+ * The text is complete by default, it could be limited: past
+ * `maxLength` characters it ends with "..." and the containers stop
+ * visiting their elements, and the containers nested deeper than
+ * `maxDepth` are written as "[...]" or "{...}", which also bounds a
+ * cycle. With a stream or an `Output`, the buffer is written to it in
+ * blocks of `BlockSize`.
+ *
+ */
+class Writer {
+private:
+  std::string buffer{};
+  std::ostream *stream{nullptr};
+  Output *output{nullptr};
+
+  std::size_t maxLength;
+  int maxDepth;
+
+  // The length of the text, including what is written to the stream
+  std::size_t length{0};
+  int depth{0};
+  bool truncated{false};
+
+  void writeSlow(std::string_view text);
+
+  // Write the text to the stream or the output
+  void send(std::string_view text);
+
+public:
+  static constexpr std::size_t Unlimited = std::numeric_limits<std::size_t>::max();
+  static constexpr int UnlimitedDepth = std::numeric_limits<int>::max();
+  static constexpr std::size_t BlockSize = 64 * 1024;
+
+  explicit Writer(std::size_t maxLength_ = Unlimited, int maxDepth_ = UnlimitedDepth)
+      : maxLength{maxLength_}, maxDepth{maxDepth_} {}
+
+  explicit Writer(std::ostream &out, std::size_t maxLength_ = Unlimited, int maxDepth_ = UnlimitedDepth)
+      : stream{&out}, maxLength{maxLength_}, maxDepth{maxDepth_} {}
+
+  explicit Writer(Output &out, std::size_t maxLength_ = Unlimited, int maxDepth_ = UnlimitedDepth)
+      : output{&out}, maxLength{maxLength_}, maxDepth{maxDepth_} {}
+
+  Writer(const Writer &) = delete;
+  Writer &operator=(const Writer &) = delete;
+  ~Writer() { flush(); }
+
+  inline void write(std::string_view text) {
+    // Most of the writes fit and are buffered
+    if (text.size() <= maxLength - length && !truncated && stream == nullptr && output == nullptr) {
+      buffer.append(text);
+      length += text.size();
+    } else {
+      writeSlow(text);
+    }
+  }
+
+  inline void write(char c) { write(std::string_view{&c, 1}); }
+
+  /**
+   * @brief whether the length is reached, the rest is dropped
+   *
+   */
+  inline bool full() const { return truncated; }
+
+  /**
+   * @brief enter a container
+   *
+   * @return bool false if it is nested too deep, then write the
+   * placeholder and do not call `leave`
+   */
+  inline bool enter() {
+    if (depth >= maxDepth) {
+      return false;
+    }
+    depth++;
+    return true;
+  }
+
+  inline void leave() { depth--; }
+
+  /**
+   * @brief write the buffer to the stream or the output, if there is one
+   *
+   */
+  void flush();
+
+  /**
+   * @brief the text, when there is no stream and no output
+   *
+   */
+  inline std::string &str() { return buffer; }
+};
+
+#endif  // _OBJECT_WRITER_HPP_
@@ -49,6 +49,7 @@ Parser::Parser(Lexer *l) : lexer{l}, prefixParseFns{}, infixParseFns{} {
 
   registerPrefix(std::string(TokenTypes::IDENT), std::bind(&Parser::parseIdentifier, this));
   registerPrefix(std::string(TokenTypes::INT), std::bind(&Parser::parseIntegerLiteral, this));
+  registerPrefix(std::string(TokenTypes::FLOAT), std::bind(&Parser::parseFloatLiteral, this));
   registerPrefix(std::string(TokenTypes::BANG), std::bind(&Parser::parsePrefixExpression, this));
   registerPrefix(std::string(TokenTypes::MINUS), std::bind(&Parser::parsePrefixExpression, this));
   registerPrefix(std::string(TokenTypes::TRUE), std::bind(&Parser::parseBooleanExpression, this));
@@ -58,6 +59,7 @@ Parser::Parser(Lexer *l) : lexer{l}, prefixParseFns{}, infixParseFns{} {
   registerPrefix(std::string(TokenTypes::FUNCTION), std::bind(&Parser::parseFunctionLiteral, this));
   registerPrefix(std::string(TokenTypes::STRING), std::bind(&Parser::parseStringLiteral, this));
   registerPrefix(std::string(TokenTypes::LBRACKET), std::bind(&Parser::parseArrayLiteral, this));
+  registerPrefix(std::string(TokenTypes::LBRACE), std::bind(&Parser::parseHashLiteral, this));
 
   registerInfix(std::string(TokenTypes::PLUS), std::bind(&Parser::parseInfixExpression, this, _1));
   registerInfix(std::string(TokenTypes::MINUS), std::bind(&Parser::parseInfixExpression, this, _1));
@@ -212,6 +214,12 @@ std::unique_ptr<Expression> Parser::parseIntegerLiteral() {
   return std::move(integerLiteral);
 }
 
+std::unique_ptr<Expression> Parser::parseFloatLiteral() {
+  double value = std::strtod(currentToken.Literal.c_str(), nullptr);
+  auto floatLiteral = std::make_unique<FloatLiteral>(currentToken, value);
+  return std::move(floatLiteral);
+}
+
 std::unique_ptr<Expression> Parser::ParseGroupedExpression() {
   nextToken();
 
@@ -385,6 +393,34 @@ std::unique_ptr<IndexExpression> Parser::parseIndexExpression(std::unique_ptr<Ex
   return indexExpression;
 }
 
+std::unique_ptr<HashLiteral> Parser::parseHashLiteral() {
+  auto hash = std::make_unique<HashLiteral>(currentToken);
+
+  while (!peekTokenIs(TokenTypes::RBRACE)) {
+    nextToken();
+    auto key = parseExpression(Precedence::LOWEST);
+
+    if (!expectPeek(TokenTypes::COLON)) {
+      return nullptr;
+    }
+
+    nextToken();
+    auto value = parseExpression(Precedence::LOWEST);
+
+    hash->pairs.emplace_back(std::move(key), std::move(value));
+
+    if (!peekTokenIs(TokenTypes::RBRACE) && !expectPeek(TokenTypes::COMMA)) {
+      return nullptr;
+    }
+  }
+
+  if (!expectPeek(TokenTypes::RBRACE)) {
+    return nullptr;
+  }
+
+  return hash;
+}
+
 bool Parser::currentTokenIs(std::string_view &t) { return currentToken.Type == t; }
 
 bool Parser::peekTokenIs(std::string_view &t) { return peekToken.Type == t; }
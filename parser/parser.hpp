@@ -94,6 +94,13 @@ public:
    */
   std::unique_ptr<Expression> parseIntegerLiteral();
 
+  /**
+   * @brief This function need to be registered in the `prefixParseFns`.
+   *
+   * @return std::unique_ptr<Expression>
+   */
+  std::unique_ptr<Expression> parseFloatLiteral();
+
   /**
    * @brief This function is need to be registered in the `prefixParseFns`.
    * It is used to parse the `()`, we just need to change the next
@@ -191,6 +198,13 @@ public:
    */
   std::unique_ptr<IndexExpression> parseIndexExpression(std::unique_ptr<Expression> left);
 
+  /**
+   * @brief Parse the hash literal
+   *
+   * @return std::unique_ptr<HashLiteral>
+   */
+  std::unique_ptr<HashLiteral> parseHashLiteral();
+
   /**
    * @brief A helper function to tell whether
    * `currentToken == t`
@@ -474,6 +474,46 @@ TEST(Parser, TestIntegerLiteralExpression) {
   }
 }
 
+TEST(Parser, TestFloatLiteralExpression) {
+  std::string input{"3.25;"};
+
+  Lexer lexer{input};
+  Parser parser{&lexer};
+
+  auto program = parser.parseProgram();
+  if (!checkParseErrors(parser)) {
+    FAIL();
+  }
+
+  if (program->statements.size() != 1) {
+    spdlog::error("program has not enough statements. got='{}'", program->statements.size());
+    FAIL();
+  }
+
+  ExpressionStatement *expressionStatement = dynamic_cast<ExpressionStatement *>(program->statements[0].get());
+
+  if (expressionStatement == nullptr) {
+    spdlog::error("statement is not an ExpressionStatement");
+    FAIL();
+  }
+
+  FloatLiteral *floatLiteral = dynamic_cast<FloatLiteral *>(expressionStatement->expression.get());
+  if (floatLiteral == nullptr) {
+    spdlog::error("expression is not a FloatLiteral");
+    FAIL();
+  }
+
+  if (floatLiteral->value != 3.25) {
+    spdlog::error("floatLiteral->value not 3.25. got='{}'", floatLiteral->value);
+    FAIL();
+  }
+
+  if (floatLiteral->tokenLiteral() != "3.25") {
+    spdlog::error("floatLiteral->tokenLiteral not '3.25'. got='{}'", floatLiteral->tokenLiteral());
+    FAIL();
+  }
+}
+
 TEST(Parser, TestParsingPrefixExpressions) {
   std::vector<TestPrefixData<int>> prefixTestsForInt{
       {"!5;", "!", 5},
@@ -991,3 +1031,50 @@ TEST(Parser, TestParsingIndexExpressions) {
     FAIL();
   }
 }
+
+TEST(Parser, TestParsingHashLiterals) {
+  struct TestData {
+    std::string input;
+    std::vector<std::string> expectedPairs;
+
+    TestData(const std::string &s, const std::vector<std::string> &p) : input{s}, expectedPairs{p} {}
+  };
+
+  std::vector<TestData> tests{
+      {"{}", {}},
+      {R"({"one": 1, "two": 2, "three": 3})", {"one:1", "two:2", "three:3"}},
+      {R"({1: true, false: "no"})", {"1:true", "false:no"}},
+      {R"({"one": 0 + 1, "two": 10 - 8})", {"one:(0 + 1)", "two:(10 - 8)"}},
+  };
+
+  for (auto &&test : tests) {
+    Lexer lexer{test.input};
+    Parser parser{&lexer};
+
+    auto program = parser.parseProgram();
+    if (!checkParseErrors(parser)) {
+      FAIL();
+    }
+
+    ExpressionStatement *expressionStatement = dynamic_cast<ExpressionStatement *>(program->statements[0].get());
+    HashLiteral *hashLiteral = dynamic_cast<HashLiteral *>(expressionStatement->expression.get());
+    if (hashLiteral == nullptr) {
+      spdlog::error("expression is not HashLiteral");
+      FAIL();
+    }
+
+    if (hashLiteral->pairs.size() != test.expectedPairs.size()) {
+      spdlog::error("hash has wrong number of pairs. got={}", hashLiteral->pairs.size());
+      FAIL();
+    }
+
+    for (std::size_t i = 0; i < test.expectedPairs.size(); i++) {
+      auto &&pair = hashLiteral->pairs[i];
+      auto got = pair.first->getString() + ":" + pair.second->getString();
+      if (got != test.expectedPairs[i]) {
+        spdlog::error("wrong pair. expected={}, got={}", test.expectedPairs[i], got);
+        FAIL();
+      }
+    }
+  }
+}
@@ -4,11 +4,14 @@
 #include "evaluator.hpp"
 #include "lexer.hpp"
 #include "object.hpp"
+#include "output.hpp"
 #include "parser.hpp"
+#include "profiler.hpp"
 #include "symbolTable.hpp"
 #include "token.hpp"
 #include "vm.hpp"
 
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -17,13 +20,40 @@
 
 std::string_view PROMPT{">> "};
 
-void startInterpreter() {
+// A huge or deeply nested result is cut short
+static constexpr std::size_t MaxPrintLength = 64 * 1024;
+static constexpr int MaxPrintDepth = 64;
+
+/**
+ * @brief print the result straight to the standard output
+ *
+ */
+static void print(Object *result) {
+  {
+    Writer writer{std::cout, MaxPrintLength, MaxPrintDepth};
+    result->inspect(writer);
+  }
+  std::cout << "\n";
+}
+
+void startInterpreter(bool profile) {
   Evaluator evaluator{};
+  Profiler profiler{};
   std::string line{};
-  auto env = std::make_shared<Environment>();
+  auto env = makeRef<Environment>();
+
+  if (profile) {
+    Evaluator::setProfiler(&profiler);
+  }
+
   while (true) {
     std::cout << PROMPT;
     if (!std::getline(std::cin, line)) {
+      if (profile) {
+        Evaluator::setProfiler(nullptr);
+        std::ofstream folded{"cppmpiler.folded"};
+        profiler.writeCollapsedStacks(folded);
+      }
       return;
     }
     Lexer l{line};
@@ -37,9 +67,14 @@ void startInterpreter() {
       continue;
     }
     auto evaluated = evaluator.eval(program.get(), env);
+    Output::current().flush();
 
     if (evaluated != nullptr) {
-      std::cout << evaluated->inspect() << "\n";
+      print(evaluated.get());
+    }
+
+    if (profile) {
+      profiler.report(std::cout, 10);
     }
   }
 }
@@ -47,8 +82,8 @@ void startInterpreter() {
 void startCompiler() {
   std::string line{};
 
-  std::vector<std::shared_ptr<Object>> constants{};
-  auto globals = std::make_shared<std::vector<std::shared_ptr<Object>>>(65536);
+  std::vector<Value> constants{};
+  auto globals = std::make_shared<std::vector<Value>>(GlobalSize);
   auto symbolTable = std::make_shared<SymbolTable>();
 
   while (true) {
@@ -75,13 +110,14 @@ void startCompiler() {
     VM machine{std::move(compiler.getBytecode().constants), globals, std::move(compiler.getBytecode().instructions)};
 
     machine.run();
+    Output::current().flush();
 
     auto top = machine.lastPoppedStackElem();
 
     // There would be a situation when top is nullptr, we could evaluate
     // something useless, for example `if (1 > 2) { 10 }`.
     if (top != nullptr) {
-      std::cout << top->inspect() << "\n";
+      print(top.get());
     }
   }
 }
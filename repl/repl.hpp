@@ -4,8 +4,10 @@
 /**
  * @brief start the repl loop
  *
+ * @param profile print the profile after each input, and write the
+ * collapsed stacks to `cppmpiler.folded` at exit
  */
-void startInterpreter();
+void startInterpreter(bool profile = false);
 
 /**
  * @brief start the repl loop
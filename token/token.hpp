@@ -20,6 +20,7 @@ struct TokenTypes {
   // Identifiers + literals + Strings + Arrays
   static std::string_view IDENT;
   static std::string_view INT;
+  static std::string_view FLOAT;
   static std::string_view STRING;
   static std::string_view LBRACKET;
   static std::string_view RBRACKET;
@@ -40,6 +41,7 @@ struct TokenTypes {
   // Delimiters
   static std::string_view COMMA;
   static std::string_view SEMICOLON;
+  static std::string_view COLON;
 
   static std::string_view LPAREN;
   static std::string_view RPAREN;
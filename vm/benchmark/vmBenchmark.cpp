@@ -0,0 +1,184 @@
+#include "compiler.hpp"
+#include "heap.hpp"
+#include "lexer.hpp"
+#include "nursery.hpp"
+#include "object.hpp"
+#include "parser.hpp"
+#include "vm.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct Workload {
+  std::string name;
+  std::string input;
+};
+
+static constexpr int Rounds = 5;
+
+static std::chrono::duration<double, std::milli> run(const Workload &workload, std::string &result);
+
+/**
+ * @brief Run the workload several times, return the best time
+ *
+ */
+static std::chrono::duration<double, std::milli> run(const Workload &workload, std::string &result) {
+  Lexer lexer{workload.input};
+  Parser parser{&lexer};
+  auto program = parser.parseProgram();
+
+  std::chrono::duration<double, std::milli> best{};
+
+  for (int i = 0; i < Rounds; i++) {
+    Compiler compiler{};
+    compiler.compile(program.get());
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+
+    auto start = std::chrono::steady_clock::now();
+    vm.run();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (i == 0 || elapsed < best) {
+      best = elapsed;
+    }
+    auto top = vm.lastPoppedStackElem();
+    result = top == nullptr ? "null" : top->inspect();
+  }
+
+  return best;
+}
+
+/**
+ * @brief Run the arithmetic heavy and the allocation heavy programs on
+ * the VM, print the best time of several runs. The allocation heavy ones
+ * are also run with `malloc` instead of the nursery. It is not a test,
+ * run it by hand before and after a change of the VM.
+ *
+ */
+int main() {
+  // The compiler does not resolve a global inside its own definition,
+  // so the recursive functions receive themselves as an argument.
+  std::vector<Workload> workloads{
+      {"fib(25)", "let fib = fn(f, n) { if (n < 2) { n } else { f(f, n - 1) + f(f, n - 2) } }; fib(fib, 25);"},
+      {"scaled fib(22)",
+       "let fib = fn(f, n) { if (n < 2) { n * 100000 } else { f(f, n - 1) + f(f, n - 2) } }; fib(fib, 22);"},
+      {"float fib(22)",
+       "let fib = fn(f, n) { if (n < 2) { n * 0.5 } else { f(f, n - 1) + f(f, n - 2) * 1.5 } }; fib(fib, 22);"},
+      {"polynomial tree(16)",
+       "let p = fn(x) { x * x * 3 + x * 5 - 7 }; "
+       "let tree = fn(t, n) { if (n == 0) { p(n + 2000) } else { t(t, n - 1) - t(t, n - 1) + p(n) } }; "
+       "tree(tree, 16);"},
+      {"builtin calls(16)",
+       "let a = [1, 2, 3]; "
+       "let t = fn(t, n) { if (n == 0) { len(a) + first(a) + last(a) } else { t(t, n - 1) + t(t, n - 1) } }; "
+       "t(t, 16);"},
+      {"map and reduce(100k)",
+       "reduce(map(range(100000), fn(x) { x * 2 }), 0, fn(a, b) { a + b }) + "
+       "count(filter(range(100000), fn(x) { x / 2 * 2 == x }));"},
+      {"streaming pipeline(1M)",
+       "sum(map(filter(range(1000000), fn(x) { x / 3 * 3 == x }), fn(x) { x * 2 })) + "
+       "count(take(zip(range(1000000), range(1000000)), 500000));"},
+      {"sort of 1M",
+       "let a = collect(map(range(1000000), fn(x) { x * 7919 - x * 7919 / 1000003 * 1000003 })); "
+       "first(sort(a)) + last(sort(map(a, fn(x) { x * 0.5 })));"},
+      {"sort by comparator(100k)",
+       "let a = collect(map(range(100000), fn(x) { x * 7919 - x * 7919 / 100003 * 100003 })); "
+       "first(sort(a, fn(x, y) { x > y }));"},
+  };
+
+  // Most of the objects die right away
+  std::vector<Workload> allocations{
+      {"array building(15)",
+       "let t = fn(t, n) { if (n == 0) { [2000, 3000] } else { "
+       "let a = t(t, n - 1); let b = t(t, n - 1); rest(push([a[0] + b[1], n], n)) } }; "
+       "t(t, 15)[0];"},
+      {"string building(15)",
+       "let t = fn(t, n) { if (n == 0) { \"ab\" } else { "
+       "let a = t(t, n - 1) + \"c\"; let b = t(t, n - 1) + \"d\"; len(a + b); \"ab\" } }; "
+       "len(t(t, 15));"},
+      {"list of 1M",
+       "let build = fn(b, n, a) { if (n == 1) { push(a, len(a)) } else { b(b, n - n / 2, b(b, n / 2, a)) } }; "
+       "let drop = fn(d, n, a) { if (n == 1) { rest(a) } else { d(d, n - n / 2, d(d, n / 2, a)) } }; "
+       "let sum = fn(s, a, lo, hi) { if (hi - lo == 1) { a[lo] } else { "
+       "let mid = lo + (hi - lo) / 2; s(s, a, lo, mid) + s(s, a, mid, hi) } }; "
+       "let list = build(build, 1000000, []); sum(sum, list, 0, len(list)) + first(drop(drop, 999999, list));"},
+      {"kernels on 1M",
+       "let build = fn(b, n, a) { if (n == 1) { push(a, len(a)) } else { b(b, n - n / 2, b(b, n / 2, a)) } }; "
+       "let list = build(build, 1000000, []); let twice = add(list, list); "
+       "sum(twice) + dot(list, twice) + max(mul(list, list)) - min(list);"},
+  };
+
+  // A file of 1M lines for the I/O builtins
+  std::string path{"vmBenchmark.lines"};
+  {
+    std::ofstream file{path};
+    for (int i = 0; i < 1000000; i++) {
+      file << "line " << i << "\n";
+    }
+  }
+  workloads.push_back({"readLines of 1M", "count(filter(readLines(\"" + path + "\"), fn(l) { len(l) > 10 }));"});
+  workloads.push_back({"readFile of 1M lines", "len(readFile(\"" + path + "\"));"});
+
+  // About 20 MB of JSON records
+  std::string jsonPath{"vmBenchmark.json"};
+  {
+    std::ofstream file{jsonPath};
+    file << "[";
+    for (int i = 0; i < 200000; i++) {
+      file << (i == 0 ? "" : ",") << "{\"id\": " << i << ", \"name\": \"user \\\"" << i
+           << "\\\"\", \"score\": " << i * 0.25 << ", \"active\": " << (i % 2 == 0 ? "true" : "false")
+           << ", \"tags\": [\"a\", \"b\", \"c\"], \"bio\": \"" << std::string(20, 'x') << "\"}";
+    }
+    file << "]";
+  }
+  workloads.push_back({"jsonParse of 20MB", "len(jsonParse(readFile(\"" + jsonPath + "\")));"});
+  workloads.push_back(
+      {"jsonStringify of 20MB", "let v = jsonParse(readFile(\"" + jsonPath + "\")); len(jsonStringify(v));"});
+  workloads.push_back(
+      {"deserialize of 20MB JSON", "let v = jsonParse(readFile(\"" + jsonPath + "\")); len(deserialize(serialize(v)));"});
+  workloads.push_back({"serialize of 1M integers", "len(deserialize(serialize(collect(range(1000000)))));"});
+
+  for (auto &&workload : workloads) {
+    std::string result{};
+    auto best = run(workload, result);
+    std::cout << workload.name << ": " << best.count() << " ms (result " << result << ")\n";
+  }
+  std::remove(path.c_str());
+  std::remove(jsonPath.c_str());
+
+  Nursery &nursery = Nursery::current();
+  Heap &heap = Heap::current();
+
+  for (auto &&workload : allocations) {
+    std::string result{};
+
+    nursery.enabled = false;
+    auto baseline = run(workload, result);
+    nursery.enabled = true;
+
+    heap.stats = HeapStats{};
+    auto counters = Object::counters();
+    auto best = run(workload, result);
+
+    std::cout << workload.name << ": " << best.count() << " ms, malloc " << baseline.count() << " ms (result "
+              << result << ")\n";
+    std::cout << "  " << heap.stats.collections << " collections, " << heap.stats.minorCollections
+              << " minor, max pause " << heap.stats.maxPause.count() / 1000.0 << " us\n";
+
+    std::cout << "  allocated";
+    for (std::size_t kind = 0; kind < ObjectKinds; kind++) {
+      auto allocated = Object::counters().allocated[kind] - counters.allocated[kind];
+      if (allocated > 0) {
+        std::cout << " " << Object::typeName(static_cast<ObjectKind>(kind)) << " " << allocated / Rounds;
+      }
+    }
+    std::cout << "\n";
+  }
+
+  return 0;
+}
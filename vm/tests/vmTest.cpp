@@ -1,13 +1,18 @@
 #include "ast.hpp"
+#include "builtins.hpp"
 #include "compiler.hpp"
+#include "json.hpp"
 #include "lexer.hpp"
 #include "object.hpp"
 #include "parser.hpp"
+#include "serializer.hpp"
 #include "spdlog/spdlog.h"
 #include "vm.hpp"
 
 #include <cstddef>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -24,6 +29,7 @@ bool testExpectedObject(const T &expected, Object *actual);
 
 std::unique_ptr<Program> parse(const std::string &input);
 bool testIntegerObject(int expected, Object *actual);
+bool testFloatObject(double expected, Object *actual);
 bool testBooleanObject(bool expected, Object *actual);
 bool testIntegerArrayObject(const std::vector<int> &expected, Object *actual);
 
@@ -37,6 +43,8 @@ template <typename T>
 bool testExpectedObject(const T &expected, Object *actual) {
   if constexpr (std::is_same_v<int, T>) {
     return testIntegerObject(expected, actual);
+  } else if constexpr (std::is_same_v<double, T>) {
+    return testFloatObject(expected, actual);
   } else if constexpr (std::is_same_v<bool, T>) {
     return testBooleanObject(expected, actual);
   } else if constexpr (std::is_same_v<std::string, T>) {
@@ -62,6 +70,21 @@ bool testIntegerObject(int expected, Object *actual) {
   return true;
 }
 
+bool testFloatObject(double expected, Object *actual) {
+  auto floating = dynamic_cast<const Float *>(actual);
+  if (floating == nullptr) {
+    spdlog::error("object is not Float. got={}", actual->type());
+    return false;
+  }
+
+  if (floating->value != expected) {
+    spdlog::error("object has wrong value. want={}, got={}", expected, floating->value);
+    return false;
+  }
+
+  return true;
+}
+
 bool testBooleanObject(bool expected, Object *actual) {
   auto boolean = dynamic_cast<const Boolean *>(actual);
   if (boolean == nullptr) {
@@ -84,8 +107,8 @@ bool testStringObject(const std::string &expected, Object *actual) {
     return false;
   }
 
-  if (string->value != expected) {
-    spdlog::error("object has wrong value. want={}, got={}", expected, string->value);
+  if (string->value() != expected) {
+    spdlog::error("object has wrong value. want={}, got={}", expected, string->value());
     return false;
   }
 
@@ -99,13 +122,13 @@ bool testIntegerArrayObject(const std::vector<int> &expected, Object *actual) {
     return false;
   }
 
-  if (array->elements.size() != expected.size()) {
-    spdlog::error("array has wrong num of elements. want={}, got={}", expected.size(), array->elements.size());
+  if (array->size() != expected.size()) {
+    spdlog::error("array has wrong num of elements. want={}, got={}", expected.size(), array->size());
     return false;
   }
 
   for (std::size_t i = 0; i < expected.size(); ++i) {
-    if (!testIntegerObject(expected[i], array->elements[i].get())) {
+    if (!testIntegerObject(expected[i], array->get(i).get())) {
       return false;
     }
   }
@@ -148,6 +171,55 @@ TEST(VM, TestIntegerArithmetic) {
   }
 }
 
+TEST(VM, TestFloatArithmetic) {
+  std::vector<vmTestCase<double>> tests{
+      {"1.5", 1.5},
+      {"-2.25", -2.25},
+      {"1.5 + 2.25", 3.75},
+      {"1 + 0.5", 1.5},
+      {"0.5 * 4", 2.0},
+      {"7 / 2.0", 3.5},
+      {"let half = fn(x) { x / 2.0 }; half(3) - half(1)", 1.0},
+      // The integers are promoted by the generic opcodes as well
+      {"let x = 2.5; let y = 2; x * y + y", 7.0},
+  };
+
+  for (auto &&test : tests) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    auto stackElem = vm.lastPoppedStackElem();
+
+    EXPECT_TRUE(testExpectedObject(test.expected, stackElem.get()));
+  }
+
+  std::vector<vmTestCase<bool>> comparisons{
+      {"1.5 < 2", true},
+      {"2 > 1.5", true},
+      {"2.0 == 2", true},
+      {"0.1 + 0.2 != 0.3", true},
+  };
+
+  for (auto &&test : comparisons) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    auto stackElem = vm.lastPoppedStackElem();
+
+    EXPECT_TRUE(testExpectedObject(test.expected, stackElem.get()));
+  }
+}
+
 TEST(VM, TestBooleanExpressions) {
   std::vector<vmTestCase<bool>> tests{
       {"true", true},
@@ -175,6 +247,10 @@ TEST(VM, TestBooleanExpressions) {
       {"!!true", true},
       {"!!false", false},
       {"!!5", true},
+      {"\"monkey\" == \"monkey\"", true},
+      {"\"mon\" + \"key\" == \"monkey\"", true},
+      {"\"monkey\" != \"monkey\"", false},
+      {"\"monkey\" == \"banana\"", false},
   };
 
   for (auto &&test : tests) {
@@ -297,6 +373,38 @@ TEST(VM, TestIndexExpressions) {
   };
 }
 
+TEST(VM, TestHashIndexExpressions) {
+  std::vector<vmTestCase<int>> tests{
+      {"{1: 1, 2: 2}[1]", 1},
+      {"{1: 1, 2: 2}[2]", 2},
+      {R"({"one": 1, "two": 2}["t" + "wo"])", 2},
+      {"{true: 1, false: 0}[1 > 2]", 0},
+      {R"(let h = {"a": {"b": 42}}; h["a"]["b"])", 42},
+  };
+
+  for (auto &&test : tests) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    auto stackElem = vm.lastPoppedStackElem();
+
+    EXPECT_TRUE(testExpectedObject(test.expected, stackElem.get()));
+  }
+
+  // A missing key is null
+  auto program = parse(R"({"one": 1}["two"])");
+  Compiler compiler;
+  compiler.compile(program.get());
+  VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+  vm.run();
+  EXPECT_EQ(vm.lastPoppedStackElem(), nullptr);
+}
+
 TEST(VM, TestCallingFunctionsWithoutArguments) {
   std::vector<vmTestCase<int>> tests{
       {"let fivePlusTen = fn() { 5 + 10; }; fivePlusTen();", 15},
@@ -426,6 +534,15 @@ TEST(VM, TestBuiltinFunctions) {
       {R"(len(""))", 0},
       {R"(len("four"))", 4},
       {R"(len("hello world"))", 11},
+      {"len([1, 2, 3])", 3},
+      {"first([]); 5", 5},
+      {"first(rest(push([1], 2)))", 2},
+      {"sum([1, 2, 3, 4])", 10},
+      {"sum(push([1, 2], 3))", 6},
+      {"min([3, -1, 2]) + max([3, -1, 2])", 2},
+      {"dot([1, 2, 3], [4, 5, 6])", 32},
+      {"add([1, 2], [10, 20])[1]", 22},
+      {"sum(mul([1, 2, 3], [1, 2, 3]))", 14},
   };
 
   for (auto &&test : tests) {
@@ -443,6 +560,473 @@ TEST(VM, TestBuiltinFunctions) {
   }
 }
 
+TEST(VM, TestHigherOrderBuiltins) {
+  std::vector<vmTestCase<std::vector<int>>> tests{
+      {"map([1, 2, 3], fn(x) { x * 2 })", {2, 4, 6}},
+      {"let k = 10; map([1, 2], fn(x) { x + k })", {11, 12}},
+      {"collect(filter(range(10), fn(x) { x / 3 * 3 == x }))", {0, 3, 6, 9}},
+      {"collect(range(3))", {0, 1, 2}},
+      {"collect(range(2, 5))", {2, 3, 4}},
+      {"collect(range(5, 0, -2))", {5, 3, 1}},
+      {"collect(range(3, 3))", {}},
+      {"map([[1], [1, 2]], len)", {1, 2}},
+      // The callbacks nest and call the builtins themselves
+      {"map([1, 2], fn(x) { reduce(map(range(x), fn(y) { y + 1 }), 0, fn(a, b) { a + b }) })", {1, 3}},
+  };
+
+  for (auto &&test : tests) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    auto stackElem = vm.lastPoppedStackElem();
+
+    EXPECT_TRUE(testExpectedObject(test.expected, stackElem.get())) << test.input;
+    // The stack is back where it was
+    EXPECT_EQ(vm.sp, 0) << test.input;
+  }
+
+  std::vector<vmTestCase<int>> reductions{
+      {"reduce(range(1, 101), 0, fn(acc, x) { acc + x })", 5050},
+      {"let f = fn(n) { reduce(range(n), 1, fn(acc, x) { acc * 2 }) }; f(3) + f(4)", 24},
+      {"let r = each(range(7), fn(x) { x * 2 }); if (r) { 1 } else { 7 }", 7},
+      {"count(map(range(100000), fn(x) { x }))", 100000},
+  };
+
+  for (auto &&test : reductions) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    auto stackElem = vm.lastPoppedStackElem();
+
+    EXPECT_TRUE(testExpectedObject(test.expected, stackElem.get())) << test.input;
+  }
+
+  std::vector<vmTestCase<std::string>> errors{
+      {"map([1], 1)", "argument to map must be a function, got INTEGER"},
+      {"map([[1], 2], len)", "argument to len not supported, got INTEGER"},
+      {"range(0, 5, 0)", "step of range must not be 0"},
+      {"map([1, 2], fn(x, y) { y })", "wrong number of arguments. got=1, want=2"},
+      {"reduce([1, 2], 0, fn(x) { x })", "wrong number of arguments. got=2, want=1"},
+      {"count(filter(range(3), fn() { true }))", "wrong number of arguments. got=1, want=0"},
+  };
+
+  for (auto &&test : errors) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    auto error = dynamic_cast<Error *>(vm.lastPoppedStackElem().get());
+    ASSERT_NE(error, nullptr) << test.input;
+    ASSERT_EQ(error->message, test.expected);
+  }
+}
+
+TEST(VM, TestIterators) {
+  std::vector<vmTestCase<std::vector<int>>> tests{
+      {"collect(take(range(1000000000), 3))", {0, 1, 2}},
+      {"collect(map(take(filter(range(100), fn(x) { x / 7 * 7 == x }), 4), fn(x) { x + 1 }))", {1, 8, 15, 22}},
+      {"map(collect(zip([1, 2, 3], range(10, 20))), sum)", {11, 13, 15}},
+      {"collect(take([4, 5, 6], 2))", {4, 5}},
+      {"let r = range(4); let a = collect(take(r, 2)); push(a, first(collect(r)))", {0, 1, 2}},
+  };
+
+  for (auto &&test : tests) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    EXPECT_TRUE(testExpectedObject(test.expected, vm.lastPoppedStackElem().get())) << test.input;
+    EXPECT_EQ(vm.sp, 0) << test.input;
+  }
+
+  std::vector<vmTestCase<int>> terminals{
+      {"sum(map(range(65536), fn(x) { x }))", 2147450880},
+      {"count(filter(range(100000), fn(x) { x / 2 * 2 == x }))", 50000},
+      {"count(chars(\"monkey\"))", 6},
+      {"len(first(collect(chars(\"monkey\"))))", 1},
+      {"reduce(take(range(1, 100), 4), 1, fn(a, b) { a * b })", 24},
+  };
+
+  for (auto &&test : terminals) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    EXPECT_TRUE(testExpectedObject(test.expected, vm.lastPoppedStackElem().get())) << test.input;
+  }
+
+  std::vector<vmTestCase<std::string>> errors{
+      {"collect(map(range(3), len))", "argument to len not supported, got INTEGER"},
+      {"sum(chars(\"ab\"))", "elements of sum must be INTEGER or FLOAT, got STRING"},
+      {"zip(1, [2])", "arguments to zip must be ARRAY or ITERATOR, got INTEGER and ARRAY"},
+      {"readLines(\"/nonexistent/monkey\")", "could not read /nonexistent/monkey: No such file or directory"},
+  };
+
+  for (auto &&test : errors) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    auto error = dynamic_cast<Error *>(vm.lastPoppedStackElem().get());
+    ASSERT_NE(error, nullptr) << test.input;
+    EXPECT_EQ(error->message, test.expected) << test.input;
+  }
+}
+
+TEST(VM, TestSort) {
+  std::vector<vmTestCase<std::vector<int>>> tests{
+      {"sort([3, 1, 2, 1])", {1, 1, 2, 3}},
+      {"sort([])", {}},
+      {"sort(rest([9, 8, 7]))", {7, 8}},
+      {"sort([3, 1, 2], fn(a, b) { a > b })", {3, 2, 1}},
+      {"sort([3, 1, 2], fn(a, b) { b - a })", {3, 2, 1}},
+      // The comparator sort is stable
+      {"map(sort([[2, 0], [1, 1], [2, 2], [1, 3]], fn(a, b) { a[0] < b[0] }), last)", {1, 3, 0, 2}},
+      {"let a = [5, 4]; let b = sort(a); push(a, first(b))", {5, 4, 4}},
+      {"map(sort([\"pear\", \"fig\", \"apple\"]), len)", {5, 3, 4}},
+  };
+
+  for (auto &&test : tests) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    EXPECT_TRUE(testExpectedObject(test.expected, vm.lastPoppedStackElem().get())) << test.input;
+    EXPECT_EQ(vm.sp, 0) << test.input;
+  }
+
+  std::vector<vmTestCase<double>> numbers{
+      {"first(sort([2.5, 1, 0.5]))", 0.5},
+      {"last(sort([2.5, 1, 3, 0.5]))", 3},
+  };
+
+  for (auto &&test : numbers) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    auto result = vm.lastPoppedStackElem();
+    if (result->is<Integer>()) {
+      EXPECT_EQ(result.cast<Integer>()->value, test.expected) << test.input;
+    } else {
+      EXPECT_TRUE(testExpectedObject(test.expected, result.get())) << test.input;
+    }
+  }
+
+  std::vector<vmTestCase<std::string>> errors{
+      {"sort([1, \"a\"])", "elements of sort must be all numbers or all STRING without a comparator"},
+      {"sort([[1], 2], fn(a, b) { len(a) })", "argument to len not supported, got INTEGER"},
+      {"sort(1)", "argument to sort must be ARRAY, got INTEGER"},
+  };
+
+  for (auto &&test : errors) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    auto error = dynamic_cast<Error *>(vm.lastPoppedStackElem().get());
+    ASSERT_NE(error, nullptr) << test.input;
+    EXPECT_EQ(error->message, test.expected) << test.input;
+  }
+}
+
+TEST(VM, TestJson) {
+  std::vector<vmTestCase<std::string>> tests{
+      {R"(jsonStringify([1, "a", true, 2.5, {"k": [], "n": {}}]))", R"([1,"a",true,2.5,{"k":[],"n":{}}])"},
+      {R"(jsonStringify({1: "one", true: first([])}))", R"({"1":"one","true":null})"},
+      {R"(jsonStringify(jsonParse(jsonStringify(["x", [1, 2], {"y": -3}]))))", R"(["x",[1,2],{"y":-3}])"},
+      {R"(let h = jsonParse(jsonStringify({"name": "monkey", "legs": 2})); h["name"])", "monkey"},
+  };
+
+  for (auto &&test : tests) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    EXPECT_TRUE(testExpectedObject(test.expected, vm.lastPoppedStackElem().get())) << test.input;
+  }
+
+  // The JSON values
+  std::vector<std::pair<std::string, std::string>> values{
+      {R"( {"a" : [1, -2, 3.25e2, 0.5, 1E-2, 9223372036854775808], "b": null, "c": [true, false]} )",
+       R"({"a":[1,-2,325.0,0.5,0.01,9223372036854775808.0],"b":null,"c":[true,false]})"},
+      {R"("\"\\\/\b\f\n\r\tA\u00e9\ud83d\ude00")", "\"\\\"\\\\/\\u0008\\u000c\\n\\r\\tA\xc3\xa9\xf0\x9f\x98\x80\""},
+      {R"([[[[]]], {}, "", [{}]])", R"([[[[]]],{},"",[{}]])"},
+      {"\t\r\n 42 \n", "42"},
+      {R"({"k": 1, "k": 2})", R"({"k":2})"},
+      {"[1e-400, -1e-400]", "[0.0,-0.0]"},
+      {"\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80" + std::string(20, 'a') + "\xc3\xa9\"",
+       "\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80" + std::string(20, 'a') + "\xc3\xa9\""},
+  };
+  for (auto &&[input, expected] : values) {
+    auto parsed = Json::parse(input);
+    ASSERT_FALSE(parsed.is<Error>()) << input << ": " << parsed.inspect();
+    auto text = Json::stringify(parsed);
+    ASSERT_TRUE(text.is<String>()) << input;
+    EXPECT_EQ(text.as<String>()->value(), expected);
+  }
+
+  std::vector<std::pair<std::string, std::string>> errors{
+      {"", "invalid JSON at offset 0: unexpected end"},
+      {"[1, 2", "invalid JSON at offset 5: unexpected end"},
+      {"[1, 2,]", "invalid JSON at offset 6: unexpected character"},
+      {"[1 2]", "invalid JSON at offset 3: expected ',' or ']'"},
+      {R"({"a" 1})", "invalid JSON at offset 5: expected ':'"},
+      {"{1: 2}", "invalid JSON at offset 1: expected a string key"},
+      {"tru", "invalid JSON at offset 0: unexpected character"},
+      {"truex", "invalid JSON at offset 0: unexpected character"},
+      {"01", "invalid JSON at offset 1: invalid number"},
+      {"1.", "invalid JSON at offset 0: invalid number"},
+      {"[1] [2]", "invalid JSON at offset 4: unexpected content after the value"},
+      {R"([1, "abc)", "invalid JSON at offset 4: unterminated string"},
+      {"[1e400]", "invalid JSON at offset 1: number out of range"},
+      {"-1e400", "invalid JSON at offset 0: number out of range"},
+      {"[\"ab\xff\xfe\"]", "invalid JSON at offset 4: invalid UTF-8 in string"},
+      {"\"a\\n\xc3\"", "invalid JSON at offset 4: invalid UTF-8 in string"},
+      {"\"\xed\xa0\x80\"", "invalid JSON at offset 1: invalid UTF-8 in string"},
+      {"\"\xc0\xaf\"", "invalid JSON at offset 1: invalid UTF-8 in string"},
+      {R"("a\qb")", "invalid JSON at offset 2: invalid escape"},
+      {R"("\ud800")", "invalid JSON at offset 7: invalid unicode escape"},
+      {"\"a\nb\"", "invalid JSON at offset 2: control character in string"},
+      {std::string(Json::MaxDepth + 1, '['), "invalid JSON at offset 1024: too deeply nested"},
+  };
+  for (auto &&[input, expected] : errors) {
+    auto parsed = Json::parse(input);
+    ASSERT_TRUE(parsed.is<Error>()) << input;
+    EXPECT_EQ(parsed.as<Error>()->message, expected);
+  }
+
+  // The strings with the runs of backslashes and quotes across the blocks
+  std::mt19937 random{42};
+  const char alphabet[] = {'a', '\\', '"', ' ', '[', '{', ',', ':', '\n', 'x'};
+  for (int round = 0; round < 200; round++) {
+    std::string text(random() % 300, ' ');
+    for (auto &&c : text) {
+      c = alphabet[random() % sizeof(alphabet)];
+    }
+    auto strings = Array::from(std::vector<Value>{makeRef<String>(text), Value::fromInteger(round)}.data(), 2);
+    auto json = Json::stringify(strings);
+    auto parsed = Json::parse(json.as<String>()->value());
+    ASSERT_TRUE(parsed.is<Array>()) << json.inspect();
+    ASSERT_EQ(parsed.as<Array>()->get(0).cast<String>()->value(), text);
+    ASSERT_EQ(parsed.as<Array>()->get(1).cast<Integer>()->value, round);
+  }
+
+  // A cycle could not be written
+  auto cyclic = makeRef<Array>();
+  cyclic->elements.push_back(cyclic);
+  auto error = Json::stringify(Value{cyclic});
+  ASSERT_TRUE(error.is<Error>());
+  EXPECT_EQ(error.as<Error>()->message, "could not stringify: too deeply nested or cyclic");
+  cyclic->elements = PersistentVector{};
+  error = Json::stringify(Value::fromFloat(0.0 / 0.0));
+  EXPECT_EQ(error.as<Error>()->message, "could not stringify: JSON has no NaN");
+  error = Json::stringify(Value{makeRef<String>("ab\xff\xfe")});
+  EXPECT_EQ(error.as<Error>()->message, "could not stringify: invalid UTF-8 in string");
+}
+
+TEST(VM, TestSerialize) {
+  std::vector<vmTestCase<int>> tests{
+      {"let a = deserialize(serialize([1, [2, 3], {\"k\": 4}])); a[0] + a[1][1] + a[2][\"k\"]", 8},
+      {"deserialize(serialize(len))(\"monkey\")", 6},
+      {"sum(deserialize(serialize(collect(range(100)))))", 4950},
+  };
+
+  for (auto &&test : tests) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    EXPECT_TRUE(testExpectedObject(test.expected, vm.lastPoppedStackElem().get())) << test.input;
+  }
+
+  // The values round trip, the unboxed arrays stay unboxed
+  std::string text(100, 'm');
+  std::vector<std::string> values{
+      R"([1, -2, 2.5, true, false, "monkey", [], {}, [9223372036854775807, -9223372036854775808]])",
+      R"({1: "one", true: [first([]), 1.5], "nested": {"k": [[1], ["a"]]}})",
+  };
+  for (auto &&input : values) {
+    auto program = parse(input);
+    Compiler compiler;
+    compiler.compile(program.get());
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    Value value{vm.lastPoppedStackElem()};
+    auto bytes = Serializer::serialize(value);
+    ASSERT_TRUE(bytes.is<String>()) << input << ": " << bytes.inspect();
+    auto read = Serializer::deserialize(bytes.as<String>());
+    ASSERT_FALSE(read.is<Error>()) << input << ": " << read.inspect();
+    EXPECT_EQ(read.inspect(), value.inspect()) << input;
+  }
+  auto integers = Serializer::deserialize(Serializer::serialize(Array::from(IntVector{})).as<String>());
+  ASSERT_TRUE(integers.is<Array>());
+  EXPECT_TRUE(integers.as<Array>()->unboxed);
+
+  // The sharing is kept
+  auto shared = makeRef<String>(text);
+  auto inner = makeRef<Array>();
+  inner->elements.push_back(shared);
+  auto outer = makeRef<Array>();
+  outer->elements.push_back(shared);
+  outer->elements.push_back(inner);
+  outer->elements.push_back(inner);
+  auto read = Serializer::deserialize(Serializer::serialize(Value{outer}).as<String>());
+  ASSERT_TRUE(read.is<Array>());
+  auto array = read.as<Array>();
+  ASSERT_EQ(array->size(), 3u);
+  EXPECT_EQ(array->get(0).cast<String>()->value(), text);
+  EXPECT_EQ(array->get(1).get(), array->get(2).get());
+  EXPECT_EQ(array->get(1).cast<Array>()->get(0).get(), array->get(0).get());
+
+  // The long strings view the mapped file they are read from
+  std::string path = ::testing::TempDir() + "monkey_values.bin";
+  {
+    auto bytes = Serializer::serialize(Array::from(std::vector<Value>{shared, makeRef<String>("short")}.data(), 2));
+    std::ofstream file{path, std::ios::binary};
+    file << bytes.as<String>()->value();
+  }
+  std::string reason{};
+  auto file = MappedFile::open(path, reason);
+  ASSERT_NE(file, nullptr) << reason;
+  auto mapped = String::view(file, file->text());
+  read = Serializer::deserialize(mapped.get());
+  ASSERT_TRUE(read.is<Array>()) << read.inspect();
+  EXPECT_EQ(read.as<Array>()->get(0).cast<String>()->mapping(), file);
+  EXPECT_EQ(read.as<Array>()->get(0).cast<String>()->value(), text);
+  EXPECT_EQ(read.as<Array>()->get(1).cast<String>()->mapping(), nullptr);
+
+  std::vector<std::pair<std::string, std::string>> errors{
+      {"", "invalid serialized value at offset 0: not a serialized value"},
+      {"MKY\x02", "invalid serialized value at offset 3: unsupported version 2"},
+      {"MKY\x01", "invalid serialized value at offset 4: unexpected end"},
+      {"MKY\x01\x63", "invalid serialized value at offset 4: unknown tag 99"},
+      {"MKY\x01\x03\x03", "invalid serialized value at offset 5: unexpected bytes after the value"},
+      {"MKY\x01\x07\x01\x05\x01", "invalid serialized value at offset 8: unknown reference 1"},
+      {"MKY\x01\x06\x10" "ab", "invalid serialized value at offset 6: unexpected end"},
+      {"MKY\x01\x09\x01\x0c\x03" "len\x03", "invalid serialized value at offset 11: unusable as hash key: BUILTIN"},
+      {std::string{"MKY\x01\x07\x01\x05\x00", 8}, "invalid serialized value at offset 8: cyclic reference 0"},
+      {std::string{"MKY\x01\x09\x01\x03\x07\x01\x05\x00", 11},
+       "invalid serialized value at offset 11: cyclic reference 0"},
+  };
+  for (auto &&[input, expected] : errors) {
+    auto error = Serializer::deserialize(input);
+    ASSERT_TRUE(error.is<Error>()) << expected;
+    EXPECT_EQ(error.as<Error>()->message, expected);
+  }
+
+  // Every cut of valid bytes is rejected
+  auto bytes = Serializer::serialize(Array::from(
+      std::vector<Value>{Value::fromFloat(0.5), makeRef<String>(text), Array::from(IntVector{}.rest())}.data(), 3));
+  std::string_view whole = bytes.as<String>()->value();
+  for (std::size_t length = 0; length < whole.size(); length++) {
+    ASSERT_TRUE(Serializer::deserialize(whole.substr(0, length)).is<Error>()) << length;
+  }
+
+  auto error = Serializer::serialize(Value{makeRef<Error>("boom")});
+  ASSERT_TRUE(error.is<Error>());
+  EXPECT_EQ(error.as<Error>()->message, "could not serialize: ERROR");
+
+  // The functions refer to the constants of their program
+  std::vector<vmTestCase<std::string>> functions{
+      {"serialize(fn(x) { x * 2 })", "could not serialize: CLOSURE"},
+      {"let adder = fn(a) { fn(b) { a + b } }; serialize([adder(3)])", "could not serialize: CLOSURE"},
+  };
+  for (auto &&test : functions) {
+    auto program = parse(test.input);
+    Compiler compiler;
+    compiler.compile(program.get());
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    Value value{vm.lastPoppedStackElem()};
+    ASSERT_TRUE(value.is<Error>()) << test.input;
+    EXPECT_EQ(value.as<Error>()->message, test.expected);
+  }
+  for (std::string input : {"MKY\x01\x0a", "MKY\x01\x0b"}) {
+    auto rejected = Serializer::deserialize(input);
+    ASSERT_TRUE(rejected.is<Error>()) << input;
+    EXPECT_EQ(rejected.as<Error>()->message, "invalid serialized value at offset 4: unknown tag " +
+                                                 std::to_string(static_cast<uint8_t>(input.back())));
+  }
+}
+
+TEST(VM, TestBuiltinArity) {
+  std::vector<vmTestCase<std::string>> tests{
+      {"len([1], [2])", "wrong number of arguments. got=2, want=1"},
+      {"push([1])", "wrong number of arguments. got=1, want=2"},
+      {"first()", "wrong number of arguments. got=0, want=1"},
+  };
+
+  for (auto &&test : tests) {
+    auto program = parse(test.input);
+
+    Compiler compiler;
+    compiler.compile(program.get());
+
+    VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+    vm.run();
+
+    auto error = dynamic_cast<Error *>(vm.lastPoppedStackElem().get());
+    ASSERT_NE(error, nullptr) << test.input;
+    ASSERT_EQ(error->message, test.expected);
+  }
+
+  // The names and the indices agree
+  auto &names = Builtins::getBuiltinNames();
+  for (std::size_t i = 0; i < names.size(); i++) {
+    ASSERT_EQ(Builtins::lookup(names[i]).get(), Builtins::getBuiltinByIndex(i).as<Builtin>());
+  }
+  ASSERT_EQ(Builtins::lookup("monkey"), nullptr);
+}
+
 TEST(VM, TestClosures) {
   std::vector<vmTestCase<int>> tests{
       {"let newClosure = fn(a) {fn() {a;};};let closure = newClosure(99); closure();", 99},
@@ -467,3 +1051,52 @@ TEST(VM, TestClosures) {
     EXPECT_TRUE(testExpectedObject(test.expected, stackElem.get()));
   }
 }
+
+TEST(VM, TestInlineValues) {
+  // Integers are stored inline in 64 bits, they are not truncated.
+  auto program = parse("let big = 3000000000; big * 2 + 1");
+
+  Compiler compiler;
+  compiler.compile(program.get());
+
+  ASSERT_TRUE(compiler.getBytecode().constants[0].isInteger());
+
+  VM vm{std::move(compiler.getBytecode().constants), std::move(compiler.getBytecode().instructions)};
+  vm.run();
+
+  auto stackElem = vm.lastPoppedStackElem();
+  auto integer = dynamic_cast<Integer *>(stackElem.get());
+  ASSERT_NE(integer, nullptr);
+  ASSERT_EQ(integer->value, 6000000001);
+
+  // Boxing and unboxing keep the value
+  Value value = Integer::of(42);
+  ASSERT_TRUE(value.isInteger());
+  ASSERT_EQ(value.getInteger(), 42);
+  ASSERT_TRUE(Value{Boolean::of(true)}.isBoolean());
+  ASSERT_TRUE(Value{nullptr}.isNull());
+  ASSERT_TRUE(Value{makeRef<String>("monkey")}.is<String>());
+  ASSERT_EQ(Value::fromBoolean(false).toObject(), Boolean::of(false));
+}
+
+TEST(VM, TestReferenceCounts) {
+  auto string = makeRef<String>("monkey");
+  ASSERT_EQ(string->getRefCount(), 1u);
+
+  {
+    Value value = string;
+    auto copy = value;
+    ASSERT_EQ(string->getRefCount(), 3u);
+  }
+  ASSERT_EQ(string->getRefCount(), 1u);
+
+  // Freezing an array makes its elements immortal as well
+  auto array = makeRef<Array>();
+  array->elements.push_back(string);
+  array->freeze();
+  ASSERT_TRUE(array->isImmortal());
+  ASSERT_TRUE(string->isImmortal());
+
+  ASSERT_TRUE(Integer::of(1)->isImmortal());
+  ASSERT_EQ(sizeof(Value), 16u);
+}
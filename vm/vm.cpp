@@ -3,38 +3,32 @@
 #include "builtins.hpp"
 #include "code.hpp"
 #include "frame.hpp"
+#include "heap.hpp"
 #include "object.hpp"
 #include "spdlog/spdlog.h"
 
+#include <cstdint>
 #include <memory>
 #include <stdexcept>
 #include <vector>
 
-constexpr std::string_view INTEGER_OBJ = "INTEGER";
-constexpr std::string_view BOOLEAN_OBJ = "BOOLEAN";
-constexpr std::string_view RETURN_VALUE_OBJ = "RETURN_VALUE";
-constexpr std::string_view ERROR_OBJ = "ERROR";
-constexpr std::string_view STRING_OBJ = "STRING";
-constexpr std::string_view ARRAY_OBJ = "ARRAY";
-
-std::shared_ptr<Object> VM::True = std::make_shared<Boolean>(true);
-std::shared_ptr<Object> VM::False = std::make_shared<Boolean>(false);
-
 static int readTwoBytes(Instructions &instructions, int ip);
 
 static int readTwoBytes(Instructions &instructions, int ip) {
   return (int(instructions[ip + 1]) << 8) | int(instructions[ip + 2]);
 }
 
-Object *VM::stackTop() {
+Value VM::stackTop() {
   if (sp == 0) {
     return nullptr;
   }
-  return stack[sp - 1].get();
+  return stack[sp - 1];
 }
 
-void VM::run() {
-  while (currentFrame()->ip < static_cast<int>(currentFrame()->instructions().size() - 1)) {
+void VM::run() { execute(0); }
+
+void VM::execute(int depth) {
+  while (framesIndex > depth && currentFrame()->ip < static_cast<int>(currentFrame()->instructions().size() - 1)) {
     currentFrame()->ip++;
     int ip = currentFrame()->ip;
     Instructions &instructions = currentFrame()->instructions();
@@ -47,12 +41,14 @@ void VM::run() {
       push(constants[index]);
     } else if (op == Ops::OpAdd || op == Ops::OpSub || op == Ops::OpMul || op == Ops::OpDiv) {
       executeBinaryOperation(op);
+    } else if (op == Ops::OpAddFloat || op == Ops::OpSubFloat || op == Ops::OpMulFloat || op == Ops::OpDivFloat) {
+      executeFloatOperation(op);
     } else if (op == Ops::OpPop) {
       lastPopped = pop();
     } else if (op == Ops::OpTrue) {
-      push(True);
+      push(Value::fromBoolean(true));
     } else if (op == Ops::OpFalse) {
-      push(False);
+      push(Value::fromBoolean(false));
     } else if (op == Ops::OpEqual || op == Ops::OpNotEqual || op == Ops::OpGreaterThan) {
       executeComparision(op);
     } else if (op == Ops::OpBang) {
@@ -81,7 +77,6 @@ void VM::run() {
     } else if (op == Ops::OpGetGlobal) {
       int globalIndex = readTwoBytes(instructions, ip);
       currentFrame()->ip += 2;
-      auto &value = (*globals)[globalIndex];
       push((*globals)[globalIndex]);
     } else if (op == Ops::OpArray) {
       int numElements = readTwoBytes(instructions, ip);
@@ -92,6 +87,15 @@ void VM::run() {
 
       push(array);
 
+    } else if (op == Ops::OpHash) {
+      int numElements = readTwoBytes(instructions, ip);
+      currentFrame()->ip += 2;
+
+      auto hash = buildHash(sp - numElements, sp);
+      sp -= numElements;
+
+      push(hash);
+
     } else if (op == Ops::OpIndex) {
       auto index = pop();
       auto left = pop();
@@ -101,6 +105,10 @@ void VM::run() {
       int argumentSize = int(instructions[ip + 1]);
       currentFrame()->ip++;
 
+      // Every value in use is on the stack or in the globals between
+      // the instructions, it is a safe point to collect.
+      Heap::current().poll();
+
       executeCall(argumentSize);
     } else if (op == Ops::OpReturnValue) {
       auto returnValue = pop();
@@ -122,9 +130,7 @@ void VM::run() {
       int builtIndex = int(instructions[ip + 1]);
       currentFrame()->ip++;
 
-      std::shared_ptr<Object> definition = Builtins::getBuiltinByIndex(builtIndex);
-
-      push(definition);
+      push(Builtins::getBuiltinByIndex(builtIndex));
     } else if (op == Ops::OpClosure) {
       int constantIndex = readTwoBytes(instructions, ip);
       int freeVariableSize = int(instructions[ip + 3]);
@@ -145,72 +151,94 @@ void VM::run() {
   }
 }
 
-void VM::push(std::shared_ptr<Object> &object) {
+void VM::push(Value value) {
   if (sp >= StackSize) {
     throw std::runtime_error("stack overflow");
   }
 
-  stack[sp] = object;
+  stack[sp] = std::move(value);
   sp++;
 }
 
-std::shared_ptr<Object> VM::pop() {
+Value VM::pop() {
   if (sp == 0) {
     throw std::runtime_error("stack underflow");
   }
 
-  auto object = stack[sp - 1];
+  // The slot is dead after the pop, move the value out of it.
   sp--;
-  return object;
+  return std::move(stack[sp]);
 }
 
 void VM::executeBinaryOperation(const Opcode &op) {
   auto right = pop();
   auto left = pop();
-  auto leftType = left->type();
-  auto rightType = right->type();
-
-  if (leftType == INTEGER_OBJ && rightType == INTEGER_OBJ) {
+  if (left.isInteger() && right.isInteger()) {
     executeBinaryIntegerOperation(op, left, right);
-  } else if (leftType == STRING_OBJ && rightType == STRING_OBJ) {
+  } else if (left.isNumber() && right.isNumber()) {
+    executeBinaryFloatOperation(op, left.getNumber(), right.getNumber());
+  } else if (left.is<String>() && right.is<String>()) {
     executeBinaryStringOperation(op, left, right);
   } else {
-    spdlog::error("unsupported types for binary operation: {} {}", leftType, rightType);
+    spdlog::error("unsupported types for binary operation: {} {}", left.type(), right.type());
   }
 }
 
-void VM::executeBinaryIntegerOperation(const Opcode &op,
-                                       std::shared_ptr<Object> &left,
-                                       std::shared_ptr<Object> &right) {
-  Integer *rightInteger = dynamic_cast<Integer *>(right.get());
-  Integer *leftInteger = dynamic_cast<Integer *>(left.get());
+void VM::executeBinaryIntegerOperation(const Opcode &op, const Value &left, const Value &right) {
+  int64_t rightInteger = right.getInteger();
+  int64_t leftInteger = left.getInteger();
 
-  int result{};
+  int64_t result{};
   if (op == Ops::OpAdd) {
-    result = leftInteger->value + rightInteger->value;
+    result = leftInteger + rightInteger;
   } else if (op == Ops::OpSub) {
-    result = leftInteger->value - rightInteger->value;
+    result = leftInteger - rightInteger;
   } else if (op == Ops::OpMul) {
-    result = leftInteger->value * rightInteger->value;
+    result = leftInteger * rightInteger;
   } else if (op == Ops::OpDiv) {
-    result = leftInteger->value / rightInteger->value;
+    result = leftInteger / rightInteger;
   } else {
     spdlog::error("unknown operator for integers: {}", op);
     return;
   }
 
-  std::shared_ptr<Object> resultObject = std::make_shared<Integer>(result);
-  push(resultObject);
+  push(Value::fromInteger(result));
 }
 
-void VM::executeBinaryStringOperation(const Opcode &op, std::shared_ptr<Object> &left, std::shared_ptr<Object> &right) {
-  String *rightString = dynamic_cast<String *>(right.get());
-  String *leftString = dynamic_cast<String *>(left.get());
+void VM::executeFloatOperation(const Opcode &op) {
+  auto right = pop();
+  auto left = pop();
+  if (left.isNumber() && right.isNumber()) {
+    executeBinaryFloatOperation(op, left.getNumber(), right.getNumber());
+  } else {
+    spdlog::error("unsupported types for binary operation: {} {}", left.type(), right.type());
+  }
+}
+
+void VM::executeBinaryFloatOperation(const Opcode &op, double left, double right) {
+  double result{};
+  if (op == Ops::OpAdd || op == Ops::OpAddFloat) {
+    result = left + right;
+  } else if (op == Ops::OpSub || op == Ops::OpSubFloat) {
+    result = left - right;
+  } else if (op == Ops::OpMul || op == Ops::OpMulFloat) {
+    result = left * right;
+  } else if (op == Ops::OpDiv || op == Ops::OpDivFloat) {
+    result = left / right;
+  } else {
+    spdlog::error("unknown operator for floats: {}", op);
+    return;
+  }
+
+  push(Value::fromFloat(result));
+}
+
+void VM::executeBinaryStringOperation(const Opcode &op, const Value &left, const Value &right) {
+  String *rightString = right.as<String>();
+  String *leftString = left.as<String>();
 
   if (op == Ops::OpAdd) {
-    std::string result = leftString->value + rightString->value;
-    std::shared_ptr<Object> resultObject = std::make_shared<String>(result);
-    push(resultObject);
+    push(String::concat(leftString, rightString));
   } else {
     spdlog::error("unknown operator for strings: {}", op);
   }
@@ -219,117 +247,171 @@ void VM::executeBinaryStringOperation(const Opcode &op, std::shared_ptr<Object>
 void VM::executeComparision(const Opcode &op) {
   auto right = pop();
   auto left = pop();
-  auto leftType = left->type();
-  auto rightType = right->type();
-
-  if (leftType == INTEGER_OBJ && rightType == INTEGER_OBJ) {
+  if (left.isInteger() && right.isInteger()) {
     executeIntegerComparision(op, left, right);
-  } else if (leftType == BOOLEAN_OBJ && rightType == BOOLEAN_OBJ) {
+  } else if (left.isNumber() && right.isNumber()) {
+    executeFloatComparision(op, left.getNumber(), right.getNumber());
+  } else if (left.isBoolean() && right.isBoolean()) {
     executeBooleanComparision(op, left, right);
+  } else if (left.is<String>() && right.is<String>()) {
+    executeStringComparision(op, left, right);
   } else {
-    spdlog::error("unsupported types for binary operation: {} {}", leftType, rightType);
+    spdlog::error("unsupported types for binary operation: {} {}", left.type(), right.type());
   }
 }
 
-void VM::executeIntegerComparision(const Opcode &op, std::shared_ptr<Object> &left, std::shared_ptr<Object> &right) {
-  Integer *rightInteger = dynamic_cast<Integer *>(right.get());
-  Integer *leftInteger = dynamic_cast<Integer *>(left.get());
+void VM::executeIntegerComparision(const Opcode &op, const Value &left, const Value &right) {
+  int64_t rightInteger = right.getInteger();
+  int64_t leftInteger = left.getInteger();
 
   bool result{};
   if (op == Ops::OpEqual) {
-    result = leftInteger->value == rightInteger->value;
+    result = leftInteger == rightInteger;
   } else if (op == Ops::OpNotEqual) {
-    result = leftInteger->value != rightInteger->value;
+    result = leftInteger != rightInteger;
   } else if (op == Ops::OpGreaterThan) {
-    result = leftInteger->value > rightInteger->value;
+    result = leftInteger > rightInteger;
   } else {
     spdlog::error("unknown operator for integers: {}", op);
     return;
   }
 
-  result ? push(True) : push(False);
+  push(Value::fromBoolean(result));
+}
+
+void VM::executeFloatComparision(const Opcode &op, double left, double right) {
+  bool result{};
+  if (op == Ops::OpEqual) {
+    result = left == right;
+  } else if (op == Ops::OpNotEqual) {
+    result = left != right;
+  } else if (op == Ops::OpGreaterThan) {
+    result = left > right;
+  } else {
+    spdlog::error("unknown operator for floats: {}", op);
+    return;
+  }
+
+  push(Value::fromBoolean(result));
 }
 
-void VM::executeBooleanComparision(const Opcode &op, std::shared_ptr<Object> &left, std::shared_ptr<Object> &right) {
-  Boolean *rightBoolean = dynamic_cast<Boolean *>(right.get());
-  Boolean *leftBoolean = dynamic_cast<Boolean *>(left.get());
+void VM::executeBooleanComparision(const Opcode &op, const Value &left, const Value &right) {
+  bool rightBoolean = right.getBoolean();
+  bool leftBoolean = left.getBoolean();
 
   bool result{};
   if (op == Ops::OpEqual) {
-    result = leftBoolean->value == rightBoolean->value;
+    result = leftBoolean == rightBoolean;
   } else if (op == Ops::OpNotEqual) {
-    result = leftBoolean->value != rightBoolean->value;
+    result = leftBoolean != rightBoolean;
   } else {
     spdlog::error("unknown operator for booleans: {}", op);
     return;
   }
 
-  result ? push(True) : push(False);
+  push(Value::fromBoolean(result));
+}
+
+void VM::executeStringComparision(const Opcode &op, const Value &left, const Value &right) {
+  bool equal = left.as<String>()->equals(right.as<String>());
+
+  bool result{};
+  if (op == Ops::OpEqual) {
+    result = equal;
+  } else if (op == Ops::OpNotEqual) {
+    result = !equal;
+  } else {
+    spdlog::error("unknown operator for strings: {}", op);
+    return;
+  }
+
+  push(Value::fromBoolean(result));
 }
 
 void VM::executeBangOperator() {
   auto operand = pop();
-  if (operand->type() == BOOLEAN_OBJ) {
-    auto boolean = dynamic_cast<Boolean *>(operand.get());
-    !boolean->value ? push(True) : push(False);
+  if (operand.isBoolean()) {
+    push(Value::fromBoolean(!operand.getBoolean()));
   } else {
-    push(False);
+    push(Value::fromBoolean(false));
   }
 }
 
 void VM::executeMinusOperator() {
   auto operand = pop();
 
-  if (operand->type() == INTEGER_OBJ) {
-    auto integer = dynamic_cast<Integer *>(operand.get());
-    std::shared_ptr<Object> result = std::make_shared<Integer>(-integer->value);
-    push(result);
+  if (operand.isInteger()) {
+    push(Value::fromInteger(-operand.getInteger()));
+  } else if (operand.isFloat()) {
+    push(Value::fromFloat(-operand.getFloat()));
   } else {
-    spdlog::error("unsupported type for negation: {}", operand->type());
+    spdlog::error("unsupported type for negation: {}", operand.type());
   }
 }
 
-std::shared_ptr<Object> VM::lastPoppedStackElem() { return lastPopped; }
+Ref<Object> VM::lastPoppedStackElem() { return lastPopped.toObject(); }
 
-std::shared_ptr<Object> VM::buildArray(int startIndex, int endIndex) {
-  std::vector<std::shared_ptr<Object>> elements;
-  for (int i = startIndex; i < endIndex; i++) {
-    elements.push_back(stack[i]);
-  }
+Value VM::buildArray(int startIndex, int endIndex) {
+  return Array::from(&stack[startIndex], endIndex - startIndex);
+}
 
-  auto array = std::make_shared<Array>();
-  array->elements = elements;
+Value VM::buildHash(int startIndex, int endIndex) {
+  auto hash = makeRef<Hash>();
+  hash->pairs.reserve((endIndex - startIndex) / 2);
+  for (int i = startIndex; i < endIndex; i += 2) {
+    auto key = stack[i].toObject();
+    if (!HashTable::hashable(key.get())) {
+      spdlog::error("unusable as hash key: {}", stack[i].type());
+      return nullptr;
+    }
+    hash->pairs.set(std::move(key), stack[i + 1].toObject());
+  }
 
-  return array;
+  return hash;
 }
 
-bool VM::isTruthy(std::shared_ptr<Object> &object) {
-  if (object->type() == BOOLEAN_OBJ) {
-    auto boolean = dynamic_cast<Boolean *>(object.get());
-    return boolean->value;
+bool VM::isTruthy(const Value &value) {
+  if (value.isBoolean()) {
+    return value.getBoolean();
   }
 
-  return true;
+  // Here, null is falsy, the same as the evaluator.
+  return !value.isNull();
 }
 
-void VM::executeIndexExpression(std::shared_ptr<Object> &left, std::shared_ptr<Object> &index) {
-  if (left->type() == ARRAY_OBJ && index->type() == INTEGER_OBJ) {
+void VM::executeIndexExpression(const Value &left, const Value &index) {
+  if (left.is<Array>() && index.isInteger()) {
     executeArrayIndex(left, index);
+  } else if (left.is<Hash>()) {
+    executeHashIndex(left, index);
   } else {
-    spdlog::error("index operator not supported: {} {}", left->type(), index->type());
+    spdlog::error("index operator not supported: {} {}", left.type(), index.type());
   }
 }
 
-void VM::executeArrayIndex(std::shared_ptr<Object> &left, std::shared_ptr<Object> &index) {
-  Array *array = dynamic_cast<Array *>(left.get());
-  Integer *integer = dynamic_cast<Integer *>(index.get());
+void VM::executeArrayIndex(const Value &left, const Value &index) {
+  Array *array = left.as<Array>();
+  int64_t i = index.getInteger();
+
+  if (i < 0 || i >= static_cast<int64_t>(array->size())) {
+    spdlog::error("index out of bounds: {} {}", i, array->size());
+  } else {
+    push(array->valueAt(i));
+  }
+}
 
-  int i = integer->value;
+void VM::executeHashIndex(const Value &left, const Value &index) {
+  auto key = index.toObject();
+  if (!HashTable::hashable(key.get())) {
+    spdlog::error("unusable as hash key: {}", index.type());
+    return;
+  }
 
-  if (i < 0 || i >= array->elements.size()) {
-    spdlog::error("index out of bounds: {} {}", i, array->elements.size());
+  auto value = left.as<Hash>()->pairs.find(key.get());
+  if (value == nullptr) {
+    push(nullptr);
   } else {
-    push(array->elements[i]);
+    push(*value);
   }
 }
 
@@ -346,19 +428,19 @@ std::shared_ptr<Frame> VM::popFrame() {
 }
 
 void VM::executeCall(int argumentSize) {
-  std::shared_ptr<Closure> closure = std::dynamic_pointer_cast<Closure>(stack[sp - 1 - argumentSize]);
-  if (closure != nullptr) {
+  auto &callee = stack[sp - 1 - argumentSize];
+  if (callee.is<Closure>()) {
+    Ref<Closure> closure = callee.share<Closure>();
     return callClosure(closure, argumentSize);
   }
 
-  std::shared_ptr<Builtin> builtin = std::dynamic_pointer_cast<Builtin>(stack[sp - 1 - argumentSize]);
-  if (builtin != nullptr) {
-    return callBuiltin(builtin, argumentSize);
+  if (callee.is<Builtin>()) {
+    return callBuiltin(callee.as<Builtin>(), argumentSize);
   }
 
   spdlog::error("calling non-function and non-builtin");
 }
-void VM::callClosure(std::shared_ptr<Closure> &closure, int argumentSize) {
+void VM::callClosure(Ref<Closure> &closure, int argumentSize) {
   auto frame = std::make_shared<Frame>(closure, sp - argumentSize);
   pushFrame(frame);
 
@@ -367,36 +449,65 @@ void VM::callClosure(std::shared_ptr<Closure> &closure, int argumentSize) {
   sp += closure->fn->numLocals;
 }
 
-void VM::callBuiltin(std::shared_ptr<Builtin> &builtin, int argumentSize) {
-  std::vector<std::shared_ptr<Object>> args;
-  for (int i = sp - argumentSize; i < sp; i++) {
-    args.push_back(stack[i]);
+void VM::callBuiltin(Builtin *builtin, int argumentSize) {
+  // The builtins are immortal, and the arguments are read in place.
+  Value result = builtin->call(Arguments{&stack[sp - argumentSize], static_cast<std::size_t>(argumentSize), this});
+  sp -= argumentSize + 1;
+
+  // Null is a value as well, the caller always expects one.
+  push(std::move(result));
+}
+
+Value VM::call(const Value &fn, const Value *values, std::size_t count) {
+  if (fn.is<Builtin>()) {
+    return fn.as<Builtin>()->call(Arguments{values, count, this});
   }
 
-  std::shared_ptr<Object> result = builtin->fn(args);
-  sp -= argumentSize + 1;
+  if (!fn.is<Closure>()) {
+    return makeRef<Error>("not a function: " + fn.type());
+  }
+
+  // The parameters past the arguments would read the stale stack slots
+  int want = fn.as<Closure>()->fn->numParameters;
+  if (count != static_cast<std::size_t>(want)) {
+    return makeRef<Error>("wrong number of arguments. got=" + std::to_string(count) + ", want=" + std::to_string(want));
+  }
+
+  // The arguments of the builtin are below the stack top, they stay.
+  int depth = framesIndex;
+  int base = sp;
+  push(fn);
+  for (std::size_t i = 0; i < count; i++) {
+    push(values[i]);
+  }
+
+  Ref<Closure> closure = fn.share<Closure>();
+  callClosure(closure, static_cast<int>(count));
+  execute(depth);
 
-  if (result != nullptr) {
-    push(result);
+  if (framesIndex > depth) {
+    // The body ran off its end without a value
+    framesIndex = depth;
+    sp = base;
+    return nullptr;
   }
+  return pop();
 }
 
 void VM::pushClosure(int constantIndex, int numFree) {
-  auto constant = constants[constantIndex];
-  auto fn = std::dynamic_pointer_cast<CompiledFunction>(constant);
-  if (fn == nullptr) {
-    spdlog::error("not a function: {}", constant->type());
+  auto &constant = constants[constantIndex];
+  if (!constant.is<CompiledFunction>()) {
+    spdlog::error("not a function: {}", constant.type());
     return;
   }
+  auto fn = constant.share<CompiledFunction>();
 
-  std::vector<std::shared_ptr<Object>> free{};
+  std::vector<Value> free{};
 
   for (int i = 0; i < numFree; i++) {
     free.push_back(stack[sp - numFree + i]);
   }
   sp -= numFree;
 
-  std::shared_ptr<Object> closure = std::make_shared<Closure>(fn, std::move(free));
-
-  push(closure);
+  push(makeRef<Closure>(fn, std::move(free)));
 }
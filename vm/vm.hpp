@@ -14,19 +14,16 @@ static constexpr int StackSize = 2048;
 static constexpr int GlobalSize = 65536;
 static constexpr int MaxFrames = 1024;
 
-class VM {
+class VM : public Caller {
 private:
-  static std::shared_ptr<Object> True;
-  static std::shared_ptr<Object> False;
-
   // For test only
-  std::shared_ptr<Object> lastPopped;
+  Value lastPopped;
 
 public:
-  std::vector<std::shared_ptr<Object>> constants;
-  std::shared_ptr<std::vector<std::shared_ptr<Object>>> globals;
+  std::vector<Value> constants;
+  std::shared_ptr<std::vector<Value>> globals;
 
-  std::vector<std::shared_ptr<Object>> stack;
+  std::vector<Value> stack;
   int sp;
 
   std::vector<std::shared_ptr<Frame>> frames;
@@ -35,17 +32,17 @@ public:
   VM() = delete;
 
   VM(const VM &v) = delete;
-  VM(std::vector<std::shared_ptr<Object>> &&constants_, Instructions &&instructions)
+  VM(std::vector<Value> &&constants_, Instructions &&instructions)
       : constants{std::move(constants_)}, sp{0}, stack(StackSize), frames(MaxFrames), framesIndex{1} {
-    globals = std::make_shared<std::vector<std::shared_ptr<Object>>>(GlobalSize);
-    auto mainFn = std::make_shared<CompiledFunction>(std::move(instructions), 0);
-    auto mainClosure = std::make_shared<Closure>(mainFn);
+    globals = std::make_shared<std::vector<Value>>(GlobalSize);
+    auto mainFn = makeRef<CompiledFunction>(std::move(instructions), 0);
+    auto mainClosure = makeRef<Closure>(mainFn);
     auto mainFrame = std::make_shared<Frame>(mainClosure, 0);
     frames[0] = mainFrame;
   }
 
-  VM(std::vector<std::shared_ptr<Object>> &&constants_,
-     std::shared_ptr<std::vector<std::shared_ptr<Object>>> &globals_,
+  VM(std::vector<Value> &&constants_,
+     std::shared_ptr<std::vector<Value>> &globals_,
      Instructions &&instructions)
       : constants{std::move(constants_)}
       , globals{globals_}
@@ -53,18 +50,18 @@ public:
       , stack(StackSize)
       , frames(MaxFrames)
       , framesIndex{1} {
-    auto mainFn = std::make_shared<CompiledFunction>(std::move(instructions), 0);
-    auto mainClosure = std::make_shared<Closure>(mainFn);
+    auto mainFn = makeRef<CompiledFunction>(std::move(instructions), 0);
+    auto mainClosure = makeRef<Closure>(mainFn);
     auto mainFrame = std::make_shared<Frame>(mainClosure, 0);
     frames[0] = mainFrame;
   }
 
   /**
-   * @brief get the top stack object
+   * @brief get the top stack value
    *
-   * @return Object*
+   * @return Value null if the stack is empty
    */
-  Object *stackTop();
+  Value stackTop();
 
   /**
    * @brief start the vm
@@ -73,17 +70,32 @@ public:
   void run();
 
   /**
-   * @brief push the object to the stack
+   * @brief run the instructions until the frames are popped down to
+   * `depth`, or the current frame runs off its end
+   *
+   */
+  void execute(int depth);
+
+  /**
+   * @brief call the function from a builtin. The closure runs on this
+   * VM above the current stack top, and the call returns once it
+   * returns, so a builtin could call back any number of times.
+   *
+   */
+  Value call(const Value &fn, const Value *values, std::size_t count) override;
+
+  /**
+   * @brief push the value to the stack
    *
    */
-  void push(std::shared_ptr<Object> &object);
+  void push(Value value);
 
   /**
-   * @brief pop the object from the stack
+   * @brief pop the value from the stack
    *
-   * @return std::shared_ptr<Object>
+   * @return Value
    */
-  std::shared_ptr<Object> pop();
+  Value pop();
 
   /**
    * @brief execute the binary operation
@@ -96,19 +108,36 @@ public:
    * @brief execute the integer operator such as add, sub, mul, div
    *
    * @param op the operator
-   * @param left the left object
-   * @param right the right object
+   * @param left the left value
+   * @param right the right value
    */
-  void executeBinaryIntegerOperation(const Opcode &op, std::shared_ptr<Object> &left, std::shared_ptr<Object> &right);
+  void executeBinaryIntegerOperation(const Opcode &op, const Value &left, const Value &right);
+
+  /**
+   * @brief execute the float opcodes, an integer operand is promoted
+   *
+   * @param op the operator
+   */
+  void executeFloatOperation(const Opcode &op);
+
+  /**
+   * @brief execute the float operator such as add, sub, mul, div, either
+   * the generic or the float opcode
+   *
+   * @param op the operator
+   * @param left the left number
+   * @param right the right number
+   */
+  void executeBinaryFloatOperation(const Opcode &op, double left, double right);
 
   /**
    * @brief execute the string operator such as add
    *
    * @param op the operator
-   * @param left the left object
-   * @param right the right object
+   * @param left the left value
+   * @param right the right value
    */
-  void executeBinaryStringOperation(const Opcode &op, std::shared_ptr<Object> &left, std::shared_ptr<Object> &right);
+  void executeBinaryStringOperation(const Opcode &op, const Value &left, const Value &right);
 
   /**
    * @brief execute the comparison such as equal, not equal, greater than, less than
@@ -121,13 +150,25 @@ public:
    * @brief execute the integer comparison such as equal, not equal, greater than, less than
    *
    */
-  void executeIntegerComparision(const Opcode &op, std::shared_ptr<Object> &left, std::shared_ptr<Object> &right);
+  void executeIntegerComparision(const Opcode &op, const Value &left, const Value &right);
+
+  /**
+   * @brief execute the float comparison such as equal, not equal, greater than, less than
+   *
+   */
+  void executeFloatComparision(const Opcode &op, double left, double right);
 
   /**
    * @brief execute the boolean comparison such as equal, not equal
    *
    */
-  void executeBooleanComparision(const Opcode &op, std::shared_ptr<Object> &left, std::shared_ptr<Object> &right);
+  void executeBooleanComparision(const Opcode &op, const Value &left, const Value &right);
+
+  /**
+   * @brief execute the string comparison such as equal, not equal
+   *
+   */
+  void executeStringComparision(const Opcode &op, const Value &left, const Value &right);
 
   /**
    * @brief execute the bang operator, get the value from the stack
@@ -144,16 +185,22 @@ public:
   /**
    * @brief execute the index expression
    *
-   * @param left the left object
-   * @param index the index object
+   * @param left the left value
+   * @param index the index value
    */
-  void executeIndexExpression(std::shared_ptr<Object> &left, std::shared_ptr<Object> &index);
+  void executeIndexExpression(const Value &left, const Value &index);
 
   /**
    * @brief execute the array index
    *
    */
-  void executeArrayIndex(std::shared_ptr<Object> &left, std::shared_ptr<Object> &index);
+  void executeArrayIndex(const Value &left, const Value &index);
+
+  /**
+   * @brief execute the hash index, push null for a missing key
+   *
+   */
+  void executeHashIndex(const Value &left, const Value &index);
 
   /**
    * @brief execute the function call
@@ -168,7 +215,7 @@ public:
    * @param closure
    * @param argumentSize
    */
-  void callClosure(std::shared_ptr<Closure> &closure, int argumentSize);
+  void callClosure(Ref<Closure> &closure, int argumentSize);
 
   /**
    * @brief push the closure to the stack at the run time
@@ -182,28 +229,37 @@ public:
    * @param builtin
    * @param argumentSize
    */
-  void callBuiltin(std::shared_ptr<Builtin> &builtin, int argumentSize);
+  void callBuiltin(Builtin *builtin, int argumentSize);
 
   /**
-   * @brief For test only get last popped
+   * @brief For test only get last popped, boxed into the object
    *
    */
-  std::shared_ptr<Object> lastPoppedStackElem();
+  Ref<Object> lastPoppedStackElem();
 
   /**
    * @brief build the array object
    *
    * @param startIndex the start index of the array
    * @param endIndex the end index of the array
-   * @return std::shared_ptr<Object>
+   * @return Value
+   */
+  Value buildArray(int startIndex, int endIndex);
+
+  /**
+   * @brief build the hash object from the keys and the values
+   *
+   * @param startIndex the index of the first key
+   * @param endIndex the end index of the pairs
+   * @return Value
    */
-  std::shared_ptr<Object> buildArray(int startIndex, int endIndex);
+  Value buildHash(int startIndex, int endIndex);
 
   /**
-   * @brief get the boolean value from the object
+   * @brief get the boolean value from the value
    *
    */
-  bool isTruthy(std::shared_ptr<Object> &object);
+  bool isTruthy(const Value &value);
 
   /**
    * @brief get the current frame